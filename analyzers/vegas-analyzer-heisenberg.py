@@ -47,6 +47,19 @@ def main(file):
     fields = data.get("field")[:]
     num_sites = len(data.get("positions"))
 
+    # The adaptive runs give the transient and the steps of each point, and
+    # the steps that weren't simulated are NaN, so only the steps between
+    # them are joined. Otherwise the first fifth of the joined series is
+    # discarded.
+    steps = data.attrs.get("steps_by_record", 1)
+    adaptive = "mcs_used" in data and "equilibration" in data
+    if adaptive:
+        begins = data.get("equilibration")[:] // steps
+        ends = data.get("mcs_used")[:] // steps
+    else:
+        begins = numpy.zeros(len(temps), dtype=int)
+        ends = numpy.full(len(temps), data.get("energy").shape[1])
+
     types = numpy.unique(data.get("types")[:])
     types = [t.decode("utf-8") for t in types]
 
@@ -79,14 +92,14 @@ def main(file):
     energy = [list() for _ in range(len(equals))]
     for i, eq in enumerate(equals):
         for j in eq:
-            mags_x[i] += list(data.get("magnetization_x")[j, :])
-            mags_y[i] += list(data.get("magnetization_y")[j, :])
-            mags_z[i] += list(data.get("magnetization_z")[j, :])
-            energy[i] += list(data.get("energy")[j, :])
+            mags_x[i] += list(data.get("magnetization_x")[j, begins[j]:ends[j]])
+            mags_y[i] += list(data.get("magnetization_y")[j, begins[j]:ends[j]])
+            mags_z[i] += list(data.get("magnetization_z")[j, begins[j]:ends[j]])
+            energy[i] += list(data.get("energy")[j, begins[j]:ends[j]])
             for t in types:
-                mags_types_x[t][i] += list(data.get("%s_x" % t)[j, :])
-                mags_types_y[t][i] += list(data.get("%s_y" % t)[j, :])
-                mags_types_z[t][i] += list(data.get("%s_z" % t)[j, :])
+                mags_types_x[t][i] += list(data.get("%s_x" % t)[j, begins[j]:ends[j]])
+                mags_types_y[t][i] += list(data.get("%s_y" % t)[j, begins[j]:ends[j]])
+                mags_types_z[t][i] += list(data.get("%s_z" % t)[j, begins[j]:ends[j]])
     mags_x = [numpy.array(M) for M in mags_x]
     mags_y = [numpy.array(M) for M in mags_y]
     mags_z = [numpy.array(M) for M in mags_z]
@@ -96,7 +109,7 @@ def main(file):
         mags_types_y[t] = [numpy.array(M) for M in mags_types_y[t]]
         mags_types_z[t] = [numpy.array(M) for M in mags_types_z[t]]
 
-    tau = [len(M)//5 for M in energy]
+    tau = [0 if adaptive else len(M)//5 for M in energy]
 
     mean_mags = numpy.array([numpy.mean(numpy.linalg.norm([
             mags_x[i], mags_y[i], mags_z[i]], axis=0)[tau[i]:]) / num_sites
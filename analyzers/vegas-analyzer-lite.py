@@ -12,12 +12,23 @@ def main(file):
     dataset = h5py.File(file, mode="r")
     mcs = dataset.attrs["mcs"]
     seed = dataset.attrs["seed"]
-    tau = mcs // 5
+    steps = dataset.attrs.get("steps_by_record", 1)
+    tau = (mcs // steps) // 5
     num_ions = len(dataset.get("positions"))
     temps = dataset.get("temperature")[:]
     fields = dataset.get("field")[:]
-    Mz = dataset.get("magnetization_z")[:, tau:] / num_ions
-    Mz_mean = numpy.mean(Mz, axis=1)
+    Mz = dataset.get("magnetization_z")[:] / num_ions
+    if "mcs_used" in dataset and "equilibration" in dataset:
+        # The adaptive runs give the transient and the steps of each point,
+        # and the steps that weren't simulated are NaN.
+        begins = dataset.get("equilibration")[:] // steps
+        ends = dataset.get("mcs_used")[:] // steps
+        for i in range(len(Mz)):
+            Mz[i, :begins[i]] = numpy.nan
+            Mz[i, ends[i]:] = numpy.nan
+    else:
+        Mz = Mz[:, tau:]
+    Mz_mean = numpy.nanmean(Mz, axis=1)
     zeros = numpy.zeros_like(Mz_mean)
     # T, H, E, Cv, M, Mz, X, generic, genericz, X_generic
     dataset.close()
@@ -6,6 +6,20 @@ from matplotlib.backends.backend_pdf import PdfPages
 import click
 import h5py
 
+
+def window(dataset, name, tau, steps):
+    series = dataset.get(name)[:]
+    if "mcs_used" in dataset and "equilibration" in dataset:
+        # The adaptive runs give the transient and the steps of each point,
+        # and the steps that weren't simulated are NaN.
+        begins = dataset.get("equilibration")[:] // steps
+        ends = dataset.get("mcs_used")[:] // steps
+        for i in range(len(series)):
+            series[i, :begins[i]] = numpy.nan
+            series[i, ends[i]:] = numpy.nan
+        return series
+    return series[:, tau:]
+
 @click.command()
 @click.argument("file")
 def main(file):
@@ -16,38 +30,39 @@ def main(file):
     kb = dataset.attrs.get("kb", 1.0)
     seed = dataset.attrs.get("seed")
 
-    tau = mcs // 2
+    steps = dataset.attrs.get("steps_by_record", 1)
+    tau = (mcs // steps) // 2
 
     temps = dataset.get("temperature")[:]
     fields = dataset.get("field")[:]
 
-    energy = dataset.get("energy")[:, tau:]
-    magx = dataset.get("magnetization_x")[:, tau:]
-    magy = dataset.get("magnetization_y")[:, tau:]
-    magz = dataset.get("magnetization_z")[:, tau:]
+    energy = window(dataset, "energy", tau, steps)
+    magx = window(dataset, "magnetization_x", tau, steps)
+    magy = window(dataset, "magnetization_y", tau, steps)
+    magz = window(dataset, "magnetization_z", tau, steps)
     dataset.close()
 
-    magx_mean = numpy.mean(magx, axis=1)
-    magx_abs_mean = numpy.abs(numpy.mean(magx, axis=1))
+    magx_mean = numpy.nanmean(magx, axis=1)
+    magx_abs_mean = numpy.abs(numpy.nanmean(magx, axis=1))
 
-    magy_mean = numpy.mean(magy, axis=1)
-    magy_abs_mean = numpy.abs(numpy.mean(magy, axis=1))
+    magy_mean = numpy.nanmean(magy, axis=1)
+    magy_abs_mean = numpy.abs(numpy.nanmean(magy, axis=1))
 
-    magz_mean = numpy.mean(magz, axis=1)
-    magz_abs_mean = numpy.abs(numpy.mean(magz, axis=1))
+    magz_mean = numpy.nanmean(magz, axis=1)
+    magz_abs_mean = numpy.abs(numpy.nanmean(magz, axis=1))
 
     mag = numpy.array([magx, magy, magz])
-    mag_mean = numpy.mean(numpy.linalg.norm(mag, axis=0), axis=1)
+    mag_mean = numpy.nanmean(numpy.linalg.norm(mag, axis=0), axis=1)
 
-    energy_mean = numpy.mean(energy, axis=1)
+    energy_mean = numpy.nanmean(energy, axis=1)
 
-    chix = numpy.std(magx, axis=1) ** 2 / (kb * temps)
-    chiy = numpy.std(magy, axis=1) ** 2 / (kb * temps)
-    chiz = numpy.std(magz, axis=1) ** 2 / (kb * temps)
+    chix = numpy.nanstd(magx, axis=1) ** 2 / (kb * temps)
+    chiy = numpy.nanstd(magy, axis=1) ** 2 / (kb * temps)
+    chiz = numpy.nanstd(magz, axis=1) ** 2 / (kb * temps)
     
-    chi = numpy.std(numpy.linalg.norm(mag, axis=0), axis=1) ** 2 / (kb * temps)
+    chi = numpy.nanstd(numpy.linalg.norm(mag, axis=0), axis=1) ** 2 / (kb * temps)
 
-    cv = numpy.std(energy, axis=1) ** 2 / (kb * temps**2)
+    cv = numpy.nanstd(energy, axis=1) ** 2 / (kb * temps**2)
 
 
     for xlabel, xarr in zip(["T", "H"], [temps, fields]):
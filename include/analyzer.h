@@ -0,0 +1,76 @@
+#ifndef ANALYZER_H
+#define ANALYZER_H
+
+#include "params.h"
+#include "H5Include.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Post-processing of the outputs of vegas. It computes the same columns of
+// the '.mean' files of the python analyzers (T, H, E, Cv, M, Mz, X and
+// M, Mz, X by type), reading the time series by chunks, so the memory
+// doesn't depend on the amount of MCS, and analyzing the points in parallel.
+class Analyzer
+{
+public:
+    Analyzer();
+    ~Analyzer();
+
+    // Returns an empty string if the file has the datasets of vegas,
+    // otherwise the reason why it can't be analyzed.
+    std::string load(const std::string& fileName);
+
+    void compute(Index threads);
+    void write(const std::string& fileName) const;
+
+    // Groups of consecutive points with the same temperature and field,
+    // whose time series are joined like in 'get_equals' of the python
+    // analyzers.
+    const std::vector< std::vector<Index> >& getGroups() const;
+
+    // Whether the series are averages of blocks of steps, whose variances
+    // are added to the ones of the series.
+    bool getBlockAverages() const;
+
+    // Total columns T, H, E, Cv, M, Mz and X on 'points' temperatures
+    // between the lowest and the highest simulated ones of each field, by
+    // multiple histogram reweighting of all the points of that field.
+    void reweight(Index points, Index threads);
+    void writeReweighted(const std::string& fileName) const;
+
+private:
+    void analyzeGroup(Index group);
+    void readRow(hid_t dset, Index row, Index begin, Index count, double* buffer);
+    std::string readTypes();
+
+    hid_t file_;
+    // The HDF5 library is not thread safe, so the reads are serialized.
+    std::mutex mutex_;
+
+    Index mcs_;
+    int seed_;
+    Real kb_;
+    std::vector<Real> temps_;
+    std::vector<Real> fields_;
+    Index num_sites_;
+    std::vector<std::string> types_;
+    std::vector<Index> sizesByType_;
+    // Length and equilibration of each series in the adaptive mode, empty
+    // otherwise.
+    std::vector<Index> used_;
+    std::vector<Index> equilibration_;
+
+    // energy, magnetization_x/y/z and then <type>_x/y/z for each type,
+    // followed by energy_variance, magnetization_norm and _variance, and
+    // then <type>_norm and _variance for each type with block averages.
+    std::vector<hid_t> series_;
+    bool blockAverages_;
+
+    std::vector< std::vector<Index> > groups_;
+    std::vector< std::vector<Real> > results_;
+    std::vector< std::vector<Real> > reweighted_;
+};
+
+#endif // ANALYZER_H
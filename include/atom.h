@@ -3,15 +3,50 @@
 
 #include "params.h"
 
+#include <cstdint>
 #include <string>
-#include <functional>
 #include <random>
+#include <vector>
+
+// Anisotropy term of a site, uniaxial along the axis A,
+//     E = - k (S.A)^2,
+// or cubic with the orthogonal axes A, B and C = A x B,
+//     E = - k [(S.A)^2 (S.B)^2 + (S.A)^2 (S.C)^2 + (S.B)^2 (S.C)^2].
+struct AnisotropyTerm
+{
+    bool cubic;
+    Array axes[3];
+    Real constant;
+
+    Real energy(const Array& spin) const;
+    // Anisotropy field, - dE/dS.
+    Array field(const Array& spin) const;
+    // Upper bound of |E| for the spins of the given norm, so any change of
+    // the spin changes the energy by more than - range.
+    Real range(Real spinNorm) const;
+};
+
+// Spin models of the sites, kept as a small id by site. The names of the
+// types are kept once in the lattice, so a site only has its type index.
+enum class Model : std::uint8_t
+{
+    RANDOM, FLIP, QISING, ADAPTIVE, CONE30, CONE15, HN30, HN15, UNKNOWN
+};
+
+// Model with the given name, in lower case, or UNKNOWN.
+Model modelFromName(const std::string& name);
+std::string modelName(Model model);
 
 class Atom
 {
 public:
     Atom();
     Atom(Index index, Array spin, Array position);
+    Atom(const Atom& other) = default;
+    Atom& operator=(const Atom& other) = default;
+    // The sites are moved into the lattice without copying their buffers.
+    Atom(Atom&& other) = default;
+    Atom& operator=(Atom&& other) = default;
     ~Atom();
 
 
@@ -21,80 +56,63 @@ public:
     const Real& getSpinNorm() const;
     const Array& getSpin() const;
     const Array& getOldSpin() const;
-    const Array& getAnisotropyUnit() const;
     const std::vector<Real>& getExchanges() const;
-    const std::string& getType() const;
-    const std::string& getTypeAnisotropy() const;
-    const Real& getKan() const;
     const Array& getExternalField() const;
-    const Index& getSproj() const;
-    const Index& getTypeIndex() const;
-
-    const std::vector<double>& getProjections() const;
-    const std::vector<double>& getPossibleProjections() const;
-
-    const std::string& getModel() const;
-    void setModel(const std::string& model);
+    Index getTypeIndex() const;
 
+    Model getModel() const;
+    void setModel(Model model);
 
     void setPosition(const Array& position);
     void setNbhs(const std::vector<Atom*>& nbhs);
     void setExchanges(const std::vector<Real>& exchanges);
-    void setType(const std::string& type);
     void setSpin(const Array& spin);
     void setOldSpin(const Array& oldSpin);
     void setExternalField(const Array& externalField);
-    void setSproj(const Index& Sproj);
-    void setTypeIndex(const Index& typeIndex);
+    void setTypeIndex(Index typeIndex);
 
+    // Reserves the tables of neighbors and exchanges.
+    void reserveNbhs(Index count);
     void addNbh(Atom* nbh);
     void addExchange(Real exchange);
 
-    void changeProjection(Index i, Real value);
-    void removePossibleProjection(Index i);
-
+    // Projections of the qising model, numbered from - S.
+    Index getNumProjections() const;
+    Index getProjection() const;
+    void setProjection(Index projection);
 
     Real getExchangeEnergy() const;
     Real getZeemanEnergy(const Real& H) const;
     Real getAnisotropyEnergy(const Atom& atom) const;
 
-    std::function<void(
-        std::mt19937_64& engine,
-        std::uniform_real_distribution<>& realRandomGenerator,
-        std::normal_distribution<>& gaussianRandomGenerator,
-        Real sigma_, Atom& atom, Index num)> randomizeSpin;
-
-
-    std::function<void(
-        std::mt19937_64& engine,
-        std::uniform_real_distribution<>& realRandomGenerator,
-        std::normal_distribution<>& gaussianRandomGenerator,
-        Atom& atom)> randomInitialState;
+    // Moves of the spin, following its model.
+    void randomizeSpin(std::mt19937_64& engine,
+                       std::uniform_real_distribution<>& realRandomGenerator,
+                       std::normal_distribution<>& gaussianRandomGenerator,
+                       Real sigma_, Index num);
+    void randomInitialState(std::mt19937_64& engine,
+                            std::uniform_real_distribution<>& realRandomGenerator,
+                            std::normal_distribution<>& gaussianRandomGenerator);
 
     void revertSpin();
 
+    void addAnisotropyTerm(const AnisotropyTerm& term);
+    const std::vector<AnisotropyTerm>& getAnisotropyTerms() const;
 
-    void addAnisotropyTerm(const std::function<Real(const Atom&)>& func);
+    // Bytes held by the site, with the buffers of its arrays and vectors.
+    std::size_t getMemory() const;
 private:
     Array position_;
-    Index index_;
-    std::vector<Atom*> nbhs_;
-    Real spinNorm_;
     Array spin_;
     Array oldSpin_;
     Array externalField_;
-
-    std::string type_;
-    Index typeIndex_;
+    std::vector<Atom*> nbhs_;
     std::vector<Real> exchanges_;
-    std::vector<double> projections_;
-    std::vector<double> possibleProjections_;
-
-    std::string model_;
-
-    Index Sproj_;
-
-    std::vector< std::function<Real(const Atom&)> > anisotropyTerms_;
+    std::vector<AnisotropyTerm> anisotropyTerms_;
+    Real spinNorm_;
+    Index index_;
+    Index typeIndex_;
+    Model model_;
 };
 
 #endif // ATOM_H
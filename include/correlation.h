@@ -0,0 +1,78 @@
+#ifndef CORRELATION_H
+#define CORRELATION_H
+
+#include "params.h"
+#include "lattice.h"
+
+#include <string>
+#include <vector>
+
+// Spin-spin correlation function G(r) = <S_i . S_j> of the pairs of sites
+// whose distance falls in each bin of width 'width' up to 'cutoff', and
+// second-moment correlation length
+//
+//     xi = sqrt(chi(0) / chi(q_min) - 1) / (2 sin(q_min / 2)),   chi(q) = <|sum_i S_i exp(i q . r_i)|^2> / N
+//
+// with q_min = 2 pi / L along each axis of the sample, L being its length
+// with the separation of the sites, averaged over the axes. The pairs are
+// found with a cell list of cells of side 'cutoff', so each measurement
+// costs O(N) and nothing is stored by pair.
+class Correlation
+{
+public:
+    Correlation();
+
+    // Returns an empty string if the correlation can be measured with the
+    // given cutoff and width, otherwise the reason why it can't.
+    std::string setup(Lattice& lattice, Real cutoff, Real width);
+
+    bool isEnabled() const;
+    Real getCutoff() const;
+    Index getNumBins() const;
+
+    // Mean distance and amount of pairs of each bin.
+    const std::vector<Real>& getDistances() const;
+    const std::vector<Real>& getPairs() const;
+
+    // Clears the measurements of the previous point.
+    void reset();
+    void measure(Lattice& lattice);
+
+    // Mean of G(r) in each bin over the measurements (NaN for the empty
+    // bins), and the correlation length (NaN if it can't be estimated).
+    std::vector<Real> getMean() const;
+    Real getLength() const;
+
+private:
+    Index cellOf(const Real* position) const;
+    // Adds S_i . S_j of each pair of sites to the bin of its distance, or
+    // the distance itself without a lattice, and counts the pairs of each
+    // bin if 'counts' isn't null.
+    void accumulate(Lattice* lattice, std::vector<Real>& values, std::vector<Real>* counts) const;
+
+    bool enabled_;
+    Real cutoff_;
+    Real width_;
+    Index numSites_;
+    std::vector<Real> positions_;
+
+    // Sites sorted by cell, and the first of each cell.
+    Real low_[3];
+    Real side_;
+    Index cells_[3];
+    std::vector<Index> cellStarts_;
+    std::vector<Index> cellSites_;
+
+    std::vector<Real> distances_;
+    std::vector<Real> pairs_;
+
+    // Minimal wave vector of each axis with more than one layer of sites.
+    Real minimalQ_[3];
+
+    Index measurements_;
+    std::vector<Real> sums_;
+    Real chiZero_;
+    Real chiMinimal_[3];
+};
+
+#endif // CORRELATION_H
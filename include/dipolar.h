@@ -0,0 +1,76 @@
+#ifndef DIPOLAR_H
+#define DIPOLAR_H
+
+#include "params.h"
+#include "lattice.h"
+#include "fft.h"
+
+#include <string>
+#include <vector>
+
+// Long-range dipolar interaction for samples whose sites lie on a regular
+// grid, with open boundaries. The energy is
+//
+//     E = D sum_{i<j} [S_i . S_j - 3 (S_i . r_ij)(S_j . r_ij) / r_ij^2] / r_ij^3
+//
+// and the dipolar field of all the sites is computed as the convolution of
+// the spins with the dipolar tensor, through FFTs over a zero-padded grid,
+// in O(N log N). During a sweep the field is refreshed only every
+// 'refresh' accepted changes; in between, the field of a site is the
+// refreshed one plus the exact contribution of the sites changed since
+// then, so the energies are never approximated.
+class Dipolar
+{
+public:
+    Dipolar();
+    Dipolar(Real strength, Index refresh);
+
+    // Returns an empty string if the sites of the lattice can be mapped to
+    // a grid with the given spacing (automatic for zero components),
+    // otherwise the reason why they can't. A zero 'refresh' is replaced by
+    // the one that balances the FFTs with the corrections.
+    std::string mapLattice(Lattice& lattice, Array spacing);
+
+    bool isEnabled() const;
+    Real getStrength() const;
+    Index getRefresh() const;
+
+    // Field over the site in the sample position 'site', without its own
+    // contribution.
+    Array getLocalField(Index site) const;
+
+    // It must be called after every accepted change of a spin, with the
+    // change of the dipolar energy.
+    void update(const std::vector<Atom>& atoms, Index site, Real deltaEnergy);
+
+    // Recomputes the field of all the sites from the current spins.
+    void refresh(const std::vector<Atom>& atoms);
+
+    // Total dipolar energy of the current spins.
+    Real getEnergy() const;
+
+private:
+    bool enabled_;
+    Real strength_;
+    Index refresh_;
+
+    Index dims_[3];
+    Index extents_[3];
+    std::vector<Index> gridIndexes_;
+    std::vector<Real> positions_;
+
+    // Fourier transform of the tensor components xx, xy, xz, yy, yz and zz.
+    std::vector<Real> kernel_[6];
+    std::vector<Complex> grid_[3];
+
+    // Field and spins of the last refresh, and the sites changed since then
+    // with their positions and changes of spin, six values by site.
+    std::vector<Real> field_;
+    std::vector<Real> reference_;
+    std::vector<Index> changed_;
+    std::vector<Real> changes_;
+    std::vector<Index> slots_;
+    Real energy_;
+};
+
+#endif // DIPOLAR_H
@@ -0,0 +1,113 @@
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+#include "params.h"
+#include "atom.h"
+#include "statistics.h"
+#include "H5Include.h"
+
+#include <mpi.h>
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Domain-decomposed Metropolis engine. The sites are partitioned in slabs
+// along the longest axis of the sample, one slab by rank, and each slab is
+// split in a lower and an upper half. The lower halves of all the ranks are
+// updated at the same time (phase 0), followed by the upper halves
+// (phase 1); after each phase the spins in the boundaries are sent to the
+// ranks that have them as halo. Every rank only keeps its own sites and
+// their halo, besides the domain of each site, so the sample never needs
+// to fit in a single node.
+class DistributedSystem
+{
+public:
+    DistributedSystem(std::string fileName,
+                      std::vector<Real> temps,
+                      std::vector<Real> fields,
+                      Index mcs,
+                      Index seed,
+                      std::string outName,
+                      Real kb,
+                      MPI_Comm comm);
+    ~DistributedSystem();
+
+    void randomizeSpins();
+    void cycle();
+
+    Index getNumSites() const;
+    Index getNumLocalSites() const;
+    Index getNumHaloSites() const;
+    const std::map<std::string, Index>& getMapTypeIndexes() const;
+    const std::vector<Index>& getSizesByIndex() const;
+
+private:
+    void load(const std::string& fileName);
+    void setupHalo();
+    void exchangeHalo(Index phase);
+
+    Real localEnergy(const Atom& atom, Real H) const;
+    void monteCarloStep(Real T, Real H);
+    void measure(Real H, std::vector<Real>& values);
+
+    void createOutput();
+    void writeSites();
+    void writePoint(const std::vector<Real>& enes,
+                    const std::vector< std::vector<Real> >& histMag,
+                    Index index);
+    void writeRows(hid_t dset, hid_t memtype, Index elements, Index point,
+                   const std::vector<Index>& ids, const void* values);
+    void writeSiteData(hid_t dset, hid_t memtype, Index elements, Index point,
+                       const std::vector<char>& values);
+    void closeOutput();
+
+    MPI_Comm comm_;
+    int rank_;
+    int size_;
+
+    Index mcs_;
+    Real kb_;
+    Index seed_;
+    std::vector<Real> temps_;
+    std::vector<Real> fields_;
+    std::string outName_;
+
+    Index num_sites_;
+    Index num_types_;
+    std::map<std::string, Index> mapTypeIndexes_;
+    std::map<Index, std::string> mapIndexTypes_;
+    std::vector<Index> sizesByIndex_;
+
+    // Domain (2 * rank + half) of every site of the sample.
+    std::vector<std::uint16_t> domains_;
+
+    // Owned sites first, halo sites after them.
+    std::vector<Atom> atoms_;
+    Index num_local_;
+    std::vector<Index> globalIds_;
+    std::vector<Index> phaseSites_[2];
+
+    std::vector<int> peers_;
+    std::vector< std::vector<Index> > sendSites_[2];
+    std::vector< std::vector<Index> > recvSites_[2];
+
+    std::mt19937_64 engine_;
+    std::uniform_real_distribution<> realRandomGenerator_;
+    std::normal_distribution<> gaussianRandomGenerator_;
+
+    std::vector<Real> sigma_;
+    std::vector<Index> counterRejections_;
+
+    hid_t file_;
+    hid_t energies_dset_;
+    std::vector<hid_t> mags_dset_;
+    hid_t finalstates_dset_;
+    // tau, ess and error of the energy and of the magnetization.
+    std::vector<hid_t> statistics_dsets_;
+};
+
+#endif // DISTRIBUTED_H
@@ -0,0 +1,30 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include "params.h"
+
+#include <complex>
+#include <vector>
+
+typedef std::complex<Real> Complex;
+
+// Smallest power of two greater or equal than n.
+Index nextPowerOfTwo(Index n);
+
+// In-place radix-2 transform of 'n' values separated by 'stride', where 'n'
+// is a power of two. The inverse transform is not normalized.
+void fft(Complex* data, Index n, Index stride, bool inverse);
+
+void fft(std::vector<Complex>& data, bool inverse);
+
+// In-place transform of a grid with dimensions 'dims' (powers of two),
+// stored with the last dimension running fastest.
+void fft3d(std::vector<Complex>& data, const Index dims[3], bool inverse);
+
+// Same transform for zero-padded grids: in the direct transform the data
+// is zero out of the first 'extents' points of each axis, and in the inverse
+// transform only the values in those points are computed. The lines that
+// are all zeros or that are not needed are skipped.
+void fft3d(std::vector<Complex>& data, const Index dims[3], bool inverse, const Index extents[3]);
+
+#endif // FFT_H
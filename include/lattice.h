@@ -6,11 +6,22 @@
 #include <map>
 
 #include "atom.h"
+#include "unitcell.h"
 
 class Lattice
 {
 public:
+    // Reads a sample file. If it's malformed, the lattice is left
+    // incomplete and getError returns the reason.
     Lattice(std::string fileName);
+    // Builds the sample from the repetitions of a unit cell, without
+    // reading any file.
+    Lattice(const UnitCell& cell);
+    // The copies point their neighbors to their own atoms.
+    Lattice(const Lattice& other);
+    Lattice& operator=(const Lattice& other);
+    Lattice(Lattice&& other) = default;
+    Lattice& operator=(Lattice&& other) = default;
     ~Lattice();
 
     std::vector<Atom>& getAtoms();
@@ -19,11 +30,41 @@ public:
     const std::map<Index, std::string>& getMapIndexTypes() const;
     const std::vector<Index>& getSizesByIndex() const;
 
+    // Renumbers the sites to improve the locality of the neighbors in
+    // memory. The method can be 'none', 'morton', 'hilbert' (space-filling
+    // curves over the positions) or 'rcm' (reverse Cuthill-McKee over the
+    // interactions). The original index of each site is kept in the atom.
+    void reorder(const std::string& method);
+
+    // Position in 'atoms_' of the site with the given index in the sample.
+    Index getSiteByIndex(Index index) const;
+
+    // Empty if the sample was read, otherwise the reason why it wasn't.
+    const std::string& getError() const;
+
+    // Measured bytes by site held by the atoms and the index of the sites.
+    Real getMemoryBySite() const;
+
+    // Places the sites on a grid with the given spacing (by default, for
+    // zero components, the smallest separation between the coordinates of
+    // the sites along each axis), storing the used spacing, the amount of
+    // points of the grid along each axis and the three coordinates of each
+    // atom in the grid. Returns an empty string if every site is on the
+    // grid, otherwise the reason why one isn't.
+    std::string mapToGrid(Array& spacing, Index sizes[3], std::vector<Index>& cells);
+
 private:
+    std::string readSample(const std::string& fileName);
+    void remapNeighbors(const Atom* first);
+    std::vector<Index> computeCurveOrder(const std::string& method) const;
+    std::vector<Index> computeCuthillMcKeeOrder() const;
+
     std::vector<Atom> atoms_;
+    std::vector<Index> siteByIndex_;
     std::map<std::string, Index> mapTypeIndexes_;
     std::map<Index, std::string> mapIndexTypes_;
     std::vector<Index> sizesByIndex_;
+    std::string error_;
 
 };
 
@@ -0,0 +1,63 @@
+#ifndef LLG_H
+#define LLG_H
+
+#include "params.h"
+#include "lattice.h"
+
+#include <string>
+#include <vector>
+
+// Deterministic spin dynamics with the Landau-Lifshitz-Gilbert equation in
+// reduced units,
+//
+//     dS/dt = - 1 / (1 + a^2) [S x B + a / |S| S x (S x B)],
+//
+// where a is the damping and B = - dE/dS the effective field of the
+// exchange, Zeeman and anisotropy terms. It is integrated with the Heun
+// scheme, renormalizing the spins after each stage. The fields and torques
+// of all the sites are computed in parallel with OpenMP.
+class LLG
+{
+public:
+    LLG();
+    LLG(Lattice& lattice, Real damping, Real timestep, Index steps);
+
+    // Returns an empty string if the lattice can be simulated with this
+    // engine, otherwise the reason why it can't.
+    static std::string checkLattice(Lattice& lattice);
+
+    void load(Lattice& lattice);
+    void store(Lattice& lattice) const;
+
+    // Advances 'steps' time steps under the field H.
+    void run(Real H);
+
+    Real getDamping() const;
+    Real getTimestep() const;
+    Index getSteps() const;
+
+private:
+    void computeTorques(const std::vector<Real>& spins, Real H, std::vector<Real>& torques) const;
+
+    Real damping_;
+    Real timestep_;
+    Index steps_;
+    Index num_sites_;
+
+    std::vector<Real> spins_;
+    std::vector<Real> norms_;
+    std::vector<Real> externalFields_;
+
+    std::vector<LongIndex> offsets_;
+    std::vector<Index> nbhs_;
+    std::vector<Real> exchanges_;
+
+    std::vector<Index> anisotropyOffsets_;
+    std::vector<AnisotropyTerm> anisotropies_;
+
+    std::vector<Real> predicted_;
+    std::vector<Real> torques_;
+    std::vector<Real> predictedTorques_;
+};
+
+#endif // LLG_H
@@ -0,0 +1,73 @@
+#ifndef MULTISPIN_H
+#define MULTISPIN_H
+
+#include "params.h"
+#include "lattice.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// Multi-spin coded engine for pure Ising ('flip') samples. Each site holds
+// one 64-bit word whose bit r is the spin of the replica r (1 = up). All the
+// replicas share the lattice, but every replica draws its own random numbers,
+// so they evolve as independent Markov chains.
+class MultiSpin
+{
+public:
+    MultiSpin();
+    MultiSpin(Lattice& lattice, Index replicas);
+
+    // Returns an empty string if the lattice can be simulated with this
+    // engine, otherwise the reason why it can't.
+    static std::string checkLattice(Lattice& lattice);
+
+    // Every replica starts from the configuration stored in the atoms.
+    void load(Lattice& lattice);
+    // The configuration of the replica 0 is written back into the atoms.
+    void store(Lattice& lattice) const;
+
+    void prepare(Real T, Real H, Real kb);
+    void monteCarloStep(std::mt19937_64& engine);
+
+    // Energies by replica and magnetizations (z component) by type and
+    // replica. The last type index corresponds to the total magnetization.
+    void measure(Real H,
+                 std::vector<Real>& energies,
+                 std::vector< std::vector<Real> >& magnetizations);
+
+    Index getReplicas() const;
+
+private:
+    typedef std::uint64_t Word;
+
+    Word bernoulli(std::mt19937_64& engine, Word threshold, Word lanes);
+    void countLanes(std::vector<Word>& planes, Word word) const;
+    void extractCounts(const std::vector<Word>& planes, std::vector<Index>& counts) const;
+
+    Index replicas_;
+    Word activeLanes_;
+    Index num_types_;
+    Index maxNbhs_;
+
+    Real spinNorm_;
+    Real exchange_;
+    Real fieldZ_;
+    Real anisotropyEnergy_;
+
+    std::vector<Word> spins_;
+    std::vector<LongIndex> offsets_;
+    std::vector<Index> nbhs_;
+    std::vector<Word> signs_;
+    std::vector<Index> typeIndexes_;
+    std::vector<Index> sizesByIndex_;
+
+    // Thresholds over 2^32 indexed by [nbhs][unsatisfied][spin up].
+    std::vector<Word> thresholds_;
+
+    std::vector<Word> uniforms_;
+    Index numUniforms_;
+};
+
+#endif // MULTISPIN_H
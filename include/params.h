@@ -7,9 +7,21 @@
 typedef double Real;
 typedef std::valarray<Real> Array;
 typedef unsigned int Index;
+
+// Index of the interactions. In the large-sample mode (VEGAS_LARGE_SAMPLES)
+// it has 64 bits, so samples with more than 4e9 interactions can be loaded.
+#ifdef VEGAS_LARGE_SAMPLES
+typedef unsigned long long LongIndex;
+#else
+typedef unsigned int LongIndex;
+#endif
+
 const Array ZERO = {0.0, 0.0, 0.0};
 const Index AMOUNTCHUNKS = 5;
 
+// Amount of sites written to the output at once.
+const Index BLOCKSITES = 65536;
+
 template <typename T>
 std::ostream & operator << (std::ostream &o, std::valarray<T> val)
 {
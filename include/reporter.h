@@ -3,11 +3,34 @@
 
 #include "params.h"
 #include "lattice.h"
+#include "statistics.h"
+#include "timing.h"
 #include "H5Include.h"
 
 #include <string>
 #include <vector>
 #include <map>
+#include <mutex>
+
+// Storage of the time series in the output: steps by chunk (0 for a fifth
+// of the steps), compression ('none', 'deflate', 'shuffle' for shuffle and
+// deflate, or 'lz4' and 'zstd' when HDF5 has their plugins), its level and
+// the precision of the stored values (float32 if 'single').
+struct StorageLayout
+{
+    Index chunk = 0;
+    std::string compression = "deflate";
+    Index level = 1;
+    bool single = false;
+};
+
+// Returns an empty string if the layout can be used, otherwise the reason
+// why it can't.
+std::string checkStorage(const StorageLayout& layout);
+
+// The HDF5 library is not thread safe, so every write of the threads of
+// the points and of the snapshots holds this lock.
+std::mutex& hdf5Lock();
 
 class Reporter
 {
@@ -20,7 +43,8 @@ public:
              const std::vector<Real>& fields,
              Index mcs,
              Index seed,
-             Real kb);
+             Real kb,
+             const StorageLayout& layout);
 
     void partial_report(
         const std::vector<Real>& enes,
@@ -28,10 +52,75 @@ public:
         const std::vector< std::vector<Real> >& histMag_y,
         const std::vector< std::vector<Real> >& histMag_z,
         Lattice& lattice, Index index);
+
+    // Integrated autocorrelation time, effective sample size and error bar
+    // of the mean of the energy and of |M| of the point 'index'.
+    void statistics_report(
+        const SeriesStatistics& energy,
+        const SeriesStatistics& magnetization,
+        Index index);
+
+    // Textual state of the random generator and widths of the moves of
+    // each type at the end of the point 'index'.
+    void restart_report(const std::string& rngState, const std::vector<Real>& sigma, Index index);
+
+    // Datasets with the time series of every replica of the
+    // multi-spin coding engine, with shape (points, replicas, mcs).
+    void createReplicaDatasets(Index numPoints, Index replicas, Index mcs);
+    void replica_report(
+        const std::vector< std::vector<Real> >& enes,
+        const std::vector< std::vector<Real> >& mags,
+        Index index);
+    // Datasets with the amount of steps of each point and the steps
+    // discarded for its equilibration, for the adaptive mode. Both are
+    // given in steps, even when the series keep one value by record.
+    void createAdaptiveDatasets(Index numPoints);
+    void adaptive_report(Index used, Index equilibration, Index index);
+    // Attributes of the records of 'steps' of the 'mcs' steps and, for the
+    // averages of blocks, datasets with the mean of |M| of each type and of
+    // the whole sample in each block (<type>_norm and magnetization_norm)
+    // and the variances of them and of the energy in each block
+    // (<type>_variance, magnetization_variance and energy_variance), of
+    // shape (points, records).
+    void createRecordDatasets(Index numPoints, Index mcs, Index steps, bool blocks, Lattice& lattice);
+    void block_report(
+        const std::vector<Real>& eneVariances,
+        const std::vector< std::vector<Real> >& magNorms,
+        const std::vector< std::vector<Real> >& magVariances,
+        Index index);
+    // Extendable datasets with the configurations taken during the points,
+    // with shape (snapshots, sites, 3), and the point and the step of each
+    // one.
+    void createSnapshotDatasets(Index numSites);
+    void snapshot_report(Index point, Index step, const double* spins);
+    // Dataset with the structure factor of each point, pair of types and
+    // wave vector, with shape (points, pairs, vectors), and the datasets
+    // with the wave vectors and the names of the pairs.
+    void createStructureDatasets(Index numPoints, const std::vector<Array>& vectors, Lattice& lattice);
+    void structure_report(const std::vector<Real>& values, Index index);
+    // Datasets with the correlation function of each point by bin of
+    // distance, with shape (points, bins), its second-moment correlation
+    // length, and the mean distance and the amount of pairs of each bin.
+    void createCorrelationDatasets(Index numPoints, const std::vector<Real>& distances, const std::vector<Real>& pairs);
+    void correlation_report(const std::vector<Real>& values, Real length, Index index);
+    // Group 'timing' with the seconds of each phase of each point, their
+    // total, the trials by second of the sweeps and the acceptance of each
+    // type, with shape (points, types).
+    void createTimingDatasets(Index numPoints, Index numTypes);
+    void timing_report(const Timing& timing, Index index);
     void close();
     ~Reporter();
 
 private:
+    // Type and creation properties of the time series of shape 'dims',
+    // whose last dimension runs over the steps.
+    hid_t seriesType() const;
+    hid_t seriesProperties(int rank, const hsize_t* dims) const;
+    // Creation properties with the compression of the layout and chunks of
+    // shape 'chunk'.
+    hid_t compressedProperties(int rank, const hsize_t* chunk) const;
+    void writeSites(hid_t dset, hid_t memtype, Index point, Index begin, Index count, const void* data);
+
     hid_t       file, space, filetype, memtype;
     hid_t       dataspace_id_energy, memspace_id_;
     hid_t       memspace_id_mag;
@@ -54,6 +143,11 @@ private:
     hid_t types_dset;
     hid_t finalstates_dset;
 
+    // tau, ess and error of the energy and of the magnetization.
+    std::vector<hid_t> statistics_dsets_;
+    hid_t rng_dset;
+    hid_t sigma_dset;
+
     hsize_t     count_[2];              /* size of subset in the file */
     hsize_t     start_[2];             /* subset offset in the file */
     hsize_t     stride_[2];
@@ -63,15 +157,38 @@ private:
 
 
 
-    hid_t       memspace_id_finalstates, dataspace_id_finalstates;
-    hsize_t     count_finalstates[3];              /* size of subset in the file */
-    hsize_t     start_finalstates[3];             /* subset offset in the file */
-    hsize_t     stride_finalstates[3];
-    hsize_t     block_finalstates[3];
+    Index replicas_;
+    hid_t replicas_energy_dset;
+    hid_t replicas_mag_dset;
+    Index replicas_mcs_;
+
+    StorageLayout layout_;
+
+    bool adaptive_;
+    hid_t used_dset;
+    hid_t equilibration_dset;
+
+    // Means of |M| and variances of |M| of each type and of the whole
+    // sample, like the magnetization datasets, and variances of the energy.
+    std::vector<hid_t> block_dsets_;
+
+    bool snapshots_;
+    Index numSnapshots_;
+    hid_t snapshots_dset;
+    hid_t snapshot_point_dset;
+    hid_t snapshot_mcs_dset;
 
-    hsize_t     dims_select_finalstates[1];
+    bool structure_;
+    hid_t structure_dset;
 
+    bool correlation_;
+    hid_t correlation_dset;
+    hid_t correlation_length_dset;
 
+    bool timing_;
+    hid_t timing_group;
+    std::vector<hid_t> timing_dsets_;
+    hid_t acceptance_dset;
 
 };
 
@@ -0,0 +1,48 @@
+#ifndef REWEIGHTING_H
+#define REWEIGHTING_H
+
+#include "params.h"
+
+#include <vector>
+
+// Ferrenberg-Swendsen multiple histogram reweighting. The time series of
+// several simulations at the same field and different temperatures are
+// combined into an estimate of the density of states, so the averages can
+// be computed at any temperature between the simulated ones. The samples
+// are used directly, without binning the energies.
+class MultiHistogram
+{
+public:
+    // Each sample of 'observables' holds 'numObservables' values; the
+    // energy is always the first observable.
+    explicit MultiHistogram(Index numObservables);
+
+    void addSimulation(Real beta,
+                       const std::vector<Real>& energies,
+                       const std::vector<Real>& observables);
+
+    // Iterates the free energies of the simulations until they change less
+    // than 'tolerance'. Returns the amount of iterations.
+    Index solve(Index threads, Real tolerance, Index maxIterations);
+
+    // Mean and variance of each observable (the energy first) at 'beta'.
+    void moments(Real beta, Index threads,
+                 std::vector<Real>& means,
+                 std::vector<Real>& variances) const;
+
+private:
+    void computeDenominators(Index threads);
+    Real logPartition(Real beta, Index threads) const;
+
+    Index numObservables_;
+    std::vector<Real> betas_;
+    std::vector<Real> logSizes_;
+    std::vector<Real> freeEnergies_;
+
+    std::vector<Real> energies_;
+    std::vector<Real> observables_;
+    // log sum_m N_m exp(f_m - beta_m E_t) for each sample.
+    std::vector<Real> logDenominators_;
+};
+
+#endif // REWEIGHTING_H
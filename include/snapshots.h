@@ -0,0 +1,55 @@
+#ifndef SNAPSHOTS_H
+#define SNAPSHOTS_H
+
+#include "params.h"
+#include "lattice.h"
+#include "reporter.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Writer of the configurations taken during the points. The spins are
+// copied into one of a fixed amount of buffers, and a background thread
+// writes each buffer to the output at once, so the sweeps only wait when
+// all the buffers are in flight and the memory is bounded.
+class SnapshotWriter
+{
+public:
+    SnapshotWriter(Reporter& reporter, Index numSites, Index buffers);
+    ~SnapshotWriter();
+    SnapshotWriter(const SnapshotWriter& other) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter& other) = delete;
+
+    // Queues the configuration of the lattice at the step 'step' of the
+    // point 'point'. It can be called from several threads.
+    void push(Lattice& lattice, Index point, Index step);
+
+    // Writes the queued snapshots and stops the thread.
+    void finish();
+
+private:
+    void run();
+
+    struct Snapshot
+    {
+        Index buffer;
+        Index point;
+        Index step;
+    };
+
+    Reporter& reporter_;
+    std::vector< std::vector<double> > buffers_;
+    std::vector<Index> free_;
+    std::deque<Snapshot> queue_;
+    bool finished_;
+
+    std::mutex mutex_;
+    std::condition_variable queued_;
+    std::condition_variable released_;
+    std::thread thread_;
+};
+
+#endif // SNAPSHOTS_H
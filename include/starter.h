@@ -6,7 +6,11 @@
 #include "rlutil.h"
 
 #include <iostream>
+#include <iomanip>
 #include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <limits>
 #include <string>
 #include <tuple>
 
@@ -22,6 +26,11 @@ namespace STARTER {
                const std::vector<Real>& temps,
                const std::vector<Real>& fields);
 
+    // Function to check the issues of the simulation points
+    void CHECKPOINTS(Index mcs,
+                     const std::vector<Real>& temps,
+                     const std::vector<Real>& fields);
+
     // Fn case that the initial state is given,
     // this function checks if the file exists.
     void CHECKFILE(std::string filename);
@@ -43,6 +52,28 @@ namespace STARTER {
 
 
 
+    // Function to read the temperatures and fields of each point
+    void READ_POINTS(const Json::Value& root,
+                     std::vector<Real>& temps,
+                     std::vector<Real>& fields);
+
+    // Function to read the unit cell of a sample given like a dictionary
+    UnitCell READ_UNITCELL(const Json::Value& json);
+
+    // Function to print the estimated memory of each subsystem from
+    // the size of the sample, before it is loaded
+    void PRINT_MEMORY(Index num_ions,
+                      LongIndex num_interactions,
+                      Index num_types,
+                      Index mcs,
+                      Index num_anisotropies,
+                      Index num_snapshots,
+                      const std::string& engine);
+
+    // Function to print the estimated memory of the simulation described
+    // by a json file without running it
+    void ESTIMATE(std::string jsonfile);
+
     // Function to create a system from a json file
     System CREATE_SYSTEM(std::string jsonfile, bool print);
 }
@@ -0,0 +1,44 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include "params.h"
+
+#include <vector>
+
+// Fraction of each time series discarded for the thermalization, the same
+// of the analyzers (tau = mcs // 5).
+const Index THERMALIZATION_FRACTION = 5;
+
+// Statistics of a correlated time series.
+struct SeriesStatistics
+{
+    Real mean;
+    Real variance;
+    // Integrated autocorrelation time, in MCS.
+    Real tau;
+    // Effective amount of independent samples, n / (2 tau).
+    Real ess;
+    // Error bar of the mean, sqrt(variance / ess).
+    Real error;
+};
+
+// Statistics of series[begin:]. The autocorrelation function is computed
+// with FFTs in O(n log n), and it is summed up to the first window W with
+// W >= 5 tau(W) (Sokal's automatic windowing).
+SeriesStatistics analyzeSeries(const std::vector<Real>& series, Index begin);
+
+// Length of the initial transient of a series with the MSER rule: the
+// truncation of the first d steps that minimizes the squared error of the
+// mean of the rest, var(series[d:]) / (n - d), searched in batches of
+// 'batch' steps over the first half. It returns the size of the series if
+// the minimum is at the end of the search, where the series still drifts.
+Index equilibrationMSER(const std::vector<Real>& series, Index batch);
+
+// Replaces the last 'steps' values of the series by one record: the last
+// of them or, with 'blocks', their mean. The variance of the block (divided
+// by 'steps', so the mean of the variances plus the variance of the means
+// is the variance of the whole series) is appended to 'variances' if it
+// isn't null.
+void recordTail(std::vector<Real>& series, Index steps, bool blocks, std::vector<Real>* variances);
+
+#endif // STATISTICS_H
@@ -0,0 +1,68 @@
+#ifndef STRUCTURE_H
+#define STRUCTURE_H
+
+#include "params.h"
+#include "lattice.h"
+#include "fft.h"
+
+#include <string>
+#include <vector>
+
+// Static spin structure factor of each pair of types (a, b), a <= b,
+//
+//     S_ab(q) = (1 / N) < Re[F_a(q) . F_b(q)*] >,   F_a(q) = sum_{i in a} S_i exp(i q . r_i)
+//
+// averaged over the configurations measured during a point. The factor is
+// computed on a list of wave vectors, in O(N) for each one, or on all the
+// wave vectors of the grid of the sites, 2 pi m / (dims spacing), with
+// FFTs in O(N log N).
+class StructureFactor
+{
+public:
+    StructureFactor();
+
+    // Returns an empty string if the wave vectors can be used, otherwise
+    // the reason why they can't.
+    std::string setVectors(Lattice& lattice, const std::vector<Array>& vectors);
+
+    // Returns an empty string if the sites of the lattice can be mapped to
+    // a grid with the given spacing (automatic for zero components),
+    // otherwise the reason why they can't. The grid has the smallest
+    // powers of two of points which hold the sample.
+    std::string mapLattice(Lattice& lattice, Array spacing);
+
+    bool isEnabled() const;
+    const std::vector<Array>& getVectors() const;
+    Index getNumPairs() const;
+    Index getMeasurements() const;
+
+    // Clears the measurements of the previous point.
+    void reset();
+    void measure(Lattice& lattice);
+
+    // Mean over the measurements, with the wave vectors running fastest
+    // for each pair, or NaN without measurements.
+    std::vector<Real> getMean() const;
+
+private:
+    Index pairIndex(Index a, Index b) const;
+
+    bool enabled_;
+    bool grid_;
+    Index numTypes_;
+    Index numSites_;
+    Index measurements_;
+
+    std::vector<Array> vectors_;
+    std::vector<Real> positions_;
+    std::vector<Index> types_;
+
+    Index dims_[3];
+    std::vector<Index> gridIndexes_;
+    // Transform of each component of the spins of each type.
+    std::vector< std::vector<Complex> > transforms_;
+
+    std::vector<Real> sums_;
+};
+
+#endif // STRUCTURE_H
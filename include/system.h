@@ -5,7 +5,26 @@
 #include <cmath>
 #include "lattice.h"
 #include "reporter.h"
+#include "multispin.h"
+#include "dipolar.h"
+#include "wanglandau.h"
+#include "llg.h"
+#include "snapshots.h"
+#include "structure.h"
+#include "correlation.h"
+#include "timing.h"
 
+#include <memory>
+
+
+// Orders in which the sites are visited by the Metropolis sweeps.
+enum class SweepOrder : std::uint8_t
+{
+    RANDOM, SEQUENTIAL, STRIDED
+};
+
+// Slots of the cache of acceptances of the discrete models.
+const Index ACCEPTANCESLOTS = 64;
 
 class System
 {
@@ -17,6 +36,13 @@ public:
            Index seed,
            std::string outName,
            Real kb);
+    System(const UnitCell& cell,
+           std::vector<Real> temps,
+           std::vector<Real> fields,
+           Index mcs,
+           Index seed,
+           std::string outName,
+           Real kb);
     ~System();
 
     void ComputeMagnetization();
@@ -40,11 +66,95 @@ public:
 
     const std::map<std::string, Array>& getMagnetizationType() const;
 
-    void setState(std::string fileState);
+    // A negative row is the last point of a previous output.
+    void setState(std::string fileState, int row);
 
     void setAnisotropies(std::vector<std::string> anisotropyfiles);
 
+    void setEngine(std::string engine, Index replicas);
+    const std::string& getEngine() const;
+
+    // Parameters of the Wang-Landau engine. The range of energies is
+    // estimated from the temperatures of the points when minimum >= maximum.
+    void setWangLandau(Index bins, Real flatness, Real finalLogF, Real minimum, Real maximum);
+    const WangLandau& getWangLandau() const;
+
+    // Parameters of the LLG engine: damping, time step and amount of time
+    // steps between two samples of the time series.
+    void setLLG(Real damping, Real timestep, Index steps);
+    const LLG& getLLG() const;
+
+    // The points are simulated in parallel, each one from the state before
+    // the sweep instead of the final state of the previous point.
+    void setIndependent(bool independent);
+    bool getIndependent() const;
+
+    void setSweep(std::string sweep, Index stride);
+    const std::string& getSweep() const;
+
+    void setDipolar(Real strength, Array spacing, Index refresh);
+    const Dipolar& getDipolar() const;
+
+    // Each point stops once its energy is equilibrated and the error of the
+    // mean energy per site is below 'error', after at least 'minimum' and
+    // at most 'mcs' steps. A zero error runs all the steps.
+    void setAdaptive(Real error, Index minimum);
+    Real getAdaptiveError() const;
+    Index getMinimumMcs() const;
+
+    // The time series keep one record every 'steps' steps: the last step
+    // or, with 'blocks', the mean of the steps and the variance of the
+    // energy and of the magnetization of each type in the block.
+    void setRecord(Index steps, bool blocks);
+    Index getRecordSteps() const;
+    bool getRecordBlocks() const;
+
+    // The configuration is written every 'every' steps (never if 0) by a
+    // background thread, with at most 'buffers' snapshots in flight.
+    void setSnapshots(Index every, Index buffers);
+    Index getSnapshotSteps() const;
+    Index getSnapshotBuffers() const;
+
+    // The structure factor of each pair of types is measured every 'every'
+    // steps after the thermalization, on the given wave vectors or, if
+    // there are none, on the ones of the grid of the sites with the given
+    // spacing.
+    void setStructure(const std::vector<Array>& vectors, Array spacing, Index every);
+    const StructureFactor& getStructure() const;
+    Index getStructureSteps() const;
+
+    // The correlation function up to 'cutoff', in bins of width 'width',
+    // and the correlation length are measured every 'every' steps after
+    // the thermalization.
+    void setCorrelation(Real cutoff, Real width, Index every);
+    const Correlation& getCorrelation() const;
+    Index getCorrelationSteps() const;
+
+    // The times of the phases of each point are always written to the
+    // output, and also to stderr as lines of JSON if enabled.
+    void setTimingStderr(bool enabled);
+    bool getTimingStderr() const;
+
+    // Chunks, compression and precision of the time series in the output.
+    void setStorage(const StorageLayout& layout);
+    const StorageLayout& getStorage() const;
+
 private:
+    void adaptSigma();
+    Real acceptance(Real deltaEnergy, Real kT);
+    std::string restoreGenerator(const std::string& fileName, int row);
+    void wangLandauCycle();
+    void independentCycle();
+    void simulatePoint(Index index);
+    void printProgress(Index index, Index done, Real seconds);
+
+    void initialize(std::vector<Real> temps,
+                    std::vector<Real> fields,
+                    Index mcs,
+                    Index seed,
+                    std::string outName,
+                    Real kb);
+
     Lattice lattice_;
     Index mcs_;
     Real kb_;
@@ -63,9 +173,56 @@ private:
     Reporter reporter_;
 
     std::vector<Real> sigma_;
+
+    // Cache of exp(- dE / kT) for the discrete models.
+    Real acceptanceKT_;
+    std::vector<Real> acceptanceKeys_;
+    std::vector<Real> acceptanceValues_;
+    // Sum of the ranges of the anisotropy terms of each site.
+    std::vector<Real> anisotropyRanges_;
     std::vector<Index> counterRejections_;
 
     Index num_types_;
+
+    // The name of the order is kept for the output, and the order itself
+    // is resolved once, out of the sweeps.
+    std::string sweep_;
+    SweepOrder sweepOrder_;
+    Index stride_;
+
+    std::string engineType_;
+    MultiSpin multiSpin_;
+
+    Dipolar dipolar_;
+
+    LLG llg_;
+
+    WangLandau wangLandau_;
+    Real wangLandauRange_[2];
+
+    bool independent_;
+
+    Real adaptiveError_;
+    Index minimumMcs_;
+
+    Index recordSteps_;
+    bool recordBlocks_;
+
+    Index snapshotSteps_;
+    Index snapshotBuffers_;
+    // Shared by the copies of the independent points.
+    std::shared_ptr<SnapshotWriter> snapshots_;
+
+    StructureFactor structure_;
+    Index structureSteps_;
+
+    Correlation correlation_;
+    Index correlationSteps_;
+
+    Timing timing_;
+    bool timingStderr_;
+
+    StorageLayout storage_;
 };
 
 #endif
@@ -0,0 +1,71 @@
+#ifndef TEXTFILE_H
+#define TEXTFILE_H
+
+#include "params.h"
+
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read-only view of a text file mapped in memory. The inputs are parsed
+// straight from the mapping with std::from_chars, without locales, streams
+// nor allocations by value, so large files can be split into chunks of
+// whole lines and parsed in parallel.
+class TextFile
+{
+public:
+    TextFile();
+    ~TextFile();
+    TextFile(const TextFile& other) = delete;
+    TextFile& operator=(const TextFile& other) = delete;
+
+    // Returns an empty string if the file can be mapped, otherwise the
+    // reason why it can't.
+    std::string open(const std::string& fileName);
+
+    const char* begin() const;
+    const char* end() const;
+
+    // Starts of the chunks of about 'bytes' bytes in which [from, end) is
+    // split, every one at the beginning of a line except the first.
+    std::vector<const char*> splitLines(const char* from, std::size_t bytes) const;
+
+private:
+    const char* data_;
+    std::size_t size_;
+    // Contents of the file where it can't be mapped.
+    std::vector<char> buffer_;
+};
+
+// End of the line which starts at 'begin', without its newline.
+const char* lineEnd(const char* begin, const char* end);
+
+// Splits the line [begin, end) into at most 'maximum' tokens separated by
+// blanks, and returns the amount of tokens, which is 'maximum + 1' when
+// there are more.
+Index splitTokens(const char* begin, const char* end, std::string_view* tokens, Index maximum);
+
+// Next token of [p, end), skipping blanks and newlines, with the number of
+// the line where it is. Returns false at the end of the text.
+bool nextToken(const char*& p, const char* end, Index& line, std::string_view& token);
+
+// Reads the first 'rows' non blank lines of the file as rows of numbers,
+// each with one of the amounts of values in 'widths'. The rows are stored
+// in 'values' with as many values as the largest width, and the amount of
+// values of each row in 'rowWidths'. Returns the reason of the first
+// malformed line, or an empty string.
+std::string readNumberRows(const TextFile& file, Index rows, const std::vector<Index>& widths,
+                           std::vector<Real>& values, std::vector<Index>& rowWidths);
+
+// Parses the whole token as a number, returning false if it isn't one.
+template <typename T>
+bool parseNumber(std::string_view token, T& value)
+{
+    if (!token.empty() && token.front() == '+')
+        token.remove_prefix(1);
+    auto result = std::from_chars(token.data(), token.data() + token.size(), value);
+    return result.ec == std::errc() && result.ptr == token.data() + token.size();
+}
+
+#endif // TEXTFILE_H
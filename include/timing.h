@@ -0,0 +1,60 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include "params.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Phases of the simulation of a point.
+enum TimingPhase
+{
+    SWEEP,          // Steps of the engine, and its preparation.
+    MEASUREMENT,    // Energy, magnetizations and their series.
+    SIGMA,          // Adaptation of the widths of the moves.
+    OBSERVABLES,    // Snapshots, structure factor and correlation function.
+    ANALYSIS,       // Checks of the adaptive mode and statistics.
+    WRITE,          // Writes to the output, with the wait for the lock.
+    NUM_PHASES
+};
+
+// Names of the phases in the output.
+const std::string TIMING_NAMES[NUM_PHASES] = {"sweep", "measurement", "sigma",
+                                              "observables", "analysis", "write"};
+
+// Wall time of each phase of a point, measured with a monotonic clock, and
+// the trials and rejections of the moves of each type. Each call to lap()
+// costs one read of the clock, so it's cheap next to a sweep.
+class Timing
+{
+public:
+    Timing();
+
+    // Starts the clock of a new point.
+    void start(Index numTypes);
+    // Adds the time since the previous lap to the given phase.
+    void lap(TimingPhase phase);
+
+    void addTrials(double trials);
+    void addMoves(Index type, double trials, double rejections);
+
+    Real getSeconds(TimingPhase phase) const;
+    Real getTotal() const;
+    Real getTrialsPerSecond() const;
+    // Fraction of accepted moves of each type, NaN for the engines
+    // without rejections.
+    std::vector<Real> getAcceptances() const;
+
+    // The times of the point as a line of JSON.
+    std::string json(Index index, Real T, Real H, const std::vector<std::string>& types) const;
+
+private:
+    std::chrono::steady_clock::time_point last_;
+    Real seconds_[NUM_PHASES];
+    double trials_;
+    std::vector<double> trialsByType_;
+    std::vector<double> rejectionsByType_;
+};
+
+#endif // TIMING_H
@@ -0,0 +1,97 @@
+#ifndef UNITCELL_H
+#define UNITCELL_H
+
+#include "params.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Site of the basis of the unit cell. The position is given in cartesian
+// coordinates, in the same units of the lattice vectors.
+struct BasisSite
+{
+    Array position;
+    Real spinNorm;
+    Array field;
+    std::string type;
+    std::string model;
+};
+
+// Exchange constant between the sites of the types 'types' (in any order)
+// which are separated by 'distance'.
+struct ExchangeShell
+{
+    std::string types[2];
+    Real distance;
+    Real exchange;
+};
+
+// Interaction of a basis site with the basis site 'target' of the cell
+// displaced 'offset' cells.
+struct StencilBond
+{
+    Index target;
+    int offset[3];
+    Real exchange;
+};
+
+// Description of a crystal as a unit cell repeated 'size' times along the
+// lattice vectors. The neighbors of each basis site are searched once in
+// the cells around it (a cell list whose bins are the unit cells), so the
+// interactions of the whole sample are built in O(N) from this stencil.
+class UnitCell
+{
+public:
+    UnitCell();
+    UnitCell(const std::vector<Array>& vectors,
+             const std::vector<BasisSite>& basis,
+             const std::vector<Index>& size,
+             const std::vector<bool>& periodic,
+             const std::vector<ExchangeShell>& shells,
+             Real tolerance);
+
+    // Returns an empty string if the description is valid, otherwise the
+    // reason why it isn't.
+    std::string check() const;
+
+    void computeStencil();
+
+    const std::vector<Array>& getVectors() const;
+    const std::vector<BasisSite>& getBasis() const;
+    const std::vector< std::vector<StencilBond> >& getStencil() const;
+
+    // The amounts are counted in 64 bits in every build, so the samples
+    // whose sites don't fit in an Index or whose interactions don't fit in
+    // a LongIndex can be rejected.
+    std::uint64_t getNumCells() const;
+    std::uint64_t getNumSites() const;
+    std::uint64_t getNumInteractions() const;
+    std::vector<std::string> getTypes() const;
+
+    // Coordinates along the lattice vectors of the cell with the given
+    // index. The cells are numbered with the last axis running fastest.
+    void getCellPosition(Index cell, int position[3]) const;
+
+    // Position in the sample of the basis site 'site' of the cell 'cell'.
+    Array getPosition(const int cell[3], Index site) const;
+
+    // Index in the sample of the basis site 'site' of the cell displaced
+    // 'offset' from 'cell'. It returns false if that cell is out of a
+    // non periodic border or if the site is its own periodic image.
+    bool getNeighbor(const int cell[3], Index site, const StencilBond& bond, Index& index) const;
+
+private:
+    Real determinant() const;
+
+    std::vector<Array> vectors_;
+    std::vector<BasisSite> basis_;
+    std::vector<Index> size_;
+    std::vector<bool> periodic_;
+    std::vector<ExchangeShell> shells_;
+    Real tolerance_;
+
+    std::vector< std::vector<StencilBond> > stencil_;
+};
+
+#endif // UNITCELL_H
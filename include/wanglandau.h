@@ -0,0 +1,82 @@
+#ifndef WANGLANDAU_H
+#define WANGLANDAU_H
+
+#include "params.h"
+
+#include <string>
+#include <vector>
+
+// Density of states g(E) estimated with the Wang-Landau algorithm over a
+// range of energies divided in bins. A move to the bin b is accepted with
+// probability min(1, g(a) / g(b)); the current bin is then increased by
+// ln f, and ln f is halved each time the histogram of visits is flat. Once
+// ln g(E) is known, the averages at any temperature are sums over the bins.
+class WangLandau
+{
+public:
+    WangLandau();
+    WangLandau(Index bins, Real flatness, Real finalLogF);
+
+    // The range of energies, [minimum, maximum).
+    void setRange(Real minimum, Real maximum);
+
+    bool isEnabled() const;
+    Index getBins() const;
+    Real getFlatness() const;
+    Real getFinalLogF() const;
+    Real getLogF() const;
+    Real getMinimum() const;
+    Real getMaximum() const;
+
+    // Bin of an energy, or -1 if it's out of the range.
+    long getBin(Real energy) const;
+
+    // ln g(from) - ln g(to), the log of the acceptance of a move.
+    Real logAcceptance(long from, long to) const;
+
+    // Updates ln g and the histogram of the current bin, with the energy
+    // and the absolute magnetization of the current state.
+    void visit(long bin, Real energy, Real magnetization);
+
+    // Flatness of the histogram over the bins visited since the beginning.
+    bool isFlat() const;
+
+    // Halves ln f and clears the histogram. Returns false, without any
+    // change, when ln f would fall below the final one.
+    bool nextStage();
+
+    // Mean and variance of the energy and of the absolute magnetization at
+    // temperature T.
+    void thermodynamics(Real T, Real kb,
+                        Real& energy, Real& energyVariance,
+                        Real& magnetization, Real& magnetizationVariance) const;
+
+    // ln g normalized to zero in its lowest visited bin (NaN in the bins
+    // never visited), and the centers of the bins.
+    std::vector<Real> getLogDensity() const;
+    std::vector<Real> getEnergies() const;
+
+    // Writes ln g(E) and the averages at each temperature into an HDF5 file.
+    void write(const std::string& fileName,
+               const std::vector<Real>& temps,
+               Real H, Real kb, Index seed, Index num_sites) const;
+
+private:
+    Index bins_;
+    Real flatness_;
+    Real finalLogF_;
+    Real logF_;
+    Real minimum_;
+    Real width_;
+
+    std::vector<Real> logDensity_;
+    std::vector<unsigned long long> histogram_;
+    std::vector<bool> visited_;
+
+    // Sums of E, |M| and M^2 by bin during the current stage.
+    std::vector<Real> energy_;
+    std::vector<Real> magnetization_;
+    std::vector<Real> magnetization2_;
+};
+
+#endif // WANGLANDAU_H
@@ -0,0 +1,506 @@
+#include "../include/analyzer.h"
+#include "../include/reweighting.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <thread>
+
+// Amount of values of each time series read at once.
+const Index CHUNKSTEPS = 65536;
+
+// Running mean and variance of a series (Welford's algorithm).
+struct Moments
+{
+    double count = 0.0;
+    double mean = 0.0;
+    double m2 = 0.0;
+
+    void add(double value)
+    {
+        count += 1.0;
+        double delta = value - mean;
+        mean += delta / count;
+        m2 += delta * (value - mean);
+    }
+
+    double variance() const
+    {
+        return m2 / count;
+    }
+};
+
+// Shortest representation of a number which is read back to the same
+// value, in the format of the python floats.
+std::string pythonRepr(double value)
+{
+    if (std::isnan(value))
+        return "nan";
+    if (std::isinf(value))
+        return (value > 0) ? "inf" : "-inf";
+
+    char buffer[64];
+    char* end = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::scientific).ptr;
+    std::string scientific(buffer, end);
+
+    std::size_t e = scientific.find('e');
+    int exponent = std::stoi(scientific.substr(e + 1));
+    if (exponent < -4 || exponent >= 16)
+        return scientific;
+
+    std::string sign = (scientific[0] == '-') ? "-" : "";
+    std::string digits;
+    for (std::size_t i = sign.size(); i < e; ++i)
+        if (scientific[i] != '.')
+            digits += scientific[i];
+
+    if (exponent < 0)
+        return sign + "0." + std::string(- exponent - 1, '0') + digits;
+
+    if (digits.size() <= std::size_t(exponent + 1))
+        return sign + digits + std::string(exponent + 1 - digits.size(), '0') + ".0";
+    return sign + digits.substr(0, exponent + 1) + "." + digits.substr(exponent + 1);
+}
+
+Analyzer::Analyzer()
+{
+    this -> file_ = -1;
+    this -> mcs_ = 0;
+    this -> seed_ = 0;
+    this -> kb_ = 1.0;
+    this -> num_sites_ = 0;
+    this -> blockAverages_ = false;
+}
+
+Analyzer::~Analyzer()
+{
+    for (auto&& dset : this -> series_)
+        H5Dclose(dset);
+    if (this -> file_ >= 0)
+        H5Fclose(this -> file_);
+}
+
+std::string Analyzer::load(const std::string& fileName)
+{
+    H5Eset_auto(H5E_DEFAULT, NULL, NULL);
+    this -> file_ = H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    if (this -> file_ < 0)
+        return "the file can't be open";
+
+    const char* names[7] = {"energy", "magnetization_x", "magnetization_y", "magnetization_z", "temperature", "field", "positions"};
+    for (auto&& name : names)
+        if (H5Lexists(this -> file_, name, H5P_DEFAULT) <= 0)
+            return "the dataset " + std::string(name) + " does not exist";
+    for (auto&& name : {"mcs", "seed"})
+        if (H5Aexists(this -> file_, name) <= 0)
+            return "the attribute " + std::string(name) + " does not exist";
+
+    hid_t attr = H5Aopen(this -> file_, "mcs", H5P_DEFAULT);
+    H5Aread(attr, H5T_NATIVE_UINT, &this -> mcs_);
+    H5Aclose(attr);
+
+    // The steps are counted in records from here on, like the series.
+    Index steps = 1;
+    if (H5Aexists(this -> file_, "steps_by_record") > 0)
+    {
+        attr = H5Aopen(this -> file_, "steps_by_record", H5P_DEFAULT);
+        H5Aread(attr, H5T_NATIVE_UINT, &steps);
+        H5Aclose(attr);
+        if (steps < 1)
+            return "the attribute steps_by_record is not positive";
+        this -> mcs_ /= steps;
+    }
+    attr = H5Aopen(this -> file_, "seed", H5P_DEFAULT);
+    H5Aread(attr, H5T_NATIVE_INT, &this -> seed_);
+    H5Aclose(attr);
+    if (H5Aexists(this -> file_, "kb") > 0)
+    {
+        attr = H5Aopen(this -> file_, "kb", H5P_DEFAULT);
+        H5Aread(attr, H5T_NATIVE_DOUBLE, &this -> kb_);
+        H5Aclose(attr);
+    }
+
+    hid_t dset = H5Dopen(this -> file_, "temperature", H5P_DEFAULT);
+    hid_t space = H5Dget_space(dset);
+    this -> temps_ = std::vector<Real>(H5Sget_simple_extent_npoints(space));
+    H5Dread(dset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, this -> temps_.data());
+    H5Sclose(space);
+    H5Dclose(dset);
+
+    dset = H5Dopen(this -> file_, "field", H5P_DEFAULT);
+    this -> fields_ = std::vector<Real>(this -> temps_.size());
+    H5Dread(dset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, this -> fields_.data());
+    H5Dclose(dset);
+
+    // The outputs of the adaptive mode give the length of each series and
+    // its steps of equilibration, instead of the fifth of the series.
+    if (H5Lexists(this -> file_, "mcs_used", H5P_DEFAULT) > 0 &&
+        H5Lexists(this -> file_, "equilibration", H5P_DEFAULT) > 0)
+    {
+        this -> used_ = std::vector<Index>(this -> temps_.size());
+        this -> equilibration_ = std::vector<Index>(this -> temps_.size());
+        dset = H5Dopen(this -> file_, "mcs_used", H5P_DEFAULT);
+        H5Dread(dset, H5T_NATIVE_UINT, H5S_ALL, H5S_ALL, H5P_DEFAULT, this -> used_.data());
+        H5Dclose(dset);
+        dset = H5Dopen(this -> file_, "equilibration", H5P_DEFAULT);
+        H5Dread(dset, H5T_NATIVE_UINT, H5S_ALL, H5S_ALL, H5P_DEFAULT, this -> equilibration_.data());
+        H5Dclose(dset);
+        for (Index point = 0; point < this -> temps_.size(); ++point)
+        {
+            this -> used_.at(point) /= steps;
+            this -> equilibration_.at(point) /= steps;
+        }
+    }
+
+    std::string reason = this -> readTypes();
+    if (reason != "")
+        return reason;
+
+    this -> series_.push_back(H5Dopen(this -> file_, "energy", H5P_DEFAULT));
+    this -> series_.push_back(H5Dopen(this -> file_, "magnetization_x", H5P_DEFAULT));
+    this -> series_.push_back(H5Dopen(this -> file_, "magnetization_y", H5P_DEFAULT));
+    this -> series_.push_back(H5Dopen(this -> file_, "magnetization_z", H5P_DEFAULT));
+    for (auto&& type : this -> types_)
+    {
+        for (auto&& axis : {"_x", "_y", "_z"})
+        {
+            std::string name = type + axis;
+            if (H5Lexists(this -> file_, name.c_str(), H5P_DEFAULT) <= 0)
+                return "the dataset " + name + " does not exist";
+            this -> series_.push_back(H5Dopen(this -> file_, name.c_str(), H5P_DEFAULT));
+        }
+    }
+
+    if (H5Aexists(this -> file_, "block_averages") > 0)
+    {
+        int averages = 0;
+        attr = H5Aopen(this -> file_, "block_averages", H5P_DEFAULT);
+        H5Aread(attr, H5T_NATIVE_INT, &averages);
+        H5Aclose(attr);
+        this -> blockAverages_ = averages != 0;
+    }
+    if (this -> blockAverages_)
+    {
+        std::vector<std::string> names = {"energy_variance", "magnetization_norm", "magnetization_variance"};
+        for (auto&& type : this -> types_)
+        {
+            names.push_back(type + "_norm");
+            names.push_back(type + "_variance");
+        }
+        for (auto&& name : names)
+        {
+            if (H5Lexists(this -> file_, name.c_str(), H5P_DEFAULT) <= 0)
+                return "the dataset " + name + " does not exist";
+            this -> series_.push_back(H5Dopen(this -> file_, name.c_str(), H5P_DEFAULT));
+        }
+    }
+
+    // Runs of consecutive points with the same temperature and field.
+    for (Index i = 0; i < this -> temps_.size(); ++i)
+    {
+        if (i == 0 || this -> temps_.at(i) != this -> temps_.at(i - 1) || this -> fields_.at(i) != this -> fields_.at(i - 1))
+            this -> groups_.push_back(std::vector<Index>());
+        this -> groups_.back().push_back(i);
+    }
+
+    return "";
+}
+
+// The types are counted by blocks of sites. They can be stored like
+// variable or fixed length strings.
+std::string Analyzer::readTypes()
+{
+    if (H5Lexists(this -> file_, "types", H5P_DEFAULT) <= 0)
+        return "the dataset types does not exist";
+
+    hid_t dset = H5Dopen(this -> file_, "types", H5P_DEFAULT);
+    hid_t filetype = H5Dget_type(dset);
+    hid_t filespace = H5Dget_space(dset);
+    this -> num_sites_ = H5Sget_simple_extent_npoints(filespace);
+
+    bool variable = H5Tis_variable_str(filetype) > 0;
+    std::size_t length = H5Tget_size(filetype);
+    hid_t memtype = H5Tcopy(H5T_C_S1);
+    H5Tset_size(memtype, variable ? H5T_VARIABLE : length);
+
+    std::map<std::string, Index> counts;
+    std::vector<char*> strings(std::min(this -> num_sites_, BLOCKSITES));
+    std::vector<char> chars(variable ? 0 : length * std::min(this -> num_sites_, BLOCKSITES));
+    for (Index begin = 0; begin < this -> num_sites_; begin += BLOCKSITES)
+    {
+        hsize_t start[1] = {begin};
+        hsize_t count[1] = {std::min(BLOCKSITES, this -> num_sites_ - begin)};
+        H5Sselect_hyperslab(filespace, H5S_SELECT_SET, start, NULL, count, NULL);
+        hid_t memspace = H5Screate_simple(1, count, NULL);
+
+        if (variable)
+        {
+            H5Dread(dset, memtype, memspace, filespace, H5P_DEFAULT, strings.data());
+            for (Index k = 0; k < count[0]; ++k)
+                counts[strings[k]] += 1;
+#if H5_VERSION_GE(1, 12, 0)
+            H5Treclaim(memtype, memspace, H5P_DEFAULT, strings.data());
+#else
+            H5Dvlen_reclaim(memtype, memspace, H5P_DEFAULT, strings.data());
+#endif
+        }
+        else
+        {
+            H5Dread(dset, memtype, memspace, filespace, H5P_DEFAULT, chars.data());
+            for (Index k = 0; k < count[0]; ++k)
+            {
+                const char* type = &chars[k * length];
+                counts[std::string(type, strnlen(type, length))] += 1;
+            }
+        }
+        H5Sclose(memspace);
+    }
+
+    for (auto&& type : counts)
+    {
+        this -> types_.push_back(type.first);
+        this -> sizesByType_.push_back(type.second);
+    }
+
+    H5Tclose(memtype);
+    H5Tclose(filetype);
+    H5Sclose(filespace);
+    H5Dclose(dset);
+    return "";
+}
+
+void Analyzer::readRow(hid_t dset, Index row, Index begin, Index count, double* buffer)
+{
+    hid_t filespace = H5Dget_space(dset);
+    hsize_t start[2] = {row, begin};
+    hsize_t block[2] = {1, count};
+    H5Sselect_hyperslab(filespace, H5S_SELECT_SET, start, NULL, block, NULL);
+    hsize_t dims[1] = {count};
+    hid_t memspace = H5Screate_simple(1, dims, NULL);
+    H5Dread(dset, H5T_NATIVE_DOUBLE, memspace, filespace, H5P_DEFAULT, buffer);
+    H5Sclose(memspace);
+    H5Sclose(filespace);
+}
+
+const std::vector< std::vector<Index> >& Analyzer::getGroups() const
+{
+    return this -> groups_;
+}
+
+bool Analyzer::getBlockAverages() const
+{
+    return this -> blockAverages_;
+}
+
+void Analyzer::analyzeGroup(Index group)
+{
+    const std::vector<Index>& points = this -> groups_.at(group);
+    const Index num_types = this -> types_.size();
+    const Index num_series = this -> series_.size();
+
+    // The first fifth of the joined series is discarded for the
+    // thermalization.
+    const Index tau = (points.size() * this -> mcs_) / 5;
+    const bool adaptive = !this -> used_.empty();
+
+    Moments energy;
+    Moments mag;
+    Moments magz;
+    std::vector<Moments> magTypes(num_types);
+    std::vector<Moments> magzTypes(num_types);
+    // Mean variances inside the blocks of the energy, |M| and |M| of each
+    // type. The means of |M| in each block are read from their datasets,
+    // instead of the norm of the mean magnetization.
+    const Index blocks = 4 + 3 * num_types;
+    std::vector<Moments> blockVariances(this -> blockAverages_ ? num_types + 2 : 0);
+    auto norm = [this, blocks](const double* values, Index count, Index v, double mx, double my, double mz){
+        if (this -> blockAverages_)
+            return values[(blocks + 2 * v - 1) * count];
+        return std::sqrt(mx * mx + my * my + mz * mz);
+    };
+
+    std::vector<double> buffer(num_series * std::min(this -> mcs_, CHUNKSTEPS));
+    Index step = 0;
+    for (auto&& point : points)
+    {
+        const Index length = adaptive ? this -> used_.at(point) : this -> mcs_;
+        for (Index begin = 0; begin < length; begin += CHUNKSTEPS)
+        {
+            Index count = std::min(CHUNKSTEPS, length - begin);
+            {
+                std::lock_guard<std::mutex> lock(this -> mutex_);
+                for (Index s = 0; s < num_series; ++s)
+                    this -> readRow(this -> series_.at(s), point, begin, count, &buffer[s * count]);
+            }
+
+            for (Index k = 0; k < count; ++k, ++step)
+            {
+                if (adaptive ? begin + k < this -> equilibration_.at(point) : step < tau)
+                    continue;
+
+                const double* values = &buffer[k];
+                energy.add(values[0]);
+                double mx = values[count];
+                double my = values[2 * count];
+                double mz = values[3 * count];
+                mag.add(norm(values, count, 1, mx, my, mz));
+                magz.add(mz);
+                for (Index t = 0; t < num_types; ++t)
+                {
+                    mx = values[(4 + 3 * t) * count];
+                    my = values[(5 + 3 * t) * count];
+                    mz = values[(6 + 3 * t) * count];
+                    magTypes.at(t).add(norm(values, count, 2 + t, mx, my, mz));
+                    magzTypes.at(t).add(mz);
+                }
+                for (Index v = 0; v < blockVariances.size(); ++v)
+                    blockVariances.at(v).add(values[(blocks + 2 * v) * count]);
+            }
+        }
+    }
+
+    const Real T = this -> temps_.at(points.front());
+    const Real H = this -> fields_.at(points.front());
+    const Real N = this -> num_sites_;
+    // The variance of the steps is the one of the means of the blocks
+    // plus the mean of the variances inside them.
+    auto inside = [&blockVariances](Index v){
+        return blockVariances.empty() ? 0.0 : blockVariances.at(v).mean;
+    };
+    std::vector<Real>& result = this -> results_.at(group);
+    result = {T, H,
+              energy.mean / N,
+              (energy.variance() + inside(0)) / (T * T) / N,
+              mag.mean / N,
+              magz.mean / N,
+              (mag.variance() + inside(1)) / T / N};
+    for (Index t = 0; t < num_types; ++t)
+    {
+        const Real Nt = this -> sizesByType_.at(t);
+        result.push_back(magTypes.at(t).mean / Nt);
+        result.push_back(magzTypes.at(t).mean / Nt);
+        result.push_back((magTypes.at(t).variance() + inside(2 + t)) / T / Nt);
+    }
+}
+
+void Analyzer::compute(Index threads)
+{
+    this -> results_ = std::vector< std::vector<Real> >(this -> groups_.size());
+
+    std::atomic<Index> next(0);
+    auto worker = [this, &next](){
+        for (Index group = next++; group < this -> groups_.size(); group = next++)
+            this -> analyzeGroup(group);
+    };
+
+    std::vector<std::thread> pool;
+    for (Index i = 1; i < threads; ++i)
+        pool.push_back(std::thread(worker));
+    worker();
+    for (auto&& thread : pool)
+        thread.join();
+}
+
+void Analyzer::write(const std::string& fileName) const
+{
+    std::ofstream file(fileName);
+    file << "# seed = " << this -> seed_ << "\n";
+    file << "#\tT\tH\tE\tCv\tM\tMz\tX\t";
+    for (auto&& type : this -> types_)
+        file << type << "\t" << type << "z\tX_" << type << "\t";
+    file << "\n";
+
+    for (auto&& result : this -> results_)
+    {
+        for (auto&& value : result)
+            file << pythonRepr(value) << "\t";
+        file << "\n";
+    }
+}
+
+void Analyzer::reweight(Index points, Index threads)
+{
+    // The fields in order of appearance.
+    std::vector<Real> fields;
+    for (auto&& H : this -> fields_)
+        if (std::find(fields.begin(), fields.end(), H) == fields.end())
+            fields.push_back(H);
+
+    const bool adaptive = !this -> used_.empty();
+    const Real N = this -> num_sites_;
+    this -> reweighted_.clear();
+    for (auto&& H : fields)
+    {
+        MultiHistogram histogram(3);
+        Real Tmin = std::numeric_limits<Real>::infinity();
+        Real Tmax = - std::numeric_limits<Real>::infinity();
+        for (Index point = 0; point < this -> temps_.size(); ++point)
+        {
+            if (this -> fields_.at(point) != H)
+                continue;
+
+            const Index length = adaptive ? this -> used_.at(point) : this -> mcs_;
+            const Index skip = adaptive ? this -> equilibration_.at(point) : this -> mcs_ / 5;
+            std::vector<Real> energies;
+            std::vector<Real> observables;
+            std::vector<double> buffer(4 * std::min(this -> mcs_, CHUNKSTEPS));
+            for (Index begin = 0; begin < length; begin += CHUNKSTEPS)
+            {
+                Index count = std::min(CHUNKSTEPS, length - begin);
+                for (Index s = 0; s < 4; ++s)
+                    this -> readRow(this -> series_.at(s), point, begin, count, &buffer[s * count]);
+                for (Index k = 0; k < count; ++k)
+                {
+                    if (begin + k < skip)
+                        continue;
+                    double mx = buffer[count + k];
+                    double my = buffer[2 * count + k];
+                    double mz = buffer[3 * count + k];
+                    energies.push_back(buffer[k]);
+                    observables.push_back(buffer[k]);
+                    observables.push_back(std::sqrt(mx * mx + my * my + mz * mz));
+                    observables.push_back(mz);
+                }
+            }
+
+            const Real T = this -> temps_.at(point);
+            histogram.addSimulation(1.0 / (this -> kb_ * T), energies, observables);
+            Tmin = std::min(Tmin, T);
+            Tmax = std::max(Tmax, T);
+        }
+
+        histogram.solve(threads, 1e-10, 10000);
+
+        std::vector<Real> means;
+        std::vector<Real> variances;
+        for (Index i = 0; i < points; ++i)
+        {
+            const Real T = (points == 1) ? Tmin : Tmin + (Tmax - Tmin) * i / (points - 1);
+            histogram.moments(1.0 / (this -> kb_ * T), threads, means, variances);
+            this -> reweighted_.push_back({T, H,
+                                           means[0] / N,
+                                           variances[0] / (T * T) / N,
+                                           means[1] / N,
+                                           means[2] / N,
+                                           variances[1] / T / N});
+        }
+    }
+}
+
+void Analyzer::writeReweighted(const std::string& fileName) const
+{
+    std::ofstream file(fileName);
+    file << "# seed = " << this -> seed_ << "\n";
+    file << "#\tT\tH\tE\tCv\tM\tMz\tX\t\n";
+    for (auto&& result : this -> reweighted_)
+    {
+        for (auto&& value : result)
+            file << pythonRepr(value) << "\t";
+        file << "\n";
+    }
+}
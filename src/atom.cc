@@ -1,5 +1,7 @@
 #include "../include/atom.h"
 
+#include <cmath>
+
 Real dot(const Array& A, const Array& B)
 {
     return (A * B).sum();
@@ -30,21 +32,10 @@ Atom::Atom(Index index, Array spin, Array position)
     this -> exchanges_ = std::vector<Real>();
     this -> position_ = position;
     this -> spinNorm_ = sqrt((this -> spin_ * this -> spin_).sum());
-    this -> type_ = "nothing";
-
-    this -> projections_ = std::vector<double>(0);
-    this -> possibleProjections_ = std::vector<double>(0);
-    for (double p = - this -> spinNorm_; p <= this -> spinNorm_; p += 1.0)
-    {
-        this -> projections_.push_back(p);
-        this -> possibleProjections_.push_back(p);
-    }
-
-    this -> Sproj_ = 0;
-    this -> setSpin({0.0, 0.0, this -> getPossibleProjections()[0]}); // ALWAYS THE INITIAL SPIN WILL BE IN THE Z-DIRECTION
-    this -> removePossibleProjection(0);
-
+    this -> typeIndex_ = 0;
+    this -> model_ = Model::UNKNOWN;
 
+    this -> spin_ = {0.0, 0.0, - this -> spinNorm_}; // ALWAYS THE INITIAL SPIN WILL BE IN THE Z-DIRECTION
     this -> oldSpin_ = this -> spin_;
 }
 
@@ -83,21 +74,6 @@ const std::vector<Real>& Atom::getExchanges() const
     return this -> exchanges_;
 }
 
-const std::string& Atom::getType() const
-{
-    return this -> type_;
-}
-
-const std::vector<double>& Atom::getProjections() const
-{
-    return this -> projections_;
-}
-
-const std::vector<double>& Atom::getPossibleProjections() const
-{
-    return this -> possibleProjections_;
-}
-
 const Array& Atom::getExternalField() const
 {
     return this -> externalField_;
@@ -124,9 +100,10 @@ void Atom::setExchanges(const std::vector<Real>& exchanges)
     this -> exchanges_ = exchanges;
 }
 
-void Atom::setType(const std::string& type)
+void Atom::reserveNbhs(Index count)
 {
-    this -> type_ = type;
+    this -> nbhs_.reserve(count);
+    this -> exchanges_.reserve(count);
 }
 
 void Atom::addNbh(Atom* nbh)
@@ -144,101 +121,102 @@ void Atom::setExternalField(const Array& externalField)
     this -> externalField_ = externalField;
 }
 
-void Atom::changeProjection(Index i, Real value)
+// The projections of a spin of norm S are -S, -S + 1, ... up to S, so the
+// index of a projection follows from its value and a different one is
+// chosen by skipping the current index, without any table by site.
+Index Atom::getNumProjections() const
+{
+    return Index(std::floor(2.0 * this -> spinNorm_ + 1e-9)) + 1;
+}
+
+Index Atom::getProjection() const
 {
-    this -> possibleProjections_.at(i) = value;
+    return Index(std::lround(this -> spin_[2] + this -> spinNorm_));
 }
 
-void Atom::removePossibleProjection(Index i)
+void Atom::setProjection(Index projection)
 {
-    this -> possibleProjections_.erase(this -> possibleProjections_.begin() + i);
+    this -> spin_ = {0.0, 0.0, projection - this -> spinNorm_};
 }
 
 
-const std::string& Atom::getModel() const
+// Names of the models, in the order of the enumeration.
+const std::string MODELNAMES[] = {"random", "flip", "qising", "adaptive",
+                                  "cone30", "cone15", "hn30", "hn15"};
+
+Model modelFromName(const std::string& name)
+{
+    for (Index i = 0; i < Index(Model::UNKNOWN); ++i)
+        if (MODELNAMES[i] == name)
+            return Model(i);
+    return Model::UNKNOWN;
+}
+
+std::string modelName(Model model)
+{
+    if (model == Model::UNKNOWN)
+        return "unknown";
+    return MODELNAMES[Index(model)];
+}
+
+Model Atom::getModel() const
 {
     return this -> model_;
 }
 
-void Atom::setModel(const std::string& model)
+void Atom::setModel(Model model)
 {
     this -> model_ = model;
+}
 
-    if (model == "random")
+void Atom::randomizeSpin(std::mt19937_64& engine,
+                         std::uniform_real_distribution<>& realRandomGenerator,
+                         std::normal_distribution<>& gaussianRandomGenerator,
+                         Real sigma_, Index num)
+{
+    switch (this -> model_)
     {
-        this -> randomizeSpin = [](
-            std::mt19937_64& engine,
-            std::uniform_real_distribution<>& realRandomGenerator,
-            std::normal_distribution<>& gaussianRandomGenerator,
-            Real sigma_,
-            Atom& atom, Index num)
+        case Model::RANDOM:
         {
-            atom.setOldSpin(atom.getSpin());
+            this -> setOldSpin(this -> getSpin());
             Array gamma({gaussianRandomGenerator(engine), gaussianRandomGenerator(engine), gaussianRandomGenerator(engine)});
             Array unitArray = gamma / std::sqrt((gamma * gamma).sum());
-            atom.setSpin( atom.getSpinNorm() * unitArray);
-        };
-    }
-    else if (model == "flip")
-    {
-        this -> randomizeSpin = [](
-            std::mt19937_64& engine,
-            std::uniform_real_distribution<>& realRandomGenerator,
-            std::normal_distribution<>& gaussianRandomGenerator,
-            Real sigma_,
-            Atom& atom, Index num)
+            this -> setSpin( this -> getSpinNorm() * unitArray);
+            break;
+        }
+        case Model::FLIP:
         {
-            atom.setOldSpin(atom.getSpin());
-            atom.setSpin(  - atom.getSpin());
-        };
-    }
-    else if (model == "qising")
-    {
-        this -> randomizeSpin = [](
-            std::mt19937_64& engine,
-            std::uniform_real_distribution<>& realRandomGenerator,
-            std::normal_distribution<>& gaussianRandomGenerator,
-            Real sigma_,
-            Atom& atom, Index num)
+            this -> setOldSpin(this -> getSpin());
+            this -> setSpin(  - this -> getSpin());
+            break;
+        }
+        case Model::QISING:
         {
-            atom.setOldSpin(atom.getSpin());
-            atom.setSproj(int(realRandomGenerator(engine) * atom.getPossibleProjections().size()));
-            atom.setSpin({0.0, 0.0, atom.getPossibleProjections()[atom.getSproj()]});
-            atom.changeProjection(atom.getSproj(), atom.getOldSpin()[2]);
-        };
-    }
-    else if (model == "adaptive")
-    {
-        this -> randomizeSpin = [](
-            std::mt19937_64& engine,
-            std::uniform_real_distribution<>& realRandomGenerator,
-            std::normal_distribution<>& gaussianRandomGenerator,
-            Real sigma_,
-            Atom& atom, Index num)
+            this -> setOldSpin(this -> getSpin());
+            Index projection = Index(realRandomGenerator(engine) * (this -> getNumProjections() - 1));
+            if (projection >= this -> getProjection())
+                projection++;
+            this -> setProjection(projection);
+            break;
+        }
+        case Model::ADAPTIVE:
         {
-            atom.setOldSpin(atom.getSpin());
+            this -> setOldSpin(this -> getSpin());
             Array gamma({gaussianRandomGenerator(engine), gaussianRandomGenerator(engine), gaussianRandomGenerator(engine)});
-            Array spinUnit = atom.getSpin() / std::sqrt((atom.getSpin() * atom.getSpin()).sum());
+            Array spinUnit = this -> getSpin() / std::sqrt((this -> getSpin() * this -> getSpin()).sum());
             Array Sp = spinUnit + sigma_ * gamma;
             Sp /= std::sqrt((Sp * Sp).sum());
-            Sp = atom.getSpinNorm() * Sp;
-            atom.setSpin(Sp);
-        };
-    }
-    else if (model == "cone30")
-    {
-        this -> randomizeSpin = [](
-            std::mt19937_64& engine,
-            std::uniform_real_distribution<>& realRandomGenerator,
-            std::normal_distribution<>& gaussianRandomGenerator,
-            Real sigma_,
-            Atom& atom, Index num)
+            Sp = this -> getSpinNorm() * Sp;
+            this -> setSpin(Sp);
+            break;
+        }
+        case Model::CONE30:
         {
             Real A = M_PI / 6.0;
             Real cos_theta = (1.0 - std::cos(A)) * realRandomGenerator(engine) + std::cos(A);
             Real theta_rot = std::acos(cos_theta);
 
-            Array vector = atom.getSpin() / norm(atom.getSpin());
+            Array vector = this -> getSpin() / norm(this -> getSpin());
             Real x = vector[0];
             Real y = vector[1];
             Real z = vector[2];
@@ -253,25 +231,18 @@ void Atom::setModel(const std::string& model)
             Array new_vector = {xn, yn, zn};
             Array v_rot = new_vector*std::cos(phi_rot) + cross(vector, new_vector)*std::sin(phi_rot) + vector*dot(vector, new_vector)*(1-std::cos(phi_rot));
 
-            atom.setOldSpin(atom.getSpin());
-            Array Sp = atom.getSpinNorm() * v_rot / std::sqrt((v_rot * v_rot).sum());
-            atom.setSpin(Sp);
-        };
-    }
-    else if (model == "cone15")
-    {
-        this -> randomizeSpin = [](
-            std::mt19937_64& engine,
-            std::uniform_real_distribution<>& realRandomGenerator,
-            std::normal_distribution<>& gaussianRandomGenerator,
-            Real sigma_,
-            Atom& atom, Index num)
+            this -> setOldSpin(this -> getSpin());
+            Array Sp = this -> getSpinNorm() * v_rot / std::sqrt((v_rot * v_rot).sum());
+            this -> setSpin(Sp);
+            break;
+        }
+        case Model::CONE15:
         {
             Real A = M_PI / 12.0;
             Real cos_theta = (1.0 - std::cos(A)) * realRandomGenerator(engine) + std::cos(A);
             Real theta_rot = std::acos(cos_theta);
 
-            Array vector = atom.getSpin() / norm(atom.getSpin());
+            Array vector = this -> getSpin() / norm(this -> getSpin());
             Real x = vector[0];
             Real y = vector[1];
             Real z = vector[2];
@@ -286,21 +257,14 @@ void Atom::setModel(const std::string& model)
             Array new_vector = {xn, yn, zn};
             Array v_rot = new_vector*std::cos(phi_rot) + cross(vector, new_vector)*std::sin(phi_rot) + vector*dot(vector, new_vector)*(1-std::cos(phi_rot));
 
-            atom.setOldSpin(atom.getSpin());
-            Array Sp = atom.getSpinNorm() * v_rot / std::sqrt((v_rot * v_rot).sum());
-            atom.setSpin(Sp);
-        };
-    }
-    else if (model == "hn30")
-    {
-        this -> randomizeSpin = [](
-            std::mt19937_64& engine,
-            std::uniform_real_distribution<>& realRandomGenerator,
-            std::normal_distribution<>& gaussianRandomGenerator,
-            Real sigma_,
-            Atom& atom, Index num)
+            this -> setOldSpin(this -> getSpin());
+            Array Sp = this -> getSpinNorm() * v_rot / std::sqrt((v_rot * v_rot).sum());
+            this -> setSpin(Sp);
+            break;
+        }
+        case Model::HN30:
         {
-            atom.setOldSpin(atom.getSpin());
+            this -> setOldSpin(this -> getSpin());
             if (num == 0)
             {
                 Real A = M_PI / 6.0;
@@ -308,7 +272,7 @@ void Atom::setModel(const std::string& model)
                 // Real cos_theta = 2*realRandomGenerator(engine) - 1;
                 Real theta_rot = std::acos(cos_theta);
 
-                Array vector = atom.getSpin() / norm(atom.getSpin());
+                Array vector = this -> getSpin() / norm(this -> getSpin());
                 Real x = vector[0];
                 Real y = vector[1];
                 Real z = vector[2];
@@ -323,32 +287,25 @@ void Atom::setModel(const std::string& model)
                 Array new_vector = {xn, yn, zn};
                 Array v_rot = new_vector*std::cos(phi_rot) + cross(vector, new_vector)*std::sin(phi_rot) + vector*dot(vector, new_vector)*(1-std::cos(phi_rot));
 
-                atom.setOldSpin(atom.getSpin());
-                Array Sp = atom.getSpinNorm() * v_rot / std::sqrt((v_rot * v_rot).sum());
-                atom.setSpin(Sp);
+                this -> setOldSpin(this -> getSpin());
+                Array Sp = this -> getSpinNorm() * v_rot / std::sqrt((v_rot * v_rot).sum());
+                this -> setSpin(Sp);
             }
             else if (num == 1 || num == 2 || num == 3)
             {
                 Array gamma({gaussianRandomGenerator(engine), gaussianRandomGenerator(engine), gaussianRandomGenerator(engine)});
                 Array unitArray = gamma / std::sqrt((gamma * gamma).sum());
-                atom.setSpin( atom.getSpinNorm() * unitArray);
+                this -> setSpin( this -> getSpinNorm() * unitArray);
             }
             else if (num == 4)
             {
-                atom.setSpin(  - atom.getSpin());
+                this -> setSpin(  - this -> getSpin());
             }
-        };
-    }
-    else if (model == "hn15")
-    {
-        this -> randomizeSpin = [](
-            std::mt19937_64& engine,
-            std::uniform_real_distribution<>& realRandomGenerator,
-            std::normal_distribution<>& gaussianRandomGenerator,
-            Real sigma_,
-            Atom& atom, Index num)
+            break;
+        }
+        case Model::HN15:
         {
-            atom.setOldSpin(atom.getSpin());
+            this -> setOldSpin(this -> getSpin());
             if (num == 0)
             {
                 Real A = M_PI / 12.0;
@@ -356,7 +313,7 @@ void Atom::setModel(const std::string& model)
                 // Real cos_theta = 2*realRandomGenerator(engine) - 1;
                 Real theta_rot = std::acos(cos_theta);
 
-                Array vector = atom.getSpin() / norm(atom.getSpin());
+                Array vector = this -> getSpin() / norm(this -> getSpin());
                 Real x = vector[0];
                 Real y = vector[1];
                 Real z = vector[2];
@@ -371,67 +328,66 @@ void Atom::setModel(const std::string& model)
                 Array new_vector = {xn, yn, zn};
                 Array v_rot = new_vector*std::cos(phi_rot) + cross(vector, new_vector)*std::sin(phi_rot) + vector*dot(vector, new_vector)*(1-std::cos(phi_rot));
 
-                atom.setOldSpin(atom.getSpin());
-                Array Sp = atom.getSpinNorm() * v_rot / std::sqrt((v_rot * v_rot).sum());
-                atom.setSpin(Sp);
+                this -> setOldSpin(this -> getSpin());
+                Array Sp = this -> getSpinNorm() * v_rot / std::sqrt((v_rot * v_rot).sum());
+                this -> setSpin(Sp);
             }
             else if (num == 1 || num == 2 || num == 3)
             {
                 Array gamma({gaussianRandomGenerator(engine), gaussianRandomGenerator(engine), gaussianRandomGenerator(engine)});
                 Array unitArray = gamma / std::sqrt((gamma * gamma).sum());
-                atom.setSpin( atom.getSpinNorm() * unitArray);
+                this -> setSpin( this -> getSpinNorm() * unitArray);
             }
             else if (num == 4)
             {
-                atom.setSpin(  - atom.getSpin());
+                this -> setSpin(  - this -> getSpin());
             }
-        };
+            break;
+        }
+        default:
+            break;
     }
+}
 
-
-
-    if (model == "random" || model == "adaptive" || model == "cone15" || model == "cone30" || model == "hn15" || model == "hn30")
+void Atom::randomInitialState(std::mt19937_64& engine,
+                              std::uniform_real_distribution<>& realRandomGenerator,
+                              std::normal_distribution<>& gaussianRandomGenerator)
+{
+    switch (this -> model_)
     {
-        this -> randomInitialState = [](
-            std::mt19937_64& engine,
-            std::uniform_real_distribution<>& realRandomGenerator,
-            std::normal_distribution<>& gaussianRandomGenerator,
-            Atom& atom)
+        case Model::RANDOM:
+        case Model::ADAPTIVE:
+        case Model::CONE15:
+        case Model::CONE30:
+        case Model::HN15:
+        case Model::HN30:
         {
-            atom.setOldSpin(atom.getSpin());
+            this -> setOldSpin(this -> getSpin());
             Array gamma({gaussianRandomGenerator(engine), gaussianRandomGenerator(engine), gaussianRandomGenerator(engine)});
             Array unitArray = gamma / std::sqrt((gamma * gamma).sum());
-            atom.setSpin( atom.getSpinNorm() * unitArray);
-        };
-    }
-    else if (model == "flip")
-    {
-        this -> randomInitialState = [](
-            std::mt19937_64& engine,
-            std::uniform_real_distribution<>& realRandomGenerator,
-            std::normal_distribution<>& gaussianRandomGenerator,
-            Atom& atom)
+            this -> setSpin( this -> getSpinNorm() * unitArray);
+            break;
+        }
+        case Model::FLIP:
         {
-            atom.setOldSpin(atom.getSpin());
+            this -> setOldSpin(this -> getSpin());
             if (realRandomGenerator(engine) < 0.5)
-                atom.setSpin( {0.0, 0.0, -atom.getSpinNorm()} );
+                this -> setSpin( {0.0, 0.0, -this -> getSpinNorm()} );
             else
-                atom.setSpin( {0.0, 0.0, atom.getSpinNorm()} );
-        };
-    }
-    else if (model == "qising")
-    {
-        this -> randomInitialState = [](
-            std::mt19937_64& engine,
-            std::uniform_real_distribution<>& realRandomGenerator,
-            std::normal_distribution<>& gaussianRandomGenerator,
-            Atom& atom)
+                this -> setSpin( {0.0, 0.0, this -> getSpinNorm()} );
+            break;
+        }
+        case Model::QISING:
         {
-            atom.setOldSpin(atom.getSpin());
-            atom.setSproj(int(realRandomGenerator(engine) * atom.getPossibleProjections().size()));
-            atom.setSpin({0.0, 0.0, atom.getPossibleProjections()[atom.getSproj()]});
-            atom.changeProjection(atom.getSproj(), atom.getOldSpin()[2]);
-        };
+            this -> setOldSpin(this -> getSpin());
+            Index projection = Index(realRandomGenerator(engine) * (this -> getNumProjections() - 1));
+            if (projection >= this -> getProjection())
+                projection++;
+            this -> setProjection(projection);
+            break;
+        }
+        default:
+            break;
     }
 }
 
@@ -452,8 +408,8 @@ Real Atom::getZeemanEnergy(const Real& H) const
 Real Atom::getAnisotropyEnergy(const Atom& atom) const
 {
     Real anisotropyEnergy = 0.0;
-    for (auto&& func : this -> anisotropyTerms_)
-        anisotropyEnergy += func(atom);
+    for (auto&& term : this -> anisotropyTerms_)
+        anisotropyEnergy += term.energy(atom.getSpin());
     return anisotropyEnergy;
 }
 
@@ -463,38 +419,82 @@ void Atom::setOldSpin(const Array& oldSpin)
     this -> oldSpin_ = oldSpin;
 }
 
-const Index& Atom::getSproj() const
+
+const Array& Atom::getOldSpin() const
 {
-    return this -> Sproj_;
+    return this -> oldSpin_;
 }
 
-void Atom::setSproj(const Index& Sproj)
+void Atom::revertSpin()
 {
-    this -> Sproj_ = Sproj;
+    this -> spin_ = this -> oldSpin_;
 }
 
-const Array& Atom::getOldSpin() const
+void Atom::addAnisotropyTerm(const AnisotropyTerm& term)
 {
-    return this -> oldSpin_;
+    this -> anisotropyTerms_.push_back(term);
 }
 
-void Atom::revertSpin()
+const std::vector<AnisotropyTerm>& Atom::getAnisotropyTerms() const
 {
-    this -> changeProjection(this -> Sproj_, this -> spin_[2]);
-    this -> spin_ = this -> oldSpin_;
+    return this -> anisotropyTerms_;
 }
 
-void Atom::addAnisotropyTerm(const std::function<Real(const Atom&)>& func)
+std::size_t Atom::getMemory() const
 {
-    this -> anisotropyTerms_.push_back(func);
+    std::size_t bytes = sizeof(Atom);
+    bytes += (this -> position_.size() + this -> spin_.size() + this -> oldSpin_.size() + this -> externalField_.size()) * sizeof(Real);
+    bytes += this -> nbhs_.capacity() * sizeof(Atom*);
+    bytes += this -> exchanges_.capacity() * sizeof(Real);
+    bytes += this -> anisotropyTerms_.capacity() * sizeof(AnisotropyTerm);
+    for (auto&& term : this -> anisotropyTerms_)
+        for (auto&& axis : term.axes)
+            bytes += axis.size() * sizeof(Real);
+    return bytes;
+}
+
+Real AnisotropyTerm::energy(const Array& spin) const
+{
+    Real a = dot(spin, this -> axes[0]);
+    if (!this -> cubic)
+        return - this -> constant * a * a;
+
+    Real b = dot(spin, this -> axes[1]);
+    Real c = dot(spin, this -> axes[2]);
+    return - this -> constant * (a * a * b * b + a * a * c * c + b * b * c * c);
+}
+
+Real AnisotropyTerm::range(Real spinNorm) const
+{
+    Real A2 = dot(this -> axes[0], this -> axes[0]);
+    Real S2 = spinNorm * spinNorm;
+    if (!this -> cubic)
+        return std::fabs(this -> constant) * S2 * A2;
+
+    Real B2 = dot(this -> axes[1], this -> axes[1]);
+    Real C2 = dot(this -> axes[2], this -> axes[2]);
+    return std::fabs(this -> constant) * S2 * S2 * (A2 * B2 + A2 * C2 + B2 * C2);
+}
+
+Array AnisotropyTerm::field(const Array& spin) const
+{
+    Real a = dot(spin, this -> axes[0]);
+    if (!this -> cubic)
+        return 2.0 * this -> constant * a * this -> axes[0];
+
+    Real b = dot(spin, this -> axes[1]);
+    Real c = dot(spin, this -> axes[2]);
+    return 2.0 * this -> constant * (a * (b * b + c * c) * this -> axes[0]
+                                   + b * (a * a + c * c) * this -> axes[1]
+                                   + c * (a * a + b * b) * this -> axes[2]);
 }
 
-const Index& Atom::getTypeIndex() const
+Index Atom::getTypeIndex() const
 {
     return this -> typeIndex_;
 }
 
-void Atom::setTypeIndex(const Index& typeIndex)
+void Atom::setTypeIndex(Index typeIndex)
 {
     this -> typeIndex_ = typeIndex;
 }
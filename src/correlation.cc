@@ -0,0 +1,284 @@
+#include "../include/correlation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <limits>
+
+Correlation::Correlation()
+{
+    this -> enabled_ = false;
+    this -> cutoff_ = 0.0;
+    this -> width_ = 0.0;
+    this -> numSites_ = 0;
+    this -> side_ = 0.0;
+    this -> measurements_ = 0;
+    this -> chiZero_ = 0.0;
+    for (Index a = 0; a < 3; ++a)
+    {
+        this -> low_[a] = 0.0;
+        this -> cells_[a] = 1;
+        this -> minimalQ_[a] = 0.0;
+        this -> chiMinimal_[a] = 0.0;
+    }
+}
+
+std::string Correlation::setup(Lattice& lattice, Real cutoff, Real width)
+{
+    std::vector<Atom>& atoms = lattice.getAtoms();
+    const Index N = atoms.size();
+    if (N == 0)
+        return "the sample is empty";
+    if (cutoff <= 0.0 || width <= 0.0)
+        return "the cutoff and the width of the bins must be positive";
+    if (cutoff / width > 1e6)
+        return "there are too many bins";
+
+    this -> cutoff_ = cutoff;
+    this -> width_ = width;
+    this -> numSites_ = N;
+    this -> positions_ = std::vector<Real>(3 * N);
+    for (Index i = 0; i < N; ++i)
+        for (Index a = 0; a < 3; ++a)
+            this -> positions_.at(3 * i + a) = atoms.at(i).getPosition()[a];
+
+    const Real PI = std::acos(-1.0);
+    Real high[3];
+    for (Index a = 0; a < 3; ++a)
+    {
+        std::vector<Real> coords(N);
+        for (Index i = 0; i < N; ++i)
+            coords.at(i) = this -> positions_.at(3 * i + a);
+        std::sort(coords.begin(), coords.end());
+        this -> low_[a] = coords.front();
+        high[a] = coords.back();
+
+        // The length of the sample along the axis counts the separation
+        // of its sites, like the period of a periodic sample.
+        Real spacing = 0.0;
+        for (Index i = 1; i < N; ++i)
+        {
+            Real delta = coords.at(i) - coords.at(i - 1);
+            if (delta > 1e-6 && (spacing == 0.0 || delta < spacing))
+                spacing = delta;
+        }
+        this -> minimalQ_[a] = (spacing > 0.0) ? 2.0 * PI / (high[a] - this -> low_[a] + spacing) : 0.0;
+    }
+
+    // The cells are not smaller than the cutoff, and there are at most a
+    // few by site, so sparse samples don't fill the memory with cells.
+    this -> side_ = cutoff;
+    while (true)
+    {
+        double numCells = 1.0;
+        for (Index a = 0; a < 3; ++a)
+        {
+            this -> cells_[a] = Index((high[a] - this -> low_[a]) / this -> side_) + 1;
+            numCells *= this -> cells_[a];
+        }
+        if (numCells <= 8.0 * N + 27.0)
+            break;
+        this -> side_ *= std::cbrt(numCells / (8.0 * N));
+    }
+
+    const Index numCells = this -> cells_[0] * this -> cells_[1] * this -> cells_[2];
+    this -> cellStarts_ = std::vector<Index>(numCells + 1, 0);
+    for (Index i = 0; i < N; ++i)
+        this -> cellStarts_.at(this -> cellOf(&this -> positions_[3 * i]) + 1)++;
+    for (Index c = 0; c < numCells; ++c)
+        this -> cellStarts_.at(c + 1) += this -> cellStarts_.at(c);
+    this -> cellSites_ = std::vector<Index>(N);
+    std::vector<Index> next(this -> cellStarts_.begin(), this -> cellStarts_.end() - 1);
+    for (Index i = 0; i < N; ++i)
+        this -> cellSites_.at(next.at(this -> cellOf(&this -> positions_[3 * i]))++) = i;
+
+    // The mean distance and the amount of pairs of each bin.
+    const Index bins = this -> getNumBins();
+    this -> distances_ = std::vector<Real>(bins, 0.0);
+    this -> pairs_ = std::vector<Real>(bins, 0.0);
+    this -> accumulate(nullptr, this -> distances_, &this -> pairs_);
+    for (Index b = 0; b < bins; ++b)
+        this -> distances_.at(b) = (this -> pairs_.at(b) > 0.0) ? this -> distances_.at(b) / this -> pairs_.at(b)
+                                                                 : (b + 0.5) * width;
+
+    this -> enabled_ = true;
+    this -> reset();
+    return "";
+}
+
+bool Correlation::isEnabled() const
+{
+    return this -> enabled_;
+}
+
+Real Correlation::getCutoff() const
+{
+    return this -> cutoff_;
+}
+
+Index Correlation::getNumBins() const
+{
+    return Index(std::ceil(this -> cutoff_ / this -> width_));
+}
+
+const std::vector<Real>& Correlation::getDistances() const
+{
+    return this -> distances_;
+}
+
+const std::vector<Real>& Correlation::getPairs() const
+{
+    return this -> pairs_;
+}
+
+Index Correlation::cellOf(const Real* position) const
+{
+    Index cell[3];
+    for (Index a = 0; a < 3; ++a)
+        cell[a] = std::min(this -> cells_[a] - 1, Index((position[a] - this -> low_[a]) / this -> side_));
+    return (cell[0] * this -> cells_[1] + cell[1]) * this -> cells_[2] + cell[2];
+}
+
+void Correlation::accumulate(Lattice* lattice, std::vector<Real>& values, std::vector<Real>* counts) const
+{
+    const Index bins = values.size();
+    const Real cutoff2 = this -> cutoff_ * this -> cutoff_;
+    const Index numCells = this -> cells_[0] * this -> cells_[1] * this -> cells_[2];
+    const std::vector<Atom>* atoms = (lattice != nullptr) ? &lattice -> getAtoms() : nullptr;
+
+    // Each thread sums the pairs of some cells with the sites of the
+    // same and of the neighboring cells, each pair once.
+    #pragma omp parallel
+    {
+        std::vector<Real> localValues(bins, 0.0);
+        std::vector<Real> localCounts(counts != nullptr ? bins : 0, 0.0);
+
+        #pragma omp for schedule(dynamic, 64)
+        for (long c = 0; c < long(numCells); ++c)
+        {
+            const long cx = c / (this -> cells_[1] * this -> cells_[2]);
+            const long cy = (c / this -> cells_[2]) % this -> cells_[1];
+            const long cz = c % this -> cells_[2];
+            for (long dx = -1; dx <= 1; ++dx)
+            for (long dy = -1; dy <= 1; ++dy)
+            for (long dz = -1; dz <= 1; ++dz)
+            {
+                const long nx = cx + dx;
+                const long ny = cy + dy;
+                const long nz = cz + dz;
+                if (nx < 0 || ny < 0 || nz < 0 || nx >= long(this -> cells_[0]) || ny >= long(this -> cells_[1]) || nz >= long(this -> cells_[2]))
+                    continue;
+                const Index n = (nx * this -> cells_[1] + ny) * this -> cells_[2] + nz;
+                if (n < Index(c))
+                    continue;
+
+                for (Index p = this -> cellStarts_[c]; p < this -> cellStarts_[c + 1]; ++p)
+                {
+                    const Index i = this -> cellSites_[p];
+                    const Real* ri = &this -> positions_[3 * i];
+                    for (Index s = (n == Index(c)) ? p + 1 : this -> cellStarts_[n]; s < this -> cellStarts_[n + 1]; ++s)
+                    {
+                        const Index j = this -> cellSites_[s];
+                        const Real* rj = &this -> positions_[3 * j];
+                        const Real x = ri[0] - rj[0];
+                        const Real y = ri[1] - rj[1];
+                        const Real z = ri[2] - rj[2];
+                        const Real r2 = x * x + y * y + z * z;
+                        if (r2 >= cutoff2 || r2 == 0.0)
+                            continue;
+
+                        const Real r = std::sqrt(r2);
+                        const Index b = std::min(bins - 1, Index(r / this -> width_));
+                        if (atoms != nullptr)
+                        {
+                            const Array& Si = (*atoms)[i].getSpin();
+                            const Array& Sj = (*atoms)[j].getSpin();
+                            localValues[b] += Si[0] * Sj[0] + Si[1] * Sj[1] + Si[2] * Sj[2];
+                        }
+                        else
+                        {
+                            localValues[b] += r;
+                        }
+                        if (counts != nullptr)
+                            localCounts[b] += 1.0;
+                    }
+                }
+            }
+        }
+
+        #pragma omp critical(vegas_correlation)
+        {
+            for (Index b = 0; b < bins; ++b)
+                values[b] += localValues[b];
+            if (counts != nullptr)
+                for (Index b = 0; b < bins; ++b)
+                    (*counts)[b] += localCounts[b];
+        }
+    }
+}
+
+void Correlation::reset()
+{
+    this -> measurements_ = 0;
+    this -> sums_ = std::vector<Real>(this -> getNumBins(), 0.0);
+    this -> chiZero_ = 0.0;
+    for (Index a = 0; a < 3; ++a)
+        this -> chiMinimal_[a] = 0.0;
+}
+
+void Correlation::measure(Lattice& lattice)
+{
+    this -> accumulate(&lattice, this -> sums_, nullptr);
+
+    // Fourier transform of the spins at q = 0 and at the minimal wave
+    // vector of each axis.
+    const std::vector<Atom>& atoms = lattice.getAtoms();
+    Real total[3] = {0.0, 0.0, 0.0};
+    std::complex<Real> transforms[3][3];
+    for (Index i = 0; i < this -> numSites_; ++i)
+    {
+        const Array& spin = atoms[i].getSpin();
+        for (Index c = 0; c < 3; ++c)
+            total[c] += spin[c];
+        for (Index a = 0; a < 3; ++a)
+        {
+            if (this -> minimalQ_[a] == 0.0)
+                continue;
+            const Real phase = this -> minimalQ_[a] * this -> positions_[3 * i + a];
+            const std::complex<Real> factor(std::cos(phase), std::sin(phase));
+            for (Index c = 0; c < 3; ++c)
+                transforms[a][c] += spin[c] * factor;
+        }
+    }
+
+    this -> chiZero_ += (total[0] * total[0] + total[1] * total[1] + total[2] * total[2]) / this -> numSites_;
+    for (Index a = 0; a < 3; ++a)
+        this -> chiMinimal_[a] += (std::norm(transforms[a][0]) + std::norm(transforms[a][1]) + std::norm(transforms[a][2])) / this -> numSites_;
+    this -> measurements_++;
+}
+
+std::vector<Real> Correlation::getMean() const
+{
+    std::vector<Real> mean(this -> sums_.size(), std::numeric_limits<Real>::quiet_NaN());
+    for (Index b = 0; b < mean.size(); ++b)
+        if (this -> measurements_ > 0 && this -> pairs_.at(b) > 0.0)
+            mean.at(b) = this -> sums_.at(b) / (this -> pairs_.at(b) * this -> measurements_);
+    return mean;
+}
+
+Real Correlation::getLength() const
+{
+    Real length = 0.0;
+    Index axes = 0;
+    for (Index a = 0; a < 3; ++a)
+    {
+        if (this -> measurements_ == 0 || this -> minimalQ_[a] == 0.0 || this -> chiMinimal_[a] <= 0.0)
+            continue;
+        const Real ratio = this -> chiZero_ / this -> chiMinimal_[a];
+        if (ratio < 1.0)
+            continue;
+        length += std::sqrt(ratio - 1.0) / (2.0 * std::sin(this -> minimalQ_[a] / 2.0));
+        axes++;
+    }
+    return (axes > 0) ? length / axes : std::numeric_limits<Real>::quiet_NaN();
+}
@@ -0,0 +1,257 @@
+#include "../include/dipolar.h"
+
+#include <algorithm>
+#include <cmath>
+
+const Index NOSLOT = Index(-1);
+
+Dipolar::Dipolar()
+{
+    this -> enabled_ = false;
+    this -> strength_ = 0.0;
+    this -> energy_ = 0.0;
+    this -> refresh_ = 0;
+    for (Index a = 0; a < 3; ++a)
+        this -> dims_[a] = 1;
+}
+
+Dipolar::Dipolar(Real strength, Index refresh) : Dipolar()
+{
+    this -> strength_ = strength;
+    this -> refresh_ = refresh;
+}
+
+std::string Dipolar::mapLattice(Lattice& lattice, Array spacing)
+{
+    std::vector<Atom>& atoms = lattice.getAtoms();
+    const Index N = atoms.size();
+    if (N == 0)
+        return "the sample is empty";
+
+    // Position of the sites in the grid before the padding.
+    Index sizes[3];
+    std::vector<Index> cells;
+    std::string reason = lattice.mapToGrid(spacing, sizes, cells);
+    if (reason != "")
+        return reason;
+
+    // The grid is padded up to twice its size, so the circular
+    // convolution of the FFTs doesn't mix the images of the sample.
+    for (Index a = 0; a < 3; ++a)
+        this -> dims_[a] = nextPowerOfTwo(2 * sizes[a] - 1);
+
+    const long long numCells = (long long)(this -> dims_[0]) * this -> dims_[1] * this -> dims_[2];
+    if (numCells > 4294967295LL)
+        return "the grid of the dipolar interaction is too large";
+
+    this -> gridIndexes_ = std::vector<Index>(N);
+    std::vector<bool> occupied(numCells, false);
+    for (Index i = 0; i < N; ++i)
+    {
+        Index index = (cells.at(3 * i) * this -> dims_[1] + cells.at(3 * i + 1)) * this -> dims_[2] + cells.at(3 * i + 2);
+        if (occupied.at(index))
+            return "two sites share the same point of the grid of the dipolar interaction";
+        occupied.at(index) = true;
+        this -> gridIndexes_.at(i) = index;
+    }
+
+    this -> positions_ = std::vector<Real>(3 * N);
+    for (Index i = 0; i < N; ++i)
+        for (Index a = 0; a < 3; ++a)
+            this -> positions_.at(3 * i + a) = atoms.at(i).getPosition()[a];
+
+    // Dipolar tensor for each displacement of the padded grid.
+    std::vector<Complex> kernel[6];
+    for (Index c = 0; c < 6; ++c)
+        kernel[c] = std::vector<Complex>(numCells, 0.0);
+    for (Index x = 0; x < this -> dims_[0]; ++x)
+    for (Index y = 0; y < this -> dims_[1]; ++y)
+    for (Index z = 0; z < this -> dims_[2]; ++z)
+    {
+        const Index m[3] = {x, y, z};
+        Array r(3);
+        for (Index a = 0; a < 3; ++a)
+            r[a] = ((m[a] <= this -> dims_[a] / 2) ? Real(m[a]) : Real(m[a]) - Real(this -> dims_[a])) * spacing[a];
+
+        Real r2 = (r * r).sum();
+        if (r2 == 0.0)
+            continue;
+        Real r5 = r2 * r2 * std::sqrt(r2);
+        Index index = (x * this -> dims_[1] + y) * this -> dims_[2] + z;
+        kernel[0][index] = this -> strength_ * (3.0 * r[0] * r[0] - r2) / r5;
+        kernel[1][index] = this -> strength_ * (3.0 * r[0] * r[1]) / r5;
+        kernel[2][index] = this -> strength_ * (3.0 * r[0] * r[2]) / r5;
+        kernel[3][index] = this -> strength_ * (3.0 * r[1] * r[1] - r2) / r5;
+        kernel[4][index] = this -> strength_ * (3.0 * r[1] * r[2]) / r5;
+        kernel[5][index] = this -> strength_ * (3.0 * r[2] * r[2] - r2) / r5;
+    }
+    // The tensor is real and even, so its transform is real.
+    for (Index c = 0; c < 6; ++c)
+    {
+        fft3d(kernel[c], this -> dims_, false);
+        this -> kernel_[c] = std::vector<Real>(numCells);
+        for (long long k = 0; k < numCells; ++k)
+            this -> kernel_[c][k] = kernel[c][k].real();
+    }
+
+    for (Index a = 0; a < 3; ++a)
+    {
+        this -> extents_[a] = sizes[a];
+        this -> grid_[a] = std::vector<Complex>(numCells);
+    }
+
+    // One refresh costs four FFTs, O(M log M), and each pending change adds
+    // O(1) to every trial, so both are balanced with a refresh every
+    // sqrt(4 M log M) accepted changes.
+    if (this -> refresh_ == 0)
+        this -> refresh_ = Index(std::ceil(std::sqrt(4.0 * Real(numCells) * std::log2(Real(numCells) + 1.0))));
+    this -> refresh_ = std::max(Index(1), std::min(this -> refresh_, N));
+
+    this -> field_ = std::vector<Real>(3 * N, 0.0);
+    this -> reference_ = std::vector<Real>(3 * N, 0.0);
+    this -> changed_.clear();
+    this -> changes_.clear();
+    this -> slots_ = std::vector<Index>(N, NOSLOT);
+    this -> enabled_ = true;
+
+    this -> refresh(atoms);
+    return "";
+}
+
+bool Dipolar::isEnabled() const
+{
+    return this -> enabled_;
+}
+
+Real Dipolar::getStrength() const
+{
+    return this -> strength_;
+}
+
+Index Dipolar::getRefresh() const
+{
+    return this -> refresh_;
+}
+
+Array Dipolar::getLocalField(Index site) const
+{
+    const Real* position = &this -> positions_[3 * site];
+    Real field[3] = {this -> field_[3 * site], this -> field_[3 * site + 1], this -> field_[3 * site + 2]};
+
+    // Exact contribution of the changes since the last refresh.
+    const Real* changes = this -> changes_.data();
+    for (Index c = 0; c < this -> changed_.size(); ++c, changes += 6)
+    {
+        if (this -> changed_[c] == site)
+            continue;
+        const Real r[3] = {position[0] - changes[0], position[1] - changes[1], position[2] - changes[2]};
+        const Real* delta = changes + 3;
+        Real r2 = r[0] * r[0] + r[1] * r[1] + r[2] * r[2];
+        Real inv = this -> strength_ / (r2 * r2 * std::sqrt(r2));
+        Real rs = 3.0 * (r[0] * delta[0] + r[1] * delta[1] + r[2] * delta[2]);
+        field[0] += (rs * r[0] - r2 * delta[0]) * inv;
+        field[1] += (rs * r[1] - r2 * delta[1]) * inv;
+        field[2] += (rs * r[2] - r2 * delta[2]) * inv;
+    }
+    return {field[0], field[1], field[2]};
+}
+
+void Dipolar::update(const std::vector<Atom>& atoms, Index site, Real deltaEnergy)
+{
+    this -> energy_ += deltaEnergy;
+
+    // Every change keeps the position of the site and the difference of
+    // its spin with the one of the last refresh.
+    Index slot = this -> slots_[site];
+    if (slot == NOSLOT)
+    {
+        slot = this -> changed_.size();
+        this -> slots_[site] = slot;
+        this -> changed_.push_back(site);
+        this -> changes_.resize(6 * (slot + 1));
+        for (Index a = 0; a < 3; ++a)
+            this -> changes_[6 * slot + a] = this -> positions_[3 * site + a];
+    }
+    for (Index a = 0; a < 3; ++a)
+        this -> changes_[6 * slot + 3 + a] = atoms[site].getSpin()[a] - this -> reference_[3 * site + a];
+
+    if (this -> changed_.size() >= this -> refresh_)
+        this -> refresh(atoms);
+}
+
+void Dipolar::refresh(const std::vector<Atom>& atoms)
+{
+    // The x and y components are packed in a single complex grid, since
+    // the transforms of real grids can be separated from the one of their
+    // combination.
+    std::vector<Complex>& packed = this -> grid_[0];
+    std::vector<Complex>& zeta = this -> grid_[1];
+    std::vector<Complex>& result = this -> grid_[2];
+    std::fill(packed.begin(), packed.end(), Complex(0.0, 0.0));
+    std::fill(zeta.begin(), zeta.end(), Complex(0.0, 0.0));
+
+    for (Index i = 0; i < atoms.size(); ++i)
+    {
+        const Array& spin = atoms[i].getSpin();
+        packed[this -> gridIndexes_[i]] = Complex(spin[0], spin[1]);
+        zeta[this -> gridIndexes_[i]] = spin[2];
+        for (Index a = 0; a < 3; ++a)
+            this -> reference_[3 * i + a] = spin[a];
+    }
+
+    fft3d(packed, this -> dims_, false, this -> extents_);
+    fft3d(zeta, this -> dims_, false, this -> extents_);
+
+    // Product of the symmetric tensor and the spins in the Fourier space.
+    // The fields are real, so the x and y components are packed again.
+    const Index* dims = this -> dims_;
+    #pragma omp parallel for schedule(static)
+    for (long x = 0; x < long(dims[0]); ++x)
+    {
+        Index mx = (dims[0] - x) % dims[0];
+        for (Index y = 0; y < dims[1]; ++y)
+        {
+            Index my = (dims[1] - y) % dims[1];
+            for (Index z = 0; z < dims[2]; ++z)
+            {
+                Index mz = (dims[2] - z) % dims[2];
+                Index k = (x * dims[1] + y) * dims[2] + z;
+                Index m = (mx * dims[1] + my) * dims[2] + mz;
+
+                Complex sx = 0.5 * (packed[k] + std::conj(packed[m]));
+                Complex sy = Complex(0.0, -0.5) * (packed[k] - std::conj(packed[m]));
+                Complex sz = zeta[k];
+                Complex hx = this -> kernel_[0][k] * sx + this -> kernel_[1][k] * sy + this -> kernel_[2][k] * sz;
+                Complex hy = this -> kernel_[1][k] * sx + this -> kernel_[3][k] * sy + this -> kernel_[4][k] * sz;
+                Complex hz = this -> kernel_[2][k] * sx + this -> kernel_[4][k] * sy + this -> kernel_[5][k] * sz;
+                result[k] = hx + Complex(0.0, 1.0) * hy;
+                zeta[k] = hz;
+            }
+        }
+    }
+
+    fft3d(result, this -> dims_, true, this -> extents_);
+    fft3d(zeta, this -> dims_, true, this -> extents_);
+
+    const Real norm = 1.0 / Real(result.size());
+    this -> energy_ = 0.0;
+    for (Index i = 0; i < atoms.size(); ++i)
+    {
+        const Complex& hxy = result[this -> gridIndexes_[i]];
+        this -> field_[3 * i] = hxy.real() * norm;
+        this -> field_[3 * i + 1] = hxy.imag() * norm;
+        this -> field_[3 * i + 2] = zeta[this -> gridIndexes_[i]].real() * norm;
+        for (Index a = 0; a < 3; ++a)
+            this -> energy_ -= 0.5 * this -> reference_[3 * i + a] * this -> field_[3 * i + a];
+    }
+
+    for (auto&& site : this -> changed_)
+        this -> slots_[site] = NOSLOT;
+    this -> changed_.clear();
+    this -> changes_.clear();
+}
+
+Real Dipolar::getEnergy() const
+{
+    return this -> energy_;
+}
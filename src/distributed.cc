@@ -0,0 +1,979 @@
+#include "../include/distributed.h"
+#include "../include/rlutil.h"
+#include "../include/textfile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <type_traits>
+
+const Index NUMBINS_PARTITION = 1 << 16;
+
+// With a parallel HDF5 all the ranks open the file and write their own
+// sites. Otherwise only the rank 0 touches the file and the other ranks
+// send their sites to it, one rank at a time.
+#ifdef H5_HAVE_PARALLEL
+const bool PARALLEL_HDF5 = true;
+#else
+const bool PARALLEL_HDF5 = false;
+#endif
+
+// Message to abort all the ranks and launch an error.
+void ABORT(MPI_Comm comm, std::string message)
+{
+    rlutil::setColor(rlutil::LIGHTRED);
+    std::cout << message << std::endl;
+    std::cout << "Unsuccesful completion !!!" << std::endl;
+    rlutil::resetColor();
+    MPI_Abort(comm, EXIT_FAILURE);
+}
+
+// Site and interaction of the sample file, sent as raw bytes to the rank
+// which owns them.
+struct SampleSite
+{
+    Index index;
+    Index type;
+    Model model;
+    Real spinNorm;
+    Real position[3];
+    Real field[3];
+};
+
+struct SampleBond
+{
+    Index index;
+    Index nbh;
+    Real exchange;
+};
+
+DistributedSystem::DistributedSystem(std::string fileName,
+                                     std::vector<Real> temps,
+                                     std::vector<Real> fields,
+                                     Index mcs,
+                                     Index seed,
+                                     std::string outName,
+                                     Real kb,
+                                     MPI_Comm comm)
+{
+    this -> comm_ = comm;
+    MPI_Comm_rank(comm, &this -> rank_);
+    MPI_Comm_size(comm, &this -> size_);
+
+    this -> mcs_ = mcs;
+    this -> kb_ = kb;
+    this -> seed_ = seed;
+    this -> temps_ = temps;
+    this -> fields_ = fields;
+    this -> outName_ = outName;
+    this -> gaussianRandomGenerator_ = std::normal_distribution<>(0.0, 1.0);
+
+    // Every rank has its own stream of random numbers.
+    std::seed_seq sequence{seed, Index(this -> rank_)};
+    this -> engine_.seed(sequence);
+
+    this -> load(fileName);
+    this -> setupHalo();
+
+    this -> sigma_ = std::vector<Real>(this -> num_types_, 60.0);
+    this -> counterRejections_ = std::vector<Index>(this -> num_types_, 0);
+}
+
+DistributedSystem::~DistributedSystem()
+{
+
+}
+
+// Every rank maps the sample and parses only its own range of lines, with
+// the same checks of Lattice::readSample. The bounding box and the
+// histogram along the longest axis are reduced over all the ranks, and
+// then each site and each interaction is sent to the rank which owns it.
+void DistributedSystem::load(const std::string& fileName)
+{
+    // The errors found by all the ranks abort the run from the rank 0.
+    auto fail = [this](bool failed, const std::string& message){
+        if (!failed)
+            return;
+        if (this -> rank_ == 0)
+            ABORT(this -> comm_, message);
+        MPI_Barrier(this -> comm_);
+    };
+
+    TextFile text;
+    std::string reason = text.open(fileName);
+    fail(reason != "", "The sample file " + fileName + " can't be read because " + reason + " !!!");
+
+    const char* p = text.begin();
+    Index line = 1;
+    std::string_view token;
+    std::uint64_t amount = 0;
+    Index num_types = 0;
+    const bool header = nextToken(p, text.end(), line, token) && parseNumber(token, this -> num_sites_) &&
+                        nextToken(p, text.end(), line, token) && parseNumber(token, amount) &&
+                        nextToken(p, text.end(), line, token) && parseNumber(token, num_types);
+    fail(!header, "The sample file " + fileName + " can't be read because the line " + std::to_string(line) + " doesn't have the amounts of sites, interactions and types !!!");
+    fail(amount > std::numeric_limits<LongIndex>::max(), "The sample file " + fileName + " can't be read because it has more interactions than the supported by the indexes, build vegas with -DVEGAS_LARGE_SAMPLES=ON !!!");
+    const LongIndex num_interactions = LongIndex(amount);
+
+    std::vector<std::string> types;
+    for (Index i = 0; i < num_types; ++i)
+    {
+        const bool found = nextToken(p, text.end(), line, token);
+        fail(!found, "The sample file " + fileName + " can't be read because it ends before the " + std::to_string(num_types) + " types !!!");
+        types.push_back(std::string(token));
+    }
+    this -> num_types_ = num_types;
+    for (Index i = 0; i < this -> num_types_; ++i)
+    {
+        this -> mapTypeIndexes_[types.at(i)] = i;
+        this -> mapIndexTypes_[i] = types.at(i);
+    }
+
+    // The lines after the header are split in one range by rank, and the
+    // numbers of the first line and of the first record of each range
+    // come from the counts of the previous ranks.
+    const std::size_t bytes = std::size_t(text.end() - p) / this -> size_ + 1;
+    std::vector<const char*> starts = text.splitLines(p, bytes);
+    starts.resize(this -> size_ + 1, text.end());
+    const char* begin = starts.at(this -> rank_);
+    const char* end = starts.at(this -> rank_ + 1);
+
+    std::uint64_t counts[2] = {0, 0};
+    for (const char* q = begin; q < end; ++counts[0])
+    {
+        const char* last = lineEnd(q, end);
+        if (splitTokens(q, last, &token, 0) != 0)
+            counts[1]++;
+        q = last + 1;
+    }
+    std::uint64_t firsts[2] = {0, 0};
+    MPI_Exscan(counts, firsts, 2, MPI_UINT64_T, MPI_SUM, this -> comm_);
+    if (this -> rank_ == 0)
+        firsts[0] = firsts[1] = 0;
+    std::uint64_t records = counts[1];
+    MPI_Allreduce(MPI_IN_PLACE, &records, 1, MPI_UINT64_T, MPI_SUM, this -> comm_);
+    fail(records < this -> num_sites_ + std::uint64_t(num_interactions),
+         "The sample file " + fileName + " can't be read because it ends before the " + std::to_string(this -> num_sites_) +
+         " sites and " + std::to_string(num_interactions) + " interactions of its header !!!");
+
+    // Only the error of the first line of all the ranks is reported.
+    std::vector<SampleSite> sites;
+    std::vector<SampleBond> bonds;
+    std::string error;
+    std::uint64_t current = line + firsts[0];
+    std::uint64_t record = firsts[1];
+    std::string_view tokens[10];
+    for (const char* q = begin; q < end && error == ""; ++current)
+    {
+        const char* last = lineEnd(q, end);
+        Index count = splitTokens(q, last, tokens, 10);
+        q = last + 1;
+        if (count == 0)
+            continue;
+
+        auto at = [current](){ return "the line " + std::to_string(current); };
+        if (record < this -> num_sites_)
+        {
+            SampleSite site;
+            Real values[7];
+            bool numbers = (count == 10) && parseNumber(tokens[0], site.index);
+            for (Index i = 0; i < 7 && numbers; ++i)
+                numbers = parseNumber(tokens[i + 1], values[i]);
+            if (!numbers)
+            {
+                error = at() + " isn't a site with index, position, spin norm, field, type and model";
+                break;
+            }
+            if (site.index >= this -> num_sites_)
+            {
+                error = at() + " has the site " + std::to_string(site.index) + ", but the sample has " + std::to_string(this -> num_sites_) + " sites";
+                break;
+            }
+            site.type = std::find(types.begin(), types.end(), tokens[8]) - types.begin();
+            if (site.type == num_types)
+            {
+                error = at() + " has the type " + std::string(tokens[8]) + ", which isn't in the header";
+                break;
+            }
+            std::string model(tokens[9]);
+            std::transform(model.begin(), model.end(), model.begin(), tolower);
+            site.model = modelFromName(model);
+            if (site.model == Model::UNKNOWN)
+            {
+                error = at() + " has the unknown model '" + model + "'";
+                break;
+            }
+            for (Index i = 0; i < 3; ++i)
+            {
+                site.position[i] = values[i];
+                site.field[i] = values[i + 4];
+            }
+            site.spinNorm = values[3];
+            sites.push_back(site);
+        }
+        else if (record < this -> num_sites_ + std::uint64_t(num_interactions))
+        {
+            SampleBond bond;
+            if (count != 3 || !parseNumber(tokens[0], bond.index) || !parseNumber(tokens[1], bond.nbh) || !parseNumber(tokens[2], bond.exchange))
+            {
+                error = at() + " isn't an interaction with two sites and an exchange";
+                break;
+            }
+            if (bond.index >= this -> num_sites_ || bond.nbh >= this -> num_sites_)
+            {
+                error = at() + " has an interaction with a site out of the " + std::to_string(this -> num_sites_) + " sites";
+                break;
+            }
+            bonds.push_back(bond);
+        }
+        else
+        {
+            error = at() + " is after the sites and interactions of the header";
+            break;
+        }
+        record++;
+    }
+
+    std::uint64_t errorLine = (error != "") ? current : std::numeric_limits<std::uint64_t>::max();
+    std::uint64_t firstError = errorLine;
+    MPI_Allreduce(MPI_IN_PLACE, &firstError, 1, MPI_UINT64_T, MPI_MIN, this -> comm_);
+    if (firstError != std::numeric_limits<std::uint64_t>::max())
+    {
+        if (errorLine == firstError)
+            ABORT(this -> comm_, "The sample file " + fileName + " can't be read because " + error + " !!!");
+        MPI_Barrier(this -> comm_);
+    }
+
+    // Bounding box and amounts of sites by type of the whole sample.
+    Real low[3] = {std::numeric_limits<Real>::max(), std::numeric_limits<Real>::max(), std::numeric_limits<Real>::max()};
+    Real high[3] = {std::numeric_limits<Real>::lowest(), std::numeric_limits<Real>::lowest(), std::numeric_limits<Real>::lowest()};
+    this -> sizesByIndex_ = std::vector<Index>(this -> num_types_, 0);
+    for (auto&& site : sites)
+    {
+        for (Index i = 0; i < 3; ++i)
+        {
+            low[i] = std::min(low[i], site.position[i]);
+            high[i] = std::max(high[i], site.position[i]);
+        }
+        this -> sizesByIndex_.at(site.type) += 1;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, low, 3, MPI_DOUBLE, MPI_MIN, this -> comm_);
+    MPI_Allreduce(MPI_IN_PLACE, high, 3, MPI_DOUBLE, MPI_MAX, this -> comm_);
+    MPI_Allreduce(MPI_IN_PLACE, this -> sizesByIndex_.data(), this -> num_types_, MPI_UNSIGNED, MPI_SUM, this -> comm_);
+
+    Index axis = 0;
+    for (Index i = 1; i < 3; ++i)
+        if (high[i] - low[i] > high[axis] - low[axis])
+            axis = i;
+    Real extent = high[axis] - low[axis];
+
+    auto bin = [&](const Real* position){
+        if (extent <= 0.0)
+            return Index(0);
+        Index b = Index((position[axis] - low[axis]) / extent * NUMBINS_PARTITION);
+        return std::min(b, NUMBINS_PARTITION - 1);
+    };
+
+    // Histogram along the longest axis, from which the bins are shared out
+    // between the halves of the slabs by their counts.
+    std::vector<Index> histogram(NUMBINS_PARTITION, 0);
+    for (auto&& site : sites)
+        histogram.at(bin(site.position)) += 1;
+    MPI_Allreduce(MPI_IN_PLACE, histogram.data(), NUMBINS_PARTITION, MPI_UNSIGNED, MPI_SUM, this -> comm_);
+
+    const Index num_domains = 2 * this -> size_;
+    std::vector<std::uint16_t> binDomains(NUMBINS_PARTITION);
+    std::uint64_t cumulative = 0;
+    for (Index b = 0; b < NUMBINS_PARTITION; ++b)
+    {
+        binDomains.at(b) = std::uint16_t(std::min<std::uint64_t>(num_domains - 1, cumulative * num_domains / this -> num_sites_));
+        cumulative += histogram.at(b);
+    }
+
+    // The domain of every site is known by all the ranks. Each rank adds
+    // 2^17 plus the domain plus one for its sites, so after the sum every
+    // site read once has 2^17 in the high bits and its domain in the low
+    // ones, and the repeated and missing sites are found.
+    std::vector<std::uint32_t> claims(this -> num_sites_, 0);
+    for (auto&& site : sites)
+        claims.at(site.index) += (1u << 17) + binDomains.at(bin(site.position)) + 1;
+    MPI_Allreduce(MPI_IN_PLACE, claims.data(), this -> num_sites_, MPI_UINT32_T, MPI_SUM, this -> comm_);
+    this -> domains_ = std::vector<std::uint16_t>(this -> num_sites_);
+    for (Index i = 0; i < this -> num_sites_; ++i)
+    {
+        const Index times = claims.at(i) >> 17;
+        if (times != 1)
+            fail(true, "The sample file " + fileName + " can't be read because the site " + std::to_string(i) +
+                       ((times == 0) ? " isn't in the file !!!" : " is repeated !!!"));
+        this -> domains_.at(i) = std::uint16_t((claims.at(i) & ((1u << 17) - 1)) - 1);
+    }
+    claims = std::vector<std::uint32_t>();
+
+    // The sites and the interactions are sent to the ranks which own them,
+    // keeping the order of the file.
+    auto sendToOwners = [this](const auto& items, auto owner){
+        typedef typename std::decay<decltype(items)>::type Items;
+        std::vector<int> sendCounts(this -> size_, 0);
+        for (auto&& item : items)
+            sendCounts.at(owner(item))++;
+        std::vector<int> sendDispls(this -> size_, 0);
+        for (int r = 1; r < this -> size_; ++r)
+            sendDispls.at(r) = sendDispls.at(r - 1) + sendCounts.at(r - 1);
+        Items sorted(items.size());
+        std::vector<int> next = sendDispls;
+        for (auto&& item : items)
+            sorted.at(next.at(owner(item))++) = item;
+
+        std::vector<int> recvCounts(this -> size_, 0);
+        MPI_Alltoall(sendCounts.data(), 1, MPI_INT, recvCounts.data(), 1, MPI_INT, this -> comm_);
+        std::vector<int> recvDispls(this -> size_, 0);
+        for (int r = 1; r < this -> size_; ++r)
+            recvDispls.at(r) = recvDispls.at(r - 1) + recvCounts.at(r - 1);
+
+        MPI_Datatype type;
+        MPI_Type_contiguous(sizeof(typename Items::value_type), MPI_BYTE, &type);
+        MPI_Type_commit(&type);
+        Items received(recvDispls.back() + recvCounts.back());
+        MPI_Alltoallv(sorted.data(), sendCounts.data(), sendDispls.data(), type,
+                      received.data(), recvCounts.data(), recvDispls.data(), type, this -> comm_);
+        MPI_Type_free(&type);
+        return received;
+    };
+    sites = sendToOwners(sites, [this](const SampleSite& site){ return int(this -> domains_.at(site.index) / 2); });
+    bonds = sendToOwners(bonds, [this](const SampleBond& bond){ return int(this -> domains_.at(bond.index) / 2); });
+
+    std::sort(sites.begin(), sites.end(), [](const SampleSite& a, const SampleSite& b){
+        return a.index < b.index;
+    });
+
+    std::unordered_map<Index, Index> localIndexes;
+    this -> num_local_ = sites.size();
+    for (Index i = 0; i < this -> num_local_; ++i)
+    {
+        localIndexes[sites.at(i).index] = i;
+        this -> globalIds_.push_back(sites.at(i).index);
+    }
+
+    struct Interaction
+    {
+        Index local;
+        Index nbh;
+        Real exchange;
+    };
+
+    std::vector<Interaction> interactions;
+    interactions.reserve(bonds.size());
+    for (auto&& bond : bonds)
+    {
+        if (localIndexes.count(bond.nbh) == 0)
+        {
+            localIndexes[bond.nbh] = this -> globalIds_.size();
+            this -> globalIds_.push_back(bond.nbh);
+        }
+        interactions.push_back({localIndexes.at(bond.index), localIndexes.at(bond.nbh), bond.exchange});
+    }
+    bonds = std::vector<SampleBond>();
+
+    // The vector is not resized anymore, so the pointers to the
+    // neighbors remain valid.
+    this -> atoms_ = std::vector<Atom>(this -> globalIds_.size());
+    for (Index i = 0; i < this -> num_local_; ++i)
+    {
+        const SampleSite& s = sites.at(i);
+        Atom& atom = this -> atoms_.at(i);
+        atom = Atom(s.index, {0.0, 0.0, s.spinNorm}, {s.position[0], s.position[1], s.position[2]});
+        atom.setExternalField({s.field[0], s.field[1], s.field[2]});
+        atom.setModel(s.model);
+        atom.setTypeIndex(s.type);
+
+        this -> phaseSites_[this -> domains_.at(s.index) % 2].push_back(i);
+    }
+    for (Index i = this -> num_local_; i < this -> atoms_.size(); ++i)
+        this -> atoms_.at(i) = Atom(this -> globalIds_.at(i), ZERO, ZERO);
+
+    for (auto&& interaction : interactions)
+    {
+        this -> atoms_.at(interaction.local).addNbh(&this -> atoms_.at(interaction.nbh));
+        this -> atoms_.at(interaction.local).addExchange(interaction.exchange);
+    }
+
+    // Two sites in the same phase but in different ranks are updated at
+    // the same time, so they can't interact.
+    Index conflicts = 0;
+    for (Index i = 0; i < this -> num_local_; ++i)
+    {
+        Index phase = this -> domains_.at(this -> globalIds_.at(i)) % 2;
+        for (auto&& nbh : this -> atoms_.at(i).getNbhs())
+        {
+            Index j = Index(nbh - &this -> atoms_.front());
+            if (j >= this -> num_local_ && this -> domains_.at(this -> globalIds_.at(j)) % 2 == phase)
+                conflicts++;
+        }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &conflicts, 1, MPI_UNSIGNED, MPI_SUM, this -> comm_);
+    if (conflicts > 0 && this -> rank_ == 0)
+        ABORT(this -> comm_, "The domains are thinner than the range of the interactions (" + std::to_string(conflicts) + " conflicts), use less ranks !!!");
+    MPI_Barrier(this -> comm_);
+}
+
+void DistributedSystem::setupHalo()
+{
+    // Each rank asks the owners for the spins of its halo, grouped by phase.
+    std::vector<int> requestCounts(2 * this -> size_, 0);
+    for (Index phase = 0; phase < 2; ++phase)
+    {
+        this -> sendSites_[phase] = std::vector< std::vector<Index> >(this -> size_);
+        this -> recvSites_[phase] = std::vector< std::vector<Index> >(this -> size_);
+    }
+
+    for (Index h = this -> num_local_; h < this -> atoms_.size(); ++h)
+    {
+        std::uint16_t domain = this -> domains_.at(this -> globalIds_.at(h));
+        this -> recvSites_[domain % 2].at(domain / 2).push_back(h);
+    }
+
+    std::vector<int> sendCounts(this -> size_, 0);
+    std::vector<int> sendDispls(this -> size_, 0);
+    std::vector<Index> requests;
+    for (int r = 0; r < this -> size_; ++r)
+    {
+        sendDispls.at(r) = requests.size();
+        for (Index phase = 0; phase < 2; ++phase)
+        {
+            requestCounts.at(2 * r + phase) = this -> recvSites_[phase].at(r).size();
+            for (auto&& h : this -> recvSites_[phase].at(r))
+                requests.push_back(this -> globalIds_.at(h));
+        }
+        sendCounts.at(r) = requests.size() - sendDispls.at(r);
+    }
+
+    std::vector<int> answerCounts(2 * this -> size_, 0);
+    MPI_Alltoall(requestCounts.data(), 2, MPI_INT, answerCounts.data(), 2, MPI_INT, this -> comm_);
+
+    std::vector<int> recvCounts(this -> size_, 0);
+    std::vector<int> recvDispls(this -> size_, 0);
+    int total = 0;
+    for (int r = 0; r < this -> size_; ++r)
+    {
+        recvDispls.at(r) = total;
+        recvCounts.at(r) = answerCounts.at(2 * r) + answerCounts.at(2 * r + 1);
+        total += recvCounts.at(r);
+    }
+
+    std::vector<Index> asked(total);
+    MPI_Alltoallv(requests.data(), sendCounts.data(), sendDispls.data(), MPI_UNSIGNED,
+                  asked.data(), recvCounts.data(), recvDispls.data(), MPI_UNSIGNED, this -> comm_);
+
+    for (int r = 0; r < this -> size_; ++r)
+    {
+        Index k = recvDispls.at(r);
+        for (Index phase = 0; phase < 2; ++phase)
+        {
+            for (int _ = 0; _ < answerCounts.at(2 * r + phase); ++_)
+            {
+                Index global = asked.at(k++);
+                auto position = std::lower_bound(this -> globalIds_.begin(), this -> globalIds_.begin() + this -> num_local_, global);
+                this -> sendSites_[phase].at(r).push_back(Index(position - this -> globalIds_.begin()));
+            }
+        }
+    }
+
+    for (int r = 0; r < this -> size_; ++r)
+    {
+        bool peer = false;
+        for (Index phase = 0; phase < 2; ++phase)
+            peer = peer || !this -> sendSites_[phase].at(r).empty() || !this -> recvSites_[phase].at(r).empty();
+        if (peer)
+            this -> peers_.push_back(r);
+    }
+}
+
+void DistributedSystem::exchangeHalo(Index phase)
+{
+    std::vector< std::vector<Real> > sendBuffers(this -> peers_.size());
+    std::vector< std::vector<Real> > recvBuffers(this -> peers_.size());
+    std::vector<MPI_Request> requests;
+
+    for (Index k = 0; k < this -> peers_.size(); ++k)
+    {
+        int r = this -> peers_.at(k);
+        const std::vector<Index>& recvSites = this -> recvSites_[phase].at(r);
+        if (!recvSites.empty())
+        {
+            recvBuffers.at(k) = std::vector<Real>(3 * recvSites.size());
+            requests.push_back(MPI_REQUEST_NULL);
+            MPI_Irecv(recvBuffers.at(k).data(), recvBuffers.at(k).size(), MPI_DOUBLE, r, phase, this -> comm_, &requests.back());
+        }
+
+        const std::vector<Index>& sendSites = this -> sendSites_[phase].at(r);
+        if (!sendSites.empty())
+        {
+            for (auto&& i : sendSites)
+                sendBuffers.at(k).insert(sendBuffers.at(k).end(), std::begin(this -> atoms_.at(i).getSpin()), std::end(this -> atoms_.at(i).getSpin()));
+            requests.push_back(MPI_REQUEST_NULL);
+            MPI_Isend(sendBuffers.at(k).data(), sendBuffers.at(k).size(), MPI_DOUBLE, r, phase, this -> comm_, &requests.back());
+        }
+    }
+
+    MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+
+    for (Index k = 0; k < this -> peers_.size(); ++k)
+    {
+        const std::vector<Index>& recvSites = this -> recvSites_[phase].at(this -> peers_.at(k));
+        for (Index n = 0; n < recvSites.size(); ++n)
+        {
+            const Real* spin = &recvBuffers.at(k).at(3 * n);
+            this -> atoms_.at(recvSites.at(n)).setSpin({spin[0], spin[1], spin[2]});
+        }
+    }
+}
+
+void DistributedSystem::randomizeSpins()
+{
+    for (Index i = 0; i < this -> num_local_; ++i)
+    {
+        Atom& atom = this -> atoms_.at(i);
+        atom.randomInitialState(this -> engine_,
+            this -> realRandomGenerator_,
+            this -> gaussianRandomGenerator_);
+    }
+    this -> exchangeHalo(0);
+    this -> exchangeHalo(1);
+}
+
+Real DistributedSystem::localEnergy(const Atom& atom, Real H) const
+{
+    Real energy = 0.0;
+    energy += atom.getExchangeEnergy();
+    energy += atom.getAnisotropyEnergy(atom);
+    energy += atom.getZeemanEnergy(H);
+    return energy;
+}
+
+void DistributedSystem::monteCarloStep(Real T, Real H)
+{
+    Index num = Index(this -> realRandomGenerator_(this -> engine_) * 5);
+    for (Index phase = 0; phase < 2; ++phase)
+    {
+        const std::vector<Index>& sites = this -> phaseSites_[phase];
+        if (!sites.empty())
+        {
+            std::uniform_int_distribution<Index> intRandomGenerator(0, sites.size() - 1);
+            for (Index _ = 0; _ < sites.size(); ++_)
+            {
+                Atom& atom = this -> atoms_.at(sites.at(intRandomGenerator(this -> engine_)));
+                Real oldEnergy = this -> localEnergy(atom, H);
+                atom.randomizeSpin(this -> engine_,
+                    this -> realRandomGenerator_,
+                    this -> gaussianRandomGenerator_,
+                    this -> sigma_.at(atom.getTypeIndex()), num);
+                Real newEnergy = this -> localEnergy(atom, H);
+                Real deltaEnergy = newEnergy - oldEnergy;
+
+                if (deltaEnergy > 0 && this -> realRandomGenerator_(this -> engine_) > std::exp(- deltaEnergy / (this -> kb_ * T)))
+                {
+                    atom.revertSpin();
+                    this -> counterRejections_.at(atom.getTypeIndex()) += 1;
+                }
+            }
+        }
+        this -> exchangeHalo(phase);
+    }
+}
+
+// The values are reduced over all the ranks with the layout: energy,
+// magnetizations (x, y, z) by type plus the total one, and rejections.
+void DistributedSystem::measure(Real H, std::vector<Real>& values)
+{
+    values.assign(1 + 3 * (this -> num_types_ + 1) + this -> num_types_, 0.0);
+    Real exchange_energy = 0.0;
+    Real other_energy = 0.0;
+    for (Index i = 0; i < this -> num_local_; ++i)
+    {
+        const Atom& atom = this -> atoms_.at(i);
+        exchange_energy += atom.getExchangeEnergy();
+        other_energy += atom.getAnisotropyEnergy(atom);
+        other_energy += atom.getZeemanEnergy(H);
+        for (Index c = 0; c < 3; ++c)
+        {
+            values.at(1 + 3 * atom.getTypeIndex() + c) += atom.getSpin()[c];
+            values.at(1 + 3 * this -> num_types_ + c) += atom.getSpin()[c];
+        }
+    }
+    values.at(0) = 0.5 * exchange_energy + other_energy;
+    for (Index t = 0; t < this -> num_types_; ++t)
+        values.at(1 + 3 * (this -> num_types_ + 1) + t) = this -> counterRejections_.at(t);
+
+    MPI_Allreduce(MPI_IN_PLACE, values.data(), values.size(), MPI_DOUBLE, MPI_SUM, this -> comm_);
+}
+
+void DistributedSystem::cycle()
+{
+    this -> createOutput();
+    this -> writeSites();
+
+    std::vector< std::vector<Real> > histMag(3 * (this -> num_types_ + 1));
+    std::vector<Real> values;
+
+    Index initial_time = 0;
+    Index final_time = 0;
+    Real av_time_per_step = 0.0;
+
+    for (Index index = 0; index < this -> temps_.size(); ++index)
+    {
+        initial_time = time(NULL);
+
+        Real T = this -> temps_.at(index);
+        Real H = this -> fields_.at(index);
+        std::vector<Real> enes;
+        for (auto& hist : histMag)
+            hist.clear();
+
+        for (Index _ = 0; _ < this -> mcs_; ++_)
+        {
+            this -> monteCarloStep(T, H);
+            this -> measure(H, values);
+
+            enes.push_back(values.at(0));
+            for (Index k = 0; k < histMag.size(); ++k)
+                histMag.at(k).push_back(values.at(1 + k));
+
+            // The sigma is adapted with the global rejections, so it is
+            // the same in all the ranks.
+            for (Index t = 0; t < this -> num_types_; ++t)
+            {
+                Real rejection = values.at(1 + 3 * (this -> num_types_ + 1) + t) / Real(this -> sizesByIndex_.at(t));
+                Real sigma_temp = this -> sigma_.at(t) * (0.5 / rejection);
+                if (sigma_temp > 60.0 || sigma_temp < 1e-10)
+                {
+                    sigma_temp = 60.0;
+                }
+                this -> sigma_.at(t) = sigma_temp;
+                this -> counterRejections_.at(t) = 0;
+            }
+        }
+
+        this -> writePoint(enes, histMag, index);
+
+        final_time = time(NULL);
+        av_time_per_step = (av_time_per_step*index + final_time - initial_time) / (index + 1);
+
+        if (this -> rank_ == 0)
+        {
+            Index seconds = av_time_per_step * (this -> temps_.size() - index);
+            rlutil::setColor(rlutil::YELLOW);
+            std::cout << "ETR: " << seconds / 3600 << ":" << (seconds % 3600) / 60 << ":"
+                      << (((seconds % 60) < 10) ? "0" : "") << seconds % 60;
+            rlutil::setColor(rlutil::LIGHTBLUE);
+            std::cout << std::setprecision(5) << std::fixed;
+            std::cout << "\t(" << 100.0 * (index + 1) / (this -> temps_.size()) << "%)";
+            rlutil::resetColor();
+            std::cout << "\t==>\tT = " << T << "; H = " << H << std::endl;
+        }
+    }
+
+    this -> closeOutput();
+}
+
+Index DistributedSystem::getNumSites() const
+{
+    return this -> num_sites_;
+}
+
+Index DistributedSystem::getNumLocalSites() const
+{
+    return this -> num_local_;
+}
+
+Index DistributedSystem::getNumHaloSites() const
+{
+    return this -> atoms_.size() - this -> num_local_;
+}
+
+const std::map<std::string, Index>& DistributedSystem::getMapTypeIndexes() const
+{
+    return this -> mapTypeIndexes_;
+}
+
+const std::vector<Index>& DistributedSystem::getSizesByIndex() const
+{
+    return this -> sizesByIndex_;
+}
+
+void DistributedSystem::createOutput()
+{
+    if (!PARALLEL_HDF5 && this -> rank_ != 0)
+        return;
+
+    hid_t fapl = H5Pcreate(H5P_FILE_ACCESS);
+#ifdef H5_HAVE_PARALLEL
+    H5Pset_fapl_mpio(fapl, this -> comm_, MPI_INFO_NULL);
+#endif
+    this -> file_ = H5Fcreate(this -> outName_.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, fapl);
+    H5Pclose(fapl);
+
+    // The time series are written by the rank 0 alone, which in parallel
+    // is only possible for datasets without filters.
+    hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+    if (!PARALLEL_HDF5)
+    {
+        hsize_t CHUNK[2] = {1, Index(this -> mcs_ / AMOUNTCHUNKS)};
+        H5Pset_deflate(dcpl, 1);
+        H5Pset_chunk(dcpl, 2, CHUNK);
+    }
+
+    hsize_t dims[2] = {this -> temps_.size(), this -> mcs_};
+    hid_t space = H5Screate_simple(2, dims, NULL);
+    this -> mags_dset_ = std::vector<hid_t>(3 * (this -> num_types_ + 1));
+    const char* axes[3] = {"_x", "_y", "_z"};
+    for (Index t = 0; t <= this -> num_types_; ++t)
+    {
+        std::string name = (t < this -> num_types_) ? this -> mapIndexTypes_.at(t) : "magnetization";
+        for (Index c = 0; c < 3; ++c)
+            this -> mags_dset_.at(3 * t + c) = H5Dcreate(this -> file_, (name + axes[c]).c_str(),
+                H5T_IEEE_F64LE, space, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+    }
+    this -> energies_dset_ = H5Dcreate(this -> file_, "energy",
+        H5T_IEEE_F64LE, space, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+    H5Sclose(space);
+    H5Pclose(dcpl);
+
+    hsize_t dims_points[1] = {this -> temps_.size()};
+    space = H5Screate_simple(1, dims_points, NULL);
+    hid_t temps_dset = H5Dcreate(this -> file_, "temperature", H5T_IEEE_F64LE, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    hid_t fields_dset = H5Dcreate(this -> file_, "field", H5T_IEEE_F64LE, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    if (this -> rank_ == 0)
+    {
+        H5Dwrite(temps_dset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, this -> temps_.data());
+        H5Dwrite(fields_dset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, this -> fields_.data());
+    }
+    H5Dclose(temps_dset);
+    H5Dclose(fields_dset);
+    for (auto&& name : {"tau_energy", "tau_magnetization",
+                        "ess_energy", "ess_magnetization",
+                        "error_energy", "error_magnetization"})
+        this -> statistics_dsets_.push_back(H5Dcreate(this -> file_, name,
+            H5T_IEEE_F64LE, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT));
+    H5Sclose(space);
+
+    hsize_t dims_finalstates[3] = {this -> temps_.size(), this -> num_sites_, 3};
+    space = H5Screate_simple(3, dims_finalstates, NULL);
+    this -> finalstates_dset_ = H5Dcreate(this -> file_, "finalstates", H5T_IEEE_F64LE, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    H5Sclose(space);
+
+    hid_t aid = H5Screate(H5S_SCALAR);
+    hid_t attr = H5Acreate(this -> file_, "mcs", H5T_NATIVE_INT, aid, H5P_DEFAULT, H5P_DEFAULT);
+    H5Awrite(attr, H5T_NATIVE_INT, &this -> mcs_);
+    H5Aclose(attr);
+    attr = H5Acreate(this -> file_, "seed", H5T_NATIVE_INT, aid, H5P_DEFAULT, H5P_DEFAULT);
+    H5Awrite(attr, H5T_NATIVE_INT, &this -> seed_);
+    H5Aclose(attr);
+    attr = H5Acreate(this -> file_, "kb", H5T_NATIVE_DOUBLE, aid, H5P_DEFAULT, H5P_DEFAULT);
+    H5Awrite(attr, H5T_NATIVE_DOUBLE, &this -> kb_);
+    H5Aclose(attr);
+    attr = H5Acreate(this -> file_, "ranks", H5T_NATIVE_INT, aid, H5P_DEFAULT, H5P_DEFAULT);
+    H5Awrite(attr, H5T_NATIVE_INT, &this -> size_);
+    H5Aclose(attr);
+    H5Sclose(aid);
+}
+
+// Writes 'values' ('elements' items of 'memtype' by site) in the rows of the
+// sites 'ids', which are sorted. If the dataset has three dimensions the
+// first one is the point, the second one is always the site.
+void DistributedSystem::writeRows(hid_t dset, hid_t memtype, Index elements, Index point,
+                                  const std::vector<Index>& ids, const void* values)
+{
+    hid_t filespace = H5Dget_space(dset);
+    int rank = H5Sget_simple_extent_ndims(filespace);
+    H5Sselect_none(filespace);
+
+    Index begin = 0;
+    while (begin < ids.size())
+    {
+        Index end = begin + 1;
+        while (end < ids.size() && ids.at(end) == ids.at(end - 1) + 1)
+            end++;
+
+        hsize_t start[3] = {ids.at(begin), 0, 0};
+        hsize_t count[3] = {end - begin, elements, 1};
+        if (rank == 3)
+        {
+            start[0] = point;
+            start[1] = ids.at(begin);
+            count[0] = 1;
+            count[1] = end - begin;
+            count[2] = elements;
+        }
+        H5Sselect_hyperslab(filespace, H5S_SELECT_OR, start, NULL, count, NULL);
+        begin = end;
+    }
+
+    hsize_t dims[1] = {std::max<hsize_t>(1, ids.size() * elements)};
+    hid_t memspace = H5Screate_simple(1, dims, NULL);
+    if (ids.empty())
+        H5Sselect_none(memspace);
+
+    hid_t xfer = H5Pcreate(H5P_DATASET_XFER);
+#ifdef H5_HAVE_PARALLEL
+    H5Pset_dxpl_mpio(xfer, H5FD_MPIO_COLLECTIVE);
+#endif
+    H5Dwrite(dset, memtype, memspace, filespace, xfer, values);
+    H5Pclose(xfer);
+    H5Sclose(memspace);
+    H5Sclose(filespace);
+}
+
+// Writes the rows of the local sites. Without a parallel HDF5 the rank 0
+// receives the rows of the other ranks one at a time, so its memory is
+// bounded by the largest domain.
+void DistributedSystem::writeSiteData(hid_t dset, hid_t memtype, Index elements, Index point,
+                                      const std::vector<char>& values)
+{
+    std::vector<Index> ids(this -> globalIds_.begin(), this -> globalIds_.begin() + this -> num_local_);
+    if (PARALLEL_HDF5)
+    {
+        this -> writeRows(dset, memtype, elements, point, ids, values.data());
+    }
+    else if (this -> rank_ == 0)
+    {
+        this -> writeRows(dset, memtype, elements, point, ids, values.data());
+        for (int r = 1; r < this -> size_; ++r)
+        {
+            MPI_Status status;
+            int count;
+            MPI_Probe(r, 0, this -> comm_, &status);
+            MPI_Get_count(&status, MPI_UNSIGNED, &count);
+            std::vector<Index> otherIds(count);
+            MPI_Recv(otherIds.data(), count, MPI_UNSIGNED, r, 0, this -> comm_, MPI_STATUS_IGNORE);
+
+            MPI_Probe(r, 1, this -> comm_, &status);
+            MPI_Get_count(&status, MPI_BYTE, &count);
+            std::vector<char> otherValues(count);
+            MPI_Recv(otherValues.data(), count, MPI_BYTE, r, 1, this -> comm_, MPI_STATUS_IGNORE);
+            this -> writeRows(dset, memtype, elements, point, otherIds, otherValues.data());
+        }
+    }
+    else
+    {
+        MPI_Send(ids.data(), ids.size(), MPI_UNSIGNED, 0, 0, this -> comm_);
+        MPI_Send(values.data(), values.size(), MPI_BYTE, 0, 1, this -> comm_);
+    }
+}
+
+void DistributedSystem::writeSites()
+{
+    // The types are stored as fixed length strings because parallel HDF5
+    // can't write variable length data.
+    Index width = 1;
+    for (auto&& type : this -> mapTypeIndexes_)
+        width = std::max<Index>(width, type.first.size());
+
+    std::vector<char> positions(3 * sizeof(Real) * this -> num_local_);
+    std::vector<char> types(width * this -> num_local_, '\0');
+    for (Index i = 0; i < this -> num_local_; ++i)
+    {
+        const Atom& atom = this -> atoms_.at(i);
+        std::memcpy(&positions.at(3 * sizeof(Real) * i), &atom.getPosition()[0], 3 * sizeof(Real));
+        const std::string& type = this -> mapIndexTypes_.at(atom.getTypeIndex());
+        std::memcpy(&types.at(width * i), type.data(), type.size());
+    }
+
+    hid_t types_dset = -1;
+    hid_t position_dset = -1;
+    hid_t stringtype = H5Tcopy(H5T_C_S1);
+    H5Tset_size(stringtype, width);
+    H5Tset_strpad(stringtype, H5T_STR_NULLPAD);
+    if (PARALLEL_HDF5 || this -> rank_ == 0)
+    {
+        hsize_t dims_types[1] = {this -> num_sites_};
+        hid_t space = H5Screate_simple(1, dims_types, NULL);
+        types_dset = H5Dcreate(this -> file_, "types", stringtype, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+        H5Sclose(space);
+
+        hsize_t dims_pos[2] = {this -> num_sites_, 3};
+        space = H5Screate_simple(2, dims_pos, NULL);
+        position_dset = H5Dcreate(this -> file_, "positions", H5T_IEEE_F64LE, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+        H5Sclose(space);
+    }
+
+    this -> writeSiteData(types_dset, stringtype, 1, 0, types);
+    this -> writeSiteData(position_dset, H5T_NATIVE_DOUBLE, 3, 0, positions);
+
+    if (PARALLEL_HDF5 || this -> rank_ == 0)
+    {
+        H5Dclose(types_dset);
+        H5Dclose(position_dset);
+    }
+    H5Tclose(stringtype);
+}
+
+void DistributedSystem::writePoint(const std::vector<Real>& enes,
+                                   const std::vector< std::vector<Real> >& histMag,
+                                   Index index)
+{
+    if (this -> rank_ == 0)
+    {
+        hsize_t start[2] = {index, 0};
+        hsize_t count[2] = {1, this -> mcs_};
+        hsize_t dims[1] = {this -> mcs_};
+        hid_t memspace = H5Screate_simple(1, dims, NULL);
+
+        auto writeSeries = [&](hid_t dset, const std::vector<Real>& series){
+            hid_t filespace = H5Dget_space(dset);
+            H5Sselect_hyperslab(filespace, H5S_SELECT_SET, start, NULL, count, NULL);
+            H5Dwrite(dset, H5T_NATIVE_DOUBLE, memspace, filespace, H5P_DEFAULT, series.data());
+            H5Sclose(filespace);
+        };
+
+        writeSeries(this -> energies_dset_, enes);
+        for (Index k = 0; k < histMag.size(); ++k)
+            writeSeries(this -> mags_dset_.at(k), histMag.at(k));
+        H5Sclose(memspace);
+
+        const Index total = 3 * this -> num_types_;
+        std::vector<Real> mags(enes.size());
+        for (Index t = 0; t < mags.size(); ++t)
+            mags.at(t) = std::sqrt(histMag.at(total).at(t) * histMag.at(total).at(t) +
+                                   histMag.at(total + 1).at(t) * histMag.at(total + 1).at(t) +
+                                   histMag.at(total + 2).at(t) * histMag.at(total + 2).at(t));
+        const Index thermalization = this -> mcs_ / THERMALIZATION_FRACTION;
+        SeriesStatistics energy = analyzeSeries(enes, thermalization);
+        SeriesStatistics magnetization = analyzeSeries(mags, thermalization);
+        const double values[6] = {energy.tau, magnetization.tau,
+                                  energy.ess, magnetization.ess,
+                                  energy.error, magnetization.error};
+        hsize_t point[1] = {index};
+        hsize_t one[1] = {1};
+        memspace = H5Screate_simple(1, one, NULL);
+        for (Index k = 0; k < this -> statistics_dsets_.size(); ++k)
+        {
+            hid_t filespace = H5Dget_space(this -> statistics_dsets_.at(k));
+            H5Sselect_hyperslab(filespace, H5S_SELECT_SET, point, NULL, one, NULL);
+            H5Dwrite(this -> statistics_dsets_.at(k), H5T_NATIVE_DOUBLE, memspace, filespace, H5P_DEFAULT, &values[k]);
+            H5Sclose(filespace);
+        }
+        H5Sclose(memspace);
+    }
+
+    std::vector<char> spins(3 * sizeof(Real) * this -> num_local_);
+    for (Index i = 0; i < this -> num_local_; ++i)
+        std::memcpy(&spins.at(3 * sizeof(Real) * i), &this -> atoms_.at(i).getSpin()[0], 3 * sizeof(Real));
+    this -> writeSiteData(this -> finalstates_dset_, H5T_NATIVE_DOUBLE, 3, index, spins);
+}
+
+void DistributedSystem::closeOutput()
+{
+    if (!PARALLEL_HDF5 && this -> rank_ != 0)
+        return;
+
+    for (auto&& dset : this -> mags_dset_)
+        H5Dclose(dset);
+    H5Dclose(this -> energies_dset_);
+    H5Dclose(this -> finalstates_dset_);
+    for (auto&& dset : this -> statistics_dsets_)
+        H5Dclose(dset);
+    H5Fclose(this -> file_);
+}
@@ -0,0 +1,82 @@
+#include "../include/fft.h"
+
+#include <cmath>
+
+Index nextPowerOfTwo(Index n)
+{
+    Index power = 1;
+    while (power < n)
+        power <<= 1;
+    return power;
+}
+
+void fft(Complex* data, Index n, Index stride, bool inverse)
+{
+    // Bit reversal permutation.
+    for (Index i = 1, j = 0; i < n; ++i)
+    {
+        Index bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+            std::swap(data[i * stride], data[j * stride]);
+    }
+
+    const Real sign = inverse ? 1.0 : -1.0;
+    for (Index length = 2; length <= n; length <<= 1)
+    {
+        Real angle = sign * 2.0 * M_PI / Real(length);
+        Complex root(std::cos(angle), std::sin(angle));
+        for (Index start = 0; start < n; start += length)
+        {
+            Complex w(1.0, 0.0);
+            for (Index k = 0; k < length / 2; ++k)
+            {
+                Complex& a = data[(start + k) * stride];
+                Complex& b = data[(start + k + length / 2) * stride];
+                Complex t = w * b;
+                b = a - t;
+                a += t;
+                w *= root;
+            }
+        }
+    }
+}
+
+void fft(std::vector<Complex>& data, bool inverse)
+{
+    fft(data.data(), data.size(), 1, inverse);
+}
+
+void fft3d(std::vector<Complex>& data, const Index dims[3], bool inverse)
+{
+    fft3d(data, dims, inverse, dims);
+}
+
+void fft3d(std::vector<Complex>& data, const Index dims[3], bool inverse, const Index extents[3])
+{
+    const Index strides[3] = {dims[1] * dims[2], dims[2], 1};
+    for (Index axis = 0; axis < 3; ++axis)
+    {
+        if (dims[axis] == 1)
+            continue;
+
+        // The lines along 'axis' start at every point with a zero
+        // coordinate in that axis. In the direct transform the axes not
+        // transformed yet are only non zero inside the extents, and in the
+        // inverse one only the extents of the transformed axes are needed.
+        const Index a = (axis == 0) ? 1 : 0;
+        const Index b = (axis == 2) ? 1 : 2;
+        const Index sizeA = ((a > axis) != inverse) ? extents[a] : dims[a];
+        const Index sizeB = ((b > axis) != inverse) ? extents[b] : dims[b];
+        const long lines = long(sizeA) * sizeB;
+        #pragma omp parallel for schedule(static)
+        for (long line = 0; line < lines; ++line)
+        {
+            Index i = line / sizeB;
+            Index j = line % sizeB;
+            fft(&data[i * strides[a] + j * strides[b]], dims[axis], strides[axis], inverse);
+        }
+    }
+}
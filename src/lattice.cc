@@ -1,71 +1,319 @@
 #include "../include/lattice.h"
+#include "../include/textfile.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <numeric>
+
+const Index BITS_CURVE = 21;
+
+// Bytes of the chunks in which the sample files are parsed in parallel.
+const std::size_t SAMPLECHUNK = 1 << 22;
+
+// Interleaves the bits of the three coordinates, the most significant first.
+std::uint64_t interleaveBits(const std::uint32_t X[3])
+{
+    std::uint64_t key = 0;
+    for (int b = BITS_CURVE - 1; b >= 0; --b)
+        for (Index i = 0; i < 3; ++i)
+            key = (key << 1) | ((X[i] >> b) & 1);
+    return key;
+}
+
+std::uint64_t mortonKey(std::uint32_t X[3])
+{
+    return interleaveBits(X);
+}
+
+// Hilbert index through the transposed representation of J. Skilling,
+// "Programming the Hilbert curve", AIP Conf. Proc. 707, 381 (2004).
+std::uint64_t hilbertKey(std::uint32_t X[3])
+{
+    const std::uint32_t M = std::uint32_t(1) << (BITS_CURVE - 1);
+    for (std::uint32_t Q = M; Q > 1; Q >>= 1)
+    {
+        std::uint32_t P = Q - 1;
+        for (Index i = 0; i < 3; ++i)
+        {
+            if (X[i] & Q)
+            {
+                X[0] ^= P;
+            }
+            else
+            {
+                std::uint32_t t = (X[0] ^ X[i]) & P;
+                X[0] ^= t;
+                X[i] ^= t;
+            }
+        }
+    }
+
+    for (Index i = 1; i < 3; ++i)
+        X[i] ^= X[i - 1];
+    std::uint32_t t = 0;
+    for (std::uint32_t Q = M; Q > 1; Q >>= 1)
+        if (X[2] & Q)
+            t ^= Q - 1;
+    for (Index i = 0; i < 3; ++i)
+        X[i] ^= t;
+
+    return interleaveBits(X);
+}
 
 
 Lattice::Lattice(std::string fileName)
 {
-    std::ifstream file(fileName);
+    this -> error_ = this -> readSample(fileName);
+}
 
-    Index num_ions;
-    Index num_interactions;
-    Index num_types;
+// The sample is mapped and, after the header, split into chunks of whole
+// lines. A first pass counts the lines of each chunk, so every chunk knows
+// the numbers of its lines and records, and a second pass parses the sites
+// and interactions of all the chunks in parallel. The neighbors are then
+// inserted site by site into tables reserved with their exact sizes.
+std::string Lattice::readSample(const std::string& fileName)
+{
+    TextFile file;
+    std::string reason = file.open(fileName);
+    if (reason != "")
+        return reason;
 
-    file >> num_ions >> num_interactions >> num_types;
+    const char* p = file.begin();
+    Index line = 1;
+    std::string_view token;
+    Index num_ions = 0;
+    std::uint64_t amount = 0;
+    Index num_types = 0;
+    if (!nextToken(p, file.end(), line, token) || !parseNumber(token, num_ions) ||
+        !nextToken(p, file.end(), line, token) || !parseNumber(token, amount) ||
+        !nextToken(p, file.end(), line, token) || !parseNumber(token, num_types))
+        return "the line " + std::to_string(line) + " doesn't have the amounts of sites, interactions and types";
+    // The header is read in 64 bits, so a sample too large for this build
+    // isn't mistaken for a malformed one. The records of the sites and the
+    // interactions are counted together.
+    if (amount > std::numeric_limits<LongIndex>::max() - num_ions)
+        return "it has more interactions than the supported by the indexes, build vegas with -DVEGAS_LARGE_SAMPLES=ON";
+    const LongIndex num_interactions = LongIndex(amount);
 
+    std::vector<std::string> types;
     for (Index i = 0; i < num_types; ++i)
     {
-        std::string type;
-        file >> type;
-        this -> mapTypeIndexes_[type] = i;
-        this -> mapIndexTypes_[i] = type;
+        if (!nextToken(p, file.end(), line, token))
+            return "the file ends before the " + std::to_string(num_types) + " types";
+        types.push_back(std::string(token));
+        this -> mapTypeIndexes_[types.back()] = i;
+        this -> mapIndexTypes_[i] = types.back();
     }
 
-    this -> sizesByIndex_ = std::vector<Index>(num_types);
+    std::vector<const char*> starts = file.splitLines(p, SAMPLECHUNK);
+    starts.push_back(file.end());
+    const Index num_chunks = starts.size() - 1;
+
+    // Lines and non blank lines (records) of each chunk.
+    std::vector<Index> firstLine(num_chunks + 1, line);
+    std::vector<LongIndex> firstRecord(num_chunks + 1, 0);
+    #pragma omp parallel for schedule(dynamic)
+    for (Index c = 0; c < num_chunks; ++c)
+    {
+        Index lines = 0;
+        LongIndex records = 0;
+        for (const char* q = starts[c]; q < starts[c + 1]; ++lines)
+        {
+            const char* end = lineEnd(q, starts[c + 1]);
+            if (splitTokens(q, end, &token, 0) != 0)
+                records++;
+            q = end + 1;
+        }
+        firstLine[c + 1] = lines;
+        firstRecord[c + 1] = records;
+    }
+    for (Index c = 0; c < num_chunks; ++c)
+    {
+        firstLine[c + 1] += firstLine[c];
+        firstRecord[c + 1] += firstRecord[c];
+    }
+    if (firstRecord[num_chunks] < num_ions + LongIndex(num_interactions))
+        return "the file ends before the " + std::to_string(num_ions) + " sites and " + std::to_string(num_interactions) + " interactions of its header";
 
     this -> atoms_ = std::vector<Atom>(num_ions);
-    Real px;
-    Real py;
-    Real pz;
-    Real spinNorm;
-    Real hx;
-    Real hy;
-    Real hz;
-    std::string type;
-    std::string model;
+    std::vector<Index> from(num_interactions);
+    std::vector<Index> to(num_interactions);
+    std::vector<Real> exchanges(num_interactions);
+    std::vector<unsigned char> read(num_ions, 0);
 
-    for (Index index = 0; index < num_ions; ++index)
+    // Only the error of the first line is reported.
+    std::vector<std::string> errors(num_chunks);
+    #pragma omp parallel for schedule(dynamic)
+    for (Index c = 0; c < num_chunks; ++c)
     {
-        file >> index >> px >> py >> pz >> spinNorm >> hx >> hy >> hz >> type >> model;
+        std::string_view tokens[10];
+        Index current = firstLine[c];
+        LongIndex record = firstRecord[c];
+        for (const char* q = starts[c]; q < starts[c + 1] && errors[c] == ""; ++current)
+        {
+            const char* end = lineEnd(q, starts[c + 1]);
+            Index count = splitTokens(q, end, tokens, 10);
+            q = end + 1;
+            if (count == 0)
+                continue;
+
+            // The prefix of the errors is only built when one is found.
+            auto at = [current](){ return "the line " + std::to_string(current); };
+            if (record < num_ions)
+            {
+                Index index;
+                Real values[7];
+                bool numbers = (count == 10) && parseNumber(tokens[0], index);
+                for (Index i = 0; i < 7 && numbers; ++i)
+                    numbers = parseNumber(tokens[i + 1], values[i]);
+                if (!numbers)
+                {
+                    errors[c] = at() + " isn't a site with index, position, spin norm, field, type and model";
+                    break;
+                }
+                if (index >= num_ions)
+                {
+                    errors[c] = at() + " has the site " + std::to_string(index) + ", but the sample has " + std::to_string(num_ions) + " sites";
+                    break;
+                }
+                Index type = std::find(types.begin(), types.end(), tokens[8]) - types.begin();
+                if (type == num_types)
+                {
+                    errors[c] = at() + " has the type " + std::string(tokens[8]) + ", which isn't in the header";
+                    break;
+                }
 
-        Array position({px, py, pz});
+                // Each site is claimed before it's built, so the chunks
+                // never write the same atom at once.
+                unsigned char claimed;
+                #pragma omp atomic capture
+                {
+                    claimed = read[index];
+                    read[index] = 1;
+                }
+                if (claimed)
+                {
+                    errors[c] = at() + " repeats the site " + std::to_string(index);
+                    break;
+                }
 
-        Array spin({0.0, 0.0, spinNorm}); // ALWAYS THE INITIAL SPIN WILL BE IN THE Z-DIRECTION
+                std::string model(tokens[9]);
+                std::transform(model.begin(), model.end(), model.begin(), tolower);
 
-        std::transform(model.begin(), model.end(), model.begin(), tolower);
+                // ALWAYS THE INITIAL SPIN WILL BE IN THE Z-DIRECTION
+                Atom& atom = this -> atoms_[index];
+                atom = Atom(index, {0.0, 0.0, values[3]}, {values[0], values[1], values[2]});
+                atom.setExternalField({values[4], values[5], values[6]});
+                atom.setModel(modelFromName(model));
+                atom.setTypeIndex(type);
+            }
+            else if (record < num_ions + LongIndex(num_interactions))
+            {
+                LongIndex k = record - num_ions;
+                if (count != 3 || !parseNumber(tokens[0], from[k]) || !parseNumber(tokens[1], to[k]) || !parseNumber(tokens[2], exchanges[k]))
+                {
+                    errors[c] = at() + " isn't an interaction with two sites and an exchange";
+                    break;
+                }
+                if (from[k] >= num_ions || to[k] >= num_ions)
+                {
+                    errors[c] = at() + " has an interaction with a site out of the " + std::to_string(num_ions) + " sites";
+                    break;
+                }
+            }
+            else
+            {
+                errors[c] = at() + " is after the sites and interactions of the header";
+                break;
+            }
+            record++;
+        }
+    }
+    for (auto&& error : errors)
+        if (error != "")
+            return error;
 
-        Atom atom(index, spin, position);
-        atom.setType(type);
-        atom.setExternalField({hx, hy, hz});
-        atom.setModel(model);
-        atom.setTypeIndex(this -> mapTypeIndexes_.at(type));
+    Index missing = std::find(read.begin(), read.end(), 0) - read.begin();
+    if (missing != num_ions)
+        return "the site " + std::to_string(missing) + " isn't in the file";
 
-        this -> atoms_.at(index) = atom;
+    this -> sizesByIndex_ = std::vector<Index>(num_types);
+    for (auto&& atom : this -> atoms_)
+        this -> sizesByIndex_.at(atom.getTypeIndex()) += 1;
 
+    this -> siteByIndex_ = std::vector<Index>(num_ions);
+    std::iota(this -> siteByIndex_.begin(), this -> siteByIndex_.end(), 0);
 
-        this -> sizesByIndex_.at(this -> mapTypeIndexes_.at(type)) += 1;
+    // The neighbors of each site keep the order of the file.
+    std::vector<Index> counts(num_ions, 0);
+    for (LongIndex k = 0; k < num_interactions; ++k)
+        counts[from[k]]++;
+    for (Index i = 0; i < num_ions; ++i)
+        this -> atoms_[i].reserveNbhs(counts[i]);
+    for (LongIndex k = 0; k < num_interactions; ++k)
+    {
+        this -> atoms_[from[k]].addNbh(&this -> atoms_[to[k]]);
+        this -> atoms_[from[k]].addExchange(exchanges[k]);
     }
 
-    Index index;
-    Index nbh;
-    Real exchange;
-    for (Index _ = 0; _ < num_interactions; ++_)
+    return "";
+}
+
+Lattice::Lattice(const UnitCell& cell)
+{
+    std::vector<std::string> types = cell.getTypes();
+    for (Index i = 0; i < types.size(); ++i)
     {
-        file >> index >> nbh >> exchange;
-        this -> atoms_.at(index).addNbh(&this -> atoms_.at(nbh));
-        this -> atoms_.at(index).addExchange(exchange);
+        this -> mapTypeIndexes_[types.at(i)] = i;
+        this -> mapIndexTypes_[i] = types.at(i);
     }
 
+    const std::vector<BasisSite>& basis = cell.getBasis();
+    // The amount of sites of a checked cell fits in an Index.
+    const Index num_cells = Index(cell.getNumCells());
+    const Index num_ions = Index(cell.getNumSites());
+    this -> atoms_ = std::vector<Atom>(num_ions);
+
+    // Every cell only writes its own atoms, so the cells are independent.
+    #pragma omp parallel for schedule(static)
+    for (Index c = 0; c < num_cells; ++c)
+    {
+        int position[3];
+        cell.getCellPosition(c, position);
+        for (Index b = 0; b < basis.size(); ++b)
+        {
+            const BasisSite& site = basis.at(b);
+            Index index = c * basis.size() + b;
+
+            std::string model = site.model;
+            std::transform(model.begin(), model.end(), model.begin(), tolower);
+
+            Atom& atom = this -> atoms_[index];
+            atom = Atom(index, {0.0, 0.0, site.spinNorm}, cell.getPosition(position, b));
+            atom.setExternalField(site.field);
+            atom.setModel(modelFromName(model));
+            atom.setTypeIndex(this -> mapTypeIndexes_.at(site.type));
+
+            Index nbh;
+            for (auto&& bond : cell.getStencil().at(b))
+            {
+                if (cell.getNeighbor(position, b, bond, nbh))
+                {
+                    atom.addNbh(&this -> atoms_[nbh]);
+                    atom.addExchange(bond.exchange);
+                }
+            }
+        }
+    }
+
+    this -> sizesByIndex_ = std::vector<Index>(types.size());
+    for (auto&& atom : this -> atoms_)
+        this -> sizesByIndex_.at(atom.getTypeIndex()) += 1;
+
+    this -> siteByIndex_ = std::vector<Index>(num_ions);
+    std::iota(this -> siteByIndex_.begin(), this -> siteByIndex_.end(), 0);
 }
 
 Lattice::~Lattice()
@@ -73,6 +321,23 @@ Lattice::~Lattice()
 
 }
 
+const std::string& Lattice::getError() const
+{
+    return this -> error_;
+}
+
+Real Lattice::getMemoryBySite() const
+{
+    if (this -> atoms_.empty())
+        return 0.0;
+
+    double bytes = 0.0;
+    for (auto&& atom : this -> atoms_)
+        bytes += atom.getMemory();
+    bytes += this -> siteByIndex_.capacity() * sizeof(Index);
+    return bytes / this -> atoms_.size();
+}
+
 std::vector<Atom>& Lattice::getAtoms()
 {
     return this -> atoms_;
@@ -92,3 +357,269 @@ const std::vector<Index>& Lattice::getSizesByIndex() const
 {
     return this -> sizesByIndex_;
 }
+
+Index Lattice::getSiteByIndex(Index index) const
+{
+    return this -> siteByIndex_.at(index);
+}
+
+std::vector<Index> Lattice::computeCurveOrder(const std::string& method) const
+{
+    Array low = this -> atoms_.at(0).getPosition();
+    Array high = this -> atoms_.at(0).getPosition();
+    for (auto& atom : this -> atoms_)
+    {
+        for (Index i = 0; i < 3; ++i)
+        {
+            low[i] = std::min(low[i], atom.getPosition()[i]);
+            high[i] = std::max(high[i], atom.getPosition()[i]);
+        }
+    }
+
+    const Real cells = Real((std::uint32_t(1) << BITS_CURVE) - 1);
+    std::vector<std::uint64_t> keys(this -> atoms_.size());
+    for (Index site = 0; site < this -> atoms_.size(); ++site)
+    {
+        std::uint32_t X[3];
+        for (Index i = 0; i < 3; ++i)
+        {
+            Real extent = high[i] - low[i];
+            Real scaled = (extent > 0.0) ? (this -> atoms_.at(site).getPosition()[i] - low[i]) / extent : 0.0;
+            X[i] = std::uint32_t(scaled * cells);
+        }
+        keys.at(site) = (method == "hilbert") ? hilbertKey(X) : mortonKey(X);
+    }
+
+    std::vector<Index> order(this -> atoms_.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&keys](Index a, Index b){
+        return keys[a] < keys[b];
+    });
+    return order;
+}
+
+std::vector<Index> Lattice::computeCuthillMcKeeOrder() const
+{
+    const Atom* first = &this -> atoms_.front();
+    const Index N = this -> atoms_.size();
+
+    // The interactions of a sample file don't need to be symmetric, so the
+    // searches run over the symmetrized graph, whose components hold every
+    // site reachable from their sites.
+    std::vector<LongIndex> starts(N + 1, 0);
+    for (Index site = 0; site < N; ++site)
+    {
+        for (auto&& nbh : this -> atoms_[site].getNbhs())
+        {
+            starts[site + 1]++;
+            starts[Index(nbh - first) + 1]++;
+        }
+    }
+    for (Index site = 0; site < N; ++site)
+        starts[site + 1] += starts[site];
+    std::vector<Index> adjacency(starts[N]);
+    // The own neighbors of each site go first, so the searches over
+    // symmetric samples visit them in the same order as the atoms.
+    std::vector<LongIndex> next(starts.begin(), starts.end() - 1);
+    for (Index site = 0; site < N; ++site)
+        for (auto&& nbh : this -> atoms_[site].getNbhs())
+            adjacency[next[site]++] = Index(nbh - first);
+    for (Index site = 0; site < N; ++site)
+    {
+        for (auto&& nbh : this -> atoms_[site].getNbhs())
+        {
+            const Index other = Index(nbh - first);
+            adjacency[next[other]++] = site;
+        }
+    }
+
+    auto degree = [&starts](Index site){
+        return starts[site + 1] - starts[site];
+    };
+
+    // Breadth-first search from 'root' which visits the neighbors by
+    // increasing degree, skipping the sites already placed. It returns the
+    // last site visited. Each search marks the sites with its own stamp.
+    std::vector<Index> stamp(N, 0);
+    Index currentStamp = 0;
+    std::vector<bool> placed(N, false);
+    std::vector<Index> order;
+    order.reserve(N);
+    auto bfs = [&](Index root, bool keep){
+        currentStamp++;
+        std::queue<Index> queue;
+        queue.push(root);
+        stamp[root] = currentStamp;
+        Index last = root;
+        std::vector<Index> nbhs;
+        while (!queue.empty())
+        {
+            Index site = queue.front();
+            queue.pop();
+            last = site;
+            if (keep)
+            {
+                order.push_back(site);
+                placed[site] = true;
+            }
+
+            nbhs.clear();
+            for (LongIndex k = starts[site]; k < starts[site + 1]; ++k)
+            {
+                Index other = adjacency[k];
+                if (stamp[other] != currentStamp && !placed[other])
+                {
+                    stamp[other] = currentStamp;
+                    nbhs.push_back(other);
+                }
+            }
+            std::stable_sort(nbhs.begin(), nbhs.end(), [&degree](Index a, Index b){
+                return degree(a) < degree(b);
+            });
+            for (auto&& other : nbhs)
+                queue.push(other);
+        }
+        return last;
+    };
+
+    std::vector<Index> byDegree(N);
+    std::iota(byDegree.begin(), byDegree.end(), 0);
+    std::stable_sort(byDegree.begin(), byDegree.end(), [&degree](Index a, Index b){
+        return degree(a) < degree(b);
+    });
+
+    for (auto&& start : byDegree)
+    {
+        if (placed[start])
+            continue;
+
+        // A pseudo-peripheral site of the component is the farthest site
+        // from the site of minimum degree. The component is symmetric, so
+        // the search from it places 'start' too.
+        Index root = bfs(start, false);
+        bfs(root, true);
+    }
+
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+Lattice::Lattice(const Lattice& other)
+    : atoms_(other.atoms_),
+      siteByIndex_(other.siteByIndex_),
+      mapTypeIndexes_(other.mapTypeIndexes_),
+      mapIndexTypes_(other.mapIndexTypes_),
+      sizesByIndex_(other.sizesByIndex_),
+      error_(other.error_)
+{
+    if (!other.atoms_.empty())
+        this -> remapNeighbors(&other.atoms_.front());
+}
+
+Lattice& Lattice::operator=(const Lattice& other)
+{
+    if (this != &other)
+    {
+        this -> atoms_ = other.atoms_;
+        this -> siteByIndex_ = other.siteByIndex_;
+        this -> mapTypeIndexes_ = other.mapTypeIndexes_;
+        this -> mapIndexTypes_ = other.mapIndexTypes_;
+        this -> sizesByIndex_ = other.sizesByIndex_;
+        this -> error_ = other.error_;
+        if (!other.atoms_.empty())
+            this -> remapNeighbors(&other.atoms_.front());
+    }
+    return *this;
+}
+
+// The neighbors of the copied atoms still point to the atoms of the
+// original lattice, whose first atom is 'first'.
+void Lattice::remapNeighbors(const Atom* first)
+{
+    for (auto& atom : this -> atoms_)
+    {
+        std::vector<Atom*> nbhs;
+        nbhs.reserve(atom.getNbhs().size());
+        for (auto&& nbh : atom.getNbhs())
+            nbhs.push_back(&this -> atoms_.at(Index(nbh - first)));
+        atom.setNbhs(nbhs);
+    }
+}
+
+void Lattice::reorder(const std::string& method)
+{
+    std::vector<Index> order;
+    if (method == "none")
+        return;
+    else if (method == "morton" || method == "hilbert")
+        order = this -> computeCurveOrder(method);
+    else if (method == "rcm")
+        order = this -> computeCuthillMcKeeOrder();
+    else
+        return;
+
+    const Atom* first = &this -> atoms_.front();
+    std::vector<Index> newSite(this -> atoms_.size());
+    for (Index site = 0; site < order.size(); ++site)
+        newSite.at(order.at(site)) = site;
+
+    std::vector<Atom> atoms(this -> atoms_.size());
+    for (Index site = 0; site < order.size(); ++site)
+        atoms.at(site) = this -> atoms_.at(order.at(site));
+
+    for (auto& atom : atoms)
+    {
+        std::vector<Atom*> nbhs;
+        nbhs.reserve(atom.getNbhs().size());
+        for (auto&& nbh : atom.getNbhs())
+            nbhs.push_back(&atoms.at(newSite.at(Index(nbh - first))));
+        atom.setNbhs(nbhs);
+    }
+
+    this -> atoms_.swap(atoms);
+
+    for (Index site = 0; site < this -> atoms_.size(); ++site)
+        this -> siteByIndex_.at(this -> atoms_.at(site).getIndex()) = site;
+}
+
+std::string Lattice::mapToGrid(Array& spacing, Index sizes[3], std::vector<Index>& cells)
+{
+    const Index N = this -> atoms_.size();
+    if (N == 0)
+        return "the sample is empty";
+
+    cells = std::vector<Index>(3 * N);
+    for (Index a = 0; a < 3; ++a)
+    {
+        std::vector<Real> coords(N);
+        for (Index i = 0; i < N; ++i)
+            coords.at(i) = this -> atoms_.at(i).getPosition()[a];
+        std::sort(coords.begin(), coords.end());
+        const Real low = coords.front();
+        const Real high = coords.back();
+
+        if (spacing[a] <= 0.0)
+        {
+            spacing[a] = 0.0;
+            for (Index i = 1; i < N; ++i)
+            {
+                Real delta = coords.at(i) - coords.at(i - 1);
+                if (delta > 1e-6 && (spacing[a] == 0.0 || delta < spacing[a]))
+                    spacing[a] = delta;
+            }
+            if (spacing[a] == 0.0)
+                spacing[a] = 1.0;
+        }
+
+        sizes[a] = Index(std::round((high - low) / spacing[a])) + 1;
+        for (Index i = 0; i < N; ++i)
+        {
+            Real x = (this -> atoms_.at(i).getPosition()[a] - low) / spacing[a];
+            Real cell = std::round(x);
+            if (std::fabs(x - cell) > 1e-4)
+                return "the site " + std::to_string(this -> atoms_.at(i).getIndex()) + " is not on the grid of the sample";
+            cells.at(3 * i + a) = Index(cell);
+        }
+    }
+    return "";
+}
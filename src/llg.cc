@@ -0,0 +1,178 @@
+#include "../include/llg.h"
+
+#include <cmath>
+
+LLG::LLG()
+{
+    this -> damping_ = 0.1;
+    this -> timestep_ = 0.01;
+    this -> steps_ = 0;
+    this -> num_sites_ = 0;
+}
+
+LLG::LLG(Lattice& lattice, Real damping, Real timestep, Index steps) : LLG()
+{
+    std::vector<Atom>& atoms = lattice.getAtoms();
+
+    this -> damping_ = damping;
+    this -> timestep_ = timestep;
+    this -> steps_ = steps;
+    this -> num_sites_ = atoms.size();
+
+    this -> spins_ = std::vector<Real>(3 * atoms.size());
+    this -> norms_ = std::vector<Real>(atoms.size());
+    this -> externalFields_ = std::vector<Real>(3 * atoms.size());
+    this -> offsets_ = std::vector<LongIndex>(atoms.size() + 1, 0);
+    this -> anisotropyOffsets_ = std::vector<Index>(atoms.size() + 1, 0);
+
+    for (Index i = 0; i < atoms.size(); ++i)
+    {
+        const Atom& atom = atoms.at(i);
+        this -> norms_.at(i) = atom.getSpinNorm();
+        for (Index c = 0; c < 3; ++c)
+            this -> externalFields_.at(3 * i + c) = atom.getExternalField()[c];
+
+        Index nbh_c = 0;
+        for (auto&& nbh : atom.getNbhs())
+        {
+            this -> nbhs_.push_back(Index(nbh - &atoms.front()));
+            this -> exchanges_.push_back(atom.getExchanges().at(nbh_c++));
+        }
+        this -> offsets_.at(i + 1) = this -> nbhs_.size();
+
+        for (auto&& term : atom.getAnisotropyTerms())
+            this -> anisotropies_.push_back(term);
+        this -> anisotropyOffsets_.at(i + 1) = this -> anisotropies_.size();
+    }
+
+    this -> predicted_ = std::vector<Real>(3 * atoms.size());
+    this -> torques_ = std::vector<Real>(3 * atoms.size());
+    this -> predictedTorques_ = std::vector<Real>(3 * atoms.size());
+}
+
+std::string LLG::checkLattice(Lattice& lattice)
+{
+    for (auto&& atom : lattice.getAtoms())
+        if (atom.getModel() == Model::FLIP || atom.getModel() == Model::QISING)
+            return "the site " + std::to_string(atom.getIndex()) + " uses the discrete model '" + modelName(atom.getModel()) + "'";
+    return "";
+}
+
+void LLG::load(Lattice& lattice)
+{
+    Index i = 0;
+    for (auto&& atom : lattice.getAtoms())
+    {
+        for (Index c = 0; c < 3; ++c)
+            this -> spins_.at(3 * i + c) = atom.getSpin()[c];
+        i++;
+    }
+}
+
+void LLG::store(Lattice& lattice) const
+{
+    Index i = 0;
+    for (auto&& atom : lattice.getAtoms())
+    {
+        atom.setSpin({this -> spins_.at(3 * i), this -> spins_.at(3 * i + 1), this -> spins_.at(3 * i + 2)});
+        i++;
+    }
+}
+
+void LLG::computeTorques(const std::vector<Real>& spins, Real H, std::vector<Real>& torques) const
+{
+    const Real factor = - 1.0 / (1.0 + this -> damping_ * this -> damping_);
+
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < long(this -> num_sites_); ++i)
+    {
+        const Real* S = &spins[3 * i];
+        Real B[3] = {H * this -> externalFields_[3 * i],
+                     H * this -> externalFields_[3 * i + 1],
+                     H * this -> externalFields_[3 * i + 2]};
+
+        for (LongIndex k = this -> offsets_[i]; k < this -> offsets_[i + 1]; ++k)
+        {
+            const Real* nbh = &spins[3 * LongIndex(this -> nbhs_[k])];
+            B[0] += this -> exchanges_[k] * nbh[0];
+            B[1] += this -> exchanges_[k] * nbh[1];
+            B[2] += this -> exchanges_[k] * nbh[2];
+        }
+
+        if (this -> anisotropyOffsets_[i] != this -> anisotropyOffsets_[i + 1])
+        {
+            Array spin = {S[0], S[1], S[2]};
+            for (Index k = this -> anisotropyOffsets_[i]; k < this -> anisotropyOffsets_[i + 1]; ++k)
+            {
+                Array field = this -> anisotropies_[k].field(spin);
+                B[0] += field[0];
+                B[1] += field[1];
+                B[2] += field[2];
+            }
+        }
+
+        // S x B and S x (S x B).
+        Real SxB[3] = {S[1] * B[2] - S[2] * B[1],
+                       S[2] * B[0] - S[0] * B[2],
+                       S[0] * B[1] - S[1] * B[0]};
+        Real SxSxB[3] = {S[1] * SxB[2] - S[2] * SxB[1],
+                         S[2] * SxB[0] - S[0] * SxB[2],
+                         S[0] * SxB[1] - S[1] * SxB[0]};
+
+        const Real damping = this -> damping_ / this -> norms_[i];
+        for (Index c = 0; c < 3; ++c)
+            torques[3 * i + c] = factor * (SxB[c] + damping * SxSxB[c]);
+    }
+}
+
+void LLG::run(Real H)
+{
+    const Real dt = this -> timestep_;
+    const long N = this -> num_sites_;
+
+    auto normalize = [this](std::vector<Real>& spins, long i){
+        Real* S = &spins[3 * i];
+        Real scale = this -> norms_[i] / std::sqrt(S[0] * S[0] + S[1] * S[1] + S[2] * S[2]);
+        S[0] *= scale;
+        S[1] *= scale;
+        S[2] *= scale;
+    };
+
+    for (Index step = 0; step < this -> steps_; ++step)
+    {
+        this -> computeTorques(this -> spins_, H, this -> torques_);
+
+        #pragma omp parallel for schedule(static)
+        for (long i = 0; i < N; ++i)
+        {
+            for (Index c = 0; c < 3; ++c)
+                this -> predicted_[3 * i + c] = this -> spins_[3 * i + c] + dt * this -> torques_[3 * i + c];
+            normalize(this -> predicted_, i);
+        }
+
+        this -> computeTorques(this -> predicted_, H, this -> predictedTorques_);
+
+        #pragma omp parallel for schedule(static)
+        for (long i = 0; i < N; ++i)
+        {
+            for (Index c = 0; c < 3; ++c)
+                this -> spins_[3 * i + c] += 0.5 * dt * (this -> torques_[3 * i + c] + this -> predictedTorques_[3 * i + c]);
+            normalize(this -> spins_, i);
+        }
+    }
+}
+
+Real LLG::getDamping() const
+{
+    return this -> damping_;
+}
+
+Real LLG::getTimestep() const
+{
+    return this -> timestep_;
+}
+
+Index LLG::getSteps() const
+{
+    return this -> steps_;
+}
@@ -19,6 +19,10 @@ void HELP()
     std::cout << "Usage:" << std::endl;
     std::cout << std::endl;
     std::cout << "\t./vegas FILE.JSON" << std::endl;
+    std::cout << "\t./vegas FILE.JSON --memory" << std::endl;
+    std::cout << std::endl;
+    std::cout << "The option '--memory' prints the estimated memory of the" << std::endl;
+    std::cout << "simulation without running it." << std::endl;
     std::cout << std::endl;
     std::cout << "For more information, please feel free to "
               << "consult https://github.com/jdalzatec/vegas" << std::endl;
@@ -33,7 +37,7 @@ int main(int argc, char const *argv[])
 
     // An Json file is necessary to run vegas.
     // This should be given like an argument.
-    if (argc != 2)
+    if (argc != 2 && argc != 3)
         EXIT("A JSON file is necessary !!!");
 
     // If '--help' or "-help" is given like argument,
@@ -42,6 +46,17 @@ int main(int argc, char const *argv[])
     if (help == "--help" or help == "-help")
         HELP();
 
+    // With '--memory' only the estimated memory is printed, so the
+    // jobs can be sized before they are submitted.
+    if (argc == 3)
+    {
+        std::string option = argv[2];
+        if (option != "--memory")
+            EXIT("The option " + option + " does not exist !!!");
+        ESTIMATE(argv[1]);
+        return 0;
+    }
+
     // The second argument is to know if the values should be printed.
     System system_ = CREATE_SYSTEM(argv[1], true);
 
@@ -0,0 +1,109 @@
+#include "../include/analyzer.h"
+#include "../include/rlutil.h"
+
+#include <charconv>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// Message to exit and launch an error.
+void EXIT(std::string message)
+{
+    rlutil::setColor(rlutil::LIGHTRED);
+    std::cout << message << std::endl;
+    std::cout << "Unsuccesful completion !!!" << std::endl;
+    rlutil::resetColor();
+    exit(EXIT_FAILURE);
+}
+
+void HELP()
+{
+    std::cout << "Usage:" << std::endl;
+    std::cout << std::endl;
+    std::cout << "\t./vegas-analyze FILE.h5" << std::endl;
+    std::cout << "\t./vegas-analyze FILE.h5 THREADS" << std::endl;
+    std::cout << "\t./vegas-analyze FILE.h5 [THREADS] --reweight POINTS" << std::endl;
+    std::cout << std::endl;
+    std::cout << "The averages of each point are written into FILE.mean," << std::endl;
+    std::cout << "with the same columns of the python analyzers." << std::endl;
+    std::cout << "With --reweight, the averages on POINTS temperatures of" << std::endl;
+    std::cout << "each field, by multiple histogram reweighting, are written" << std::endl;
+    std::cout << "into FILE.reweight." << std::endl;
+    std::cout << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char const *argv[])
+{
+    rlutil::saveDefaultColor();
+
+    if (argc < 2 || argc > 5)
+        EXIT("An output file of vegas is necessary !!!");
+
+    std::string fileName = argv[1];
+    if (fileName == "--help" or fileName == "-help")
+        HELP();
+
+    // The amounts must be whole numbers, without trailing characters.
+    auto parseAmount = [](const std::string& arg, const std::string& what)
+    {
+        int amount = 0;
+        const char* end = arg.data() + arg.size();
+        auto result = std::from_chars(arg.data(), end, amount);
+        if (arg.empty() || result.ec != std::errc() || result.ptr != end)
+            EXIT("The amount of " + what + " must be an integer, not " + arg + " !!!");
+        return amount;
+    };
+
+    // By default, one thread for each core.
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    int points = 0;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--reweight")
+        {
+            if (i + 1 == argc)
+                EXIT("The amount of temperatures to reweight is necessary !!!");
+            points = parseAmount(argv[++i], "temperatures to reweight");
+            if (points < 1)
+                EXIT("The amount of temperatures to reweight must be greater than 0 !!!");
+        }
+        else
+        {
+            threads = parseAmount(arg, "threads");
+        }
+    }
+    if (threads < 1)
+        EXIT("The amount of threads must be greater than 0 !!!");
+
+    Analyzer analyzer;
+    std::string reason = analyzer.load(fileName);
+    if (reason != "")
+        EXIT("The file " + fileName + " can't be analyzed because " + reason + " !!!");
+
+    if (points > 0 && analyzer.getBlockAverages())
+        EXIT("The averages of blocks of steps can't be reweighted !!!");
+
+    analyzer.compute(threads);
+
+    // The name of the output is the same of the python analyzers.
+    std::string out = fileName;
+    for (std::size_t pos = out.find(".h5"); pos != std::string::npos; pos = out.find(".h5", pos + 5))
+        out.replace(pos, 3, ".mean");
+    analyzer.write(out);
+
+    if (points > 0)
+    {
+        analyzer.reweight(points, threads);
+        std::string reweighted = fileName;
+        for (std::size_t pos = reweighted.find(".h5"); pos != std::string::npos; pos = reweighted.find(".h5", pos + 9))
+            reweighted.replace(pos, 3, ".reweight");
+        analyzer.writeReweighted(reweighted);
+    }
+
+    rlutil::setColor(rlutil::LIGHTGREEN);
+    std::cout << "Succesful completion !!!" << std::endl;
+    rlutil::resetColor();
+    return 0;
+}
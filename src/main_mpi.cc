@@ -0,0 +1,110 @@
+#include "../include/distributed.h"
+#include "../include/rlutil.h"
+#include "../include/starter.h"
+
+#include <iostream>
+#include <string>
+
+// Many functions for checking, errors and read the information were
+// defined in a namespace STARTER into the file starter.h
+using namespace STARTER;
+
+int main(int argc, char *argv[])
+{
+    MPI_Init(&argc, &argv);
+
+    int rank;
+    int size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    if (rank == 0)
+    {
+        rlutil::saveDefaultColor();
+        HEADER();
+    }
+
+    // An Json file is necessary to run vegas.
+    // This should be given like an argument.
+    if (argc != 2)
+        EXIT("A JSON file is necessary !!!");
+
+    Json::Value root;
+    Json::Reader reader;
+    std::ifstream file(argv[1], std::ifstream::binary);
+    if (!reader.parse(file, root, false))
+        EXIT("The parameters file can't be open or doesn't exist !!!");
+
+    // The distributed engine always starts from a random state and
+    // only supports the interactions given in the sample file.
+    if (root.isMember("initialstate") || root.isMember("anisotropy"))
+        EXIT("The initial state and the anisotropy files are not supported by vegas-mpi !!!");
+    if (root.isMember("dipolar"))
+        EXIT("The dipolar interaction is not supported by vegas-mpi !!!");
+    if (root.get("engine", "metropolis").asString() != "metropolis")
+        EXIT("Only the metropolis engine is supported by vegas-mpi !!!");
+    if (root.isMember("independent"))
+        EXIT("The independent points are not supported by vegas-mpi !!!");
+    if (root.isMember("adaptive"))
+        EXIT("The adaptive mode is not supported by vegas-mpi !!!");
+    if (root.isMember("output") || root.isMember("record") || root.isMember("snapshots"))
+        EXIT("The output layout, records and snapshots are not supported by vegas-mpi !!!");
+    if (root.isMember("structure") || root.isMember("correlation"))
+        EXIT("The structure factor and the correlation function are not supported by vegas-mpi !!!");
+    if (root["sample"].isObject())
+        EXIT("The samples given by a unit cell are not supported by vegas-mpi !!!");
+
+    std::string sample = root["sample"].asString();
+    Index mcs = root.get("mcs", 5000).asInt();
+    Real kb = root.get("kb", 1.0).asDouble();
+    std::string out = root.get("out", sample + ".h5").asString();
+
+    // All the ranks must share the seed of the rank 0.
+    Index seed = root.get("seed", Index(time(NULL))).asUInt();
+    MPI_Bcast(&seed, 1, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+
+    std::vector<Real> temps(0);
+    std::vector<Real> fields(0);
+    READ_POINTS(root, temps, fields);
+    CHECK(sample, mcs, temps, fields);
+
+    DistributedSystem system_(sample, temps, fields, mcs, seed, out, kb, MPI_COMM_WORLD);
+
+    Index local = system_.getNumLocalSites();
+    Index halo = system_.getNumHaloSites();
+    Index maxLocal = 0;
+    Index maxHalo = 0;
+    MPI_Reduce(&local, &maxLocal, 1, MPI_UNSIGNED, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&halo, &maxHalo, 1, MPI_UNSIGNED, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (rank == 0)
+    {
+        std::cout << "\t\tSample file = \n\t\t\t" << sample << std::endl;
+        std::cout << "\t\tNum MCS = \n\t\t\t" << mcs << std::endl;
+        std::cout << "\t\tOut file = \n\t\t\t" << out << std::endl;
+        std::cout << std::endl;
+        std::cout << "\t\tNum Ions = \n\t\t\t" << system_.getNumSites() << std::endl;
+        for (auto&& type : system_.getMapTypeIndexes())
+            std::cout << "\t\tNum " << type.first << " Ions  = \n\t\t\t" << system_.getSizesByIndex().at(type.second) << std::endl;
+        std::cout << "\t\tkb = \n\t\t\t" << kb << std::endl;
+        std::cout << "\t\tseed = \n\t\t\t" << seed << std::endl;
+        std::cout << "\t\tranks = \n\t\t\t" << size << std::endl;
+        std::cout << "\t\tmax sites by rank = \n\t\t\t" << maxLocal << std::endl;
+        std::cout << "\t\tmax halo by rank = \n\t\t\t" << maxHalo << std::endl;
+        std::cout << std::endl;
+        std::cout << std::endl;
+    }
+
+    system_.randomizeSpins();
+    system_.cycle();
+
+    if (rank == 0)
+    {
+        rlutil::setColor(rlutil::LIGHTGREEN);
+        std::cout << "Succesful completion !!!" << std::endl;
+        rlutil::resetColor();
+    }
+
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include "../include/reporter.h"
+#include "../include/rlutil.h"
+#include "../include/unitcell.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+
+void HELP()
+{
+    std::cout << "Usage:" << std::endl;
+    std::cout << std::endl;
+    std::cout << "\t./vegas-storage" << std::endl;
+    std::cout << "\t./vegas-storage MCS [POINTS]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Writes POINTS (20 by default) synthetic points of MCS (100000" << std::endl;
+    std::cout << "by default) steps with each layout of the output, and prints" << std::endl;
+    std::cout << "the write throughput and the size of the file of each one." << std::endl;
+    std::cout << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+// Correlated series like the ones of a simulation: an AR(1) process
+// around 'mean' with the correlation 'rho' between consecutive steps.
+void FILL_SERIES(std::vector<Real>& series, Real mean, Real rho, std::mt19937_64& engine)
+{
+    std::normal_distribution<Real> gauss(0.0, 0.01);
+    Real value = 0.0;
+    for (auto& step : series)
+    {
+        value = rho * value + gauss(engine);
+        step = mean + value;
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    rlutil::saveDefaultColor();
+
+    if (argc > 3)
+        HELP();
+    if (argc > 1 && (std::string(argv[1]) == "--help" || std::string(argv[1]) == "-help"))
+        HELP();
+
+    const Index mcs = (argc > 1) ? std::stoi(argv[1]) : 100000;
+    const Index points = (argc > 2) ? std::stoi(argv[2]) : 20;
+    if (mcs < AMOUNTCHUNKS || points < 1)
+        HELP();
+
+    // Small simple cubic sample with two types, so the file is dominated
+    // by the time series.
+    BasisSite a = {{0.0, 0.0, 0.0}, 1.0, {0.0, 0.0, 0.0}, "A", "adaptive"};
+    BasisSite b = {{0.5, 0.5, 0.5}, 1.0, {0.0, 0.0, 0.0}, "B", "adaptive"};
+    UnitCell cell({{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}}, {a, b}, {4, 4, 4},
+                  {true, true, true}, {}, 1e-6);
+    cell.computeStencil();
+    Lattice lattice(cell);
+    const Index num_types = lattice.getMapTypeIndexes().size();
+
+    std::vector<Real> temps(points, 1.0);
+    std::vector<Real> fields(points, 0.0);
+    std::mt19937_64 engine(0);
+    std::vector<Real> enes(mcs);
+    std::vector< std::vector<Real> > mags_x(num_types + 1, std::vector<Real>(mcs));
+    std::vector< std::vector<Real> > mags_y = mags_x;
+    std::vector< std::vector<Real> > mags_z = mags_x;
+    FILL_SERIES(enes, -2.0, 0.95, engine);
+    for (Index i = 0; i <= num_types; ++i)
+    {
+        FILL_SERIES(mags_x.at(i), 0.0, 0.9, engine);
+        FILL_SERIES(mags_y.at(i), 0.0, 0.9, engine);
+        FILL_SERIES(mags_z.at(i), 0.5, 0.9, engine);
+    }
+
+    std::vector< std::pair<std::string, StorageLayout> > layouts;
+    layouts.push_back({"none", {0, "none", 0, false}});
+    layouts.push_back({"deflate 1", {0, "deflate", 1, false}});
+    layouts.push_back({"deflate 6", {0, "deflate", 6, false}});
+    layouts.push_back({"shuffle 1", {0, "shuffle", 1, false}});
+    layouts.push_back({"deflate 1 chunk 4096", {4096, "deflate", 1, false}});
+    layouts.push_back({"none float", {0, "none", 0, true}});
+    layouts.push_back({"shuffle 1 float", {0, "shuffle", 1, true}});
+    layouts.push_back({"lz4", {0, "lz4", 0, false}});
+    layouts.push_back({"zstd 3", {0, "zstd", 3, false}});
+    layouts.push_back({"zstd 3 float", {0, "zstd", 3, true}});
+
+    const double series = double(points) * mcs * (1 + 3 * (num_types + 1));
+    std::cout << "Series of " << points << " points of " << mcs << " MCS ("
+              << series * sizeof(double) / (1024.0 * 1024.0) << " MiB in memory)" << std::endl;
+    std::cout << std::endl;
+    std::cout << std::left << std::setw(24) << "layout"
+              << std::right << std::setw(12) << "MiB/s" << std::setw(12) << "size MiB"
+              << std::setw(10) << "ratio" << std::endl;
+
+    const std::string fileName = "vegas-storage.h5";
+    for (auto&& layout : layouts)
+    {
+        std::cout << std::left << std::setw(24) << layout.first << std::right;
+        std::string reason = checkStorage(layout.second);
+        if (reason != "")
+        {
+            std::cout << "  skipped because " << reason << std::endl;
+            continue;
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+        Reporter reporter(fileName, std::vector<Array>(num_types + 1), lattice,
+                          temps, fields, mcs, 0, 1.0, layout.second);
+        for (Index index = 0; index < points; ++index)
+            reporter.partial_report(enes, mags_x, mags_y, mags_z, lattice, index);
+        reporter.close();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        struct stat status;
+        double size = (stat(fileName.c_str(), &status) == 0) ? double(status.st_size) : 0.0;
+        std::remove(fileName.c_str());
+
+        std::cout << std::fixed << std::setprecision(1)
+                  << std::setw(12) << series * sizeof(double) / (1024.0 * 1024.0) / seconds
+                  << std::setw(12) << size / (1024.0 * 1024.0)
+                  << std::setprecision(2) << std::setw(10) << series * sizeof(double) / size
+                  << std::defaultfloat << std::endl;
+    }
+
+    return 0;
+}
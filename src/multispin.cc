@@ -0,0 +1,295 @@
+#include "../include/multispin.h"
+
+#include <cmath>
+
+const Index MAXNBHS_MULTISPIN = 255;
+const Index BITS_THRESHOLD = 32;
+
+MultiSpin::MultiSpin()
+{
+    this -> replicas_ = 0;
+    this -> activeLanes_ = 0;
+    this -> num_types_ = 0;
+    this -> maxNbhs_ = 0;
+    this -> numUniforms_ = 0;
+}
+
+MultiSpin::MultiSpin(Lattice& lattice, Index replicas) : MultiSpin()
+{
+    std::vector<Atom>& atoms = lattice.getAtoms();
+
+    this -> replicas_ = replicas;
+    this -> activeLanes_ = (replicas >= 64) ? ~Word(0) : ((Word(1) << replicas) - 1);
+    this -> num_types_ = lattice.getMapTypeIndexes().size();
+    this -> sizesByIndex_ = lattice.getSizesByIndex();
+
+    this -> spinNorm_ = atoms.at(0).getSpinNorm();
+    this -> fieldZ_ = atoms.at(0).getExternalField()[2];
+    this -> exchange_ = 0.0;
+    this -> anisotropyEnergy_ = 0.0;
+
+    this -> spins_ = std::vector<Word>(atoms.size(), 0);
+    this -> typeIndexes_ = std::vector<Index>(atoms.size());
+    this -> offsets_ = std::vector<LongIndex>(atoms.size() + 1, 0);
+    this -> nbhs_.clear();
+    this -> signs_.clear();
+
+    for (Index i = 0; i < atoms.size(); ++i)
+    {
+        const Atom& atom = atoms.at(i);
+        this -> typeIndexes_.at(i) = atom.getTypeIndex();
+
+        Index nbh_c = 0;
+        for (auto&& nbh : atom.getNbhs())
+        {
+            Real exchange = atom.getExchanges().at(nbh_c++);
+            this -> exchange_ = std::fabs(exchange);
+            this -> nbhs_.push_back(Index(nbh - &atoms.front()));
+            this -> signs_.push_back((exchange < 0.0) ? ~Word(0) : Word(0));
+        }
+        this -> offsets_.at(i + 1) = this -> nbhs_.size();
+
+        if (atom.getNbhs().size() > this -> maxNbhs_)
+            this -> maxNbhs_ = atom.getNbhs().size();
+    }
+
+    this -> thresholds_ = std::vector<Word>((this -> maxNbhs_ + 1) * (this -> maxNbhs_ + 1) * 2, 0);
+    this -> uniforms_ = std::vector<Word>(BITS_THRESHOLD, 0);
+}
+
+std::string MultiSpin::checkLattice(Lattice& lattice)
+{
+    std::vector<Atom>& atoms = lattice.getAtoms();
+    if (atoms.size() == 0)
+        return "the sample is empty";
+
+    const Atom& first = atoms.front();
+    Real exchange = -1.0;
+    for (auto&& atom : atoms)
+    {
+        if (atom.getModel() != Model::FLIP)
+            return "the site " + std::to_string(atom.getIndex()) + " does not use the 'flip' model";
+
+        if (atom.getSpinNorm() != first.getSpinNorm())
+            return "the spin norms are not uniform";
+
+        // The engine only couples the z component of the field to the
+        // spins.
+        const Array& field = atom.getExternalField();
+        if (field[0] != 0.0 || field[1] != 0.0)
+            return "the site " + std::to_string(atom.getIndex()) + " has an external field with x or y components";
+
+        if (field[2] != first.getExternalField()[2])
+            return "the external field directions are not uniform";
+
+        if (atom.getNbhs().size() > MAXNBHS_MULTISPIN)
+            return "the site " + std::to_string(atom.getIndex()) + " has more than " + std::to_string(MAXNBHS_MULTISPIN) + " neighbors";
+
+        for (auto&& J : atom.getExchanges())
+        {
+            if (exchange < 0.0)
+                exchange = std::fabs(J);
+            if (std::fabs(std::fabs(J) - exchange) > 1e-12 * exchange)
+                return "the exchange couplings are not uniform in magnitude";
+        }
+    }
+
+    return "";
+}
+
+void MultiSpin::load(Lattice& lattice)
+{
+    this -> anisotropyEnergy_ = 0.0;
+    Index i = 0;
+    for (auto&& atom : lattice.getAtoms())
+    {
+        this -> spins_.at(i) = (atom.getSpin()[2] > 0.0) ? this -> activeLanes_ : Word(0);
+        // The anisotropy terms are invariant under a flip of the spin,
+        // so they only contribute with a constant to the energy.
+        this -> anisotropyEnergy_ += atom.getAnisotropyEnergy(atom);
+        i++;
+    }
+}
+
+void MultiSpin::store(Lattice& lattice) const
+{
+    Index i = 0;
+    for (auto&& atom : lattice.getAtoms())
+    {
+        Real sz = (this -> spins_.at(i) & Word(1)) ? this -> spinNorm_ : - this -> spinNorm_;
+        atom.setSpin({0.0, 0.0, sz});
+        i++;
+    }
+}
+
+void MultiSpin::prepare(Real T, Real H, Real kb)
+{
+    const Real scale = std::ldexp(1.0, BITS_THRESHOLD);
+    const Real S2 = this -> spinNorm_ * this -> spinNorm_;
+    for (Index z = 0; z <= this -> maxNbhs_; ++z)
+    {
+        for (Index u = 0; u <= z; ++u)
+        {
+            for (Index up = 0; up < 2; ++up)
+            {
+                Real deltaEnergy = 2.0 * this -> exchange_ * S2 * (Real(z) - 2.0 * Real(u));
+                deltaEnergy += 2.0 * H * this -> fieldZ_ * (up ? this -> spinNorm_ : - this -> spinNorm_);
+
+                Word threshold = Word(1) << BITS_THRESHOLD;
+                if (deltaEnergy > 0)
+                {
+                    Real probability = std::exp(- deltaEnergy / (kb * T));
+                    if (probability < 1.0)
+                        threshold = Word(probability * scale);
+                }
+                this -> thresholds_.at(((z * (this -> maxNbhs_ + 1)) + u) * 2 + up) = threshold;
+            }
+        }
+    }
+}
+
+// Returns the lanes (restricted to 'lanes') in which an uniform number of
+// 32 bits is lower than 'threshold'. The bits of the uniform numbers are
+// generated from the most significant one and only while some lane remains
+// undecided, so only a few random words are drawn for each trial.
+MultiSpin::Word MultiSpin::bernoulli(std::mt19937_64& engine, Word threshold, Word lanes)
+{
+    if (threshold >> BITS_THRESHOLD)
+        return lanes;
+
+    Word less = 0;
+    Word equal = lanes;
+    for (Index k = 0; k < BITS_THRESHOLD && equal; ++k)
+    {
+        if (k == this -> numUniforms_)
+            this -> uniforms_[this -> numUniforms_++] = engine();
+
+        Word bits = this -> uniforms_[k];
+        if ((threshold >> (BITS_THRESHOLD - 1 - k)) & 1)
+        {
+            less |= equal & ~bits;
+            equal &= bits;
+        }
+        else
+        {
+            equal &= ~bits;
+        }
+    }
+    return less;
+}
+
+void MultiSpin::monteCarloStep(std::mt19937_64& engine)
+{
+    Index numBits = 1;
+    while ((Index(1) << numBits) <= this -> maxNbhs_)
+        numBits++;
+
+    for (Index i = 0; i < this -> spins_.size(); ++i)
+    {
+        const Word spin = this -> spins_[i];
+
+        // Bit-sliced counter of the unsatisfied bonds of every lane.
+        Word counter[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        for (LongIndex k = this -> offsets_[i]; k < this -> offsets_[i + 1]; ++k)
+        {
+            Word carry = spin ^ this -> spins_[this -> nbhs_[k]] ^ this -> signs_[k];
+            for (Index b = 0; carry; ++b)
+            {
+                Word temp = counter[b] & carry;
+                counter[b] ^= carry;
+                carry = temp;
+            }
+        }
+
+        const Index z = this -> offsets_[i + 1] - this -> offsets_[i];
+        const Word* thresholds = &this -> thresholds_[z * (this -> maxNbhs_ + 1) * 2];
+        this -> numUniforms_ = 0;
+        Word accepted = 0;
+        for (Index u = 0; u <= z; ++u)
+        {
+            Word lanes = this -> activeLanes_;
+            for (Index b = 0; b < numBits; ++b)
+                lanes &= ((u >> b) & 1) ? counter[b] : ~counter[b];
+            if (lanes == 0)
+                continue;
+
+            Word up = lanes & spin;
+            Word down = lanes & ~spin;
+            if (up)
+                accepted |= this -> bernoulli(engine, thresholds[2 * u + 1], up);
+            if (down)
+                accepted |= this -> bernoulli(engine, thresholds[2 * u], down);
+        }
+
+        this -> spins_[i] = spin ^ accepted;
+    }
+}
+
+void MultiSpin::countLanes(std::vector<Word>& planes, Word word) const
+{
+    for (Index b = 0; word; ++b)
+    {
+        Word temp = planes[b] & word;
+        planes[b] ^= word;
+        word = temp;
+    }
+}
+
+void MultiSpin::extractCounts(const std::vector<Word>& planes, std::vector<Index>& counts) const
+{
+    for (Index r = 0; r < this -> replicas_; ++r)
+    {
+        Index count = 0;
+        for (Index b = 0; b < planes.size(); ++b)
+            count += Index((planes[b] >> r) & 1) << b;
+        counts.at(r) = count;
+    }
+}
+
+void MultiSpin::measure(Real H,
+                        std::vector<Real>& energies,
+                        std::vector< std::vector<Real> >& magnetizations)
+{
+    Index numBits = 1;
+    while ((std::uint64_t(1) << numBits) <= this -> nbhs_.size() + this -> spins_.size())
+        numBits++;
+
+    std::vector< std::vector<Word> > upPlanes(this -> num_types_, std::vector<Word>(numBits, 0));
+    std::vector<Word> unsatisfiedPlanes(numBits, 0);
+    for (Index i = 0; i < this -> spins_.size(); ++i)
+    {
+        const Word spin = this -> spins_[i];
+        this -> countLanes(upPlanes[this -> typeIndexes_[i]], spin);
+        for (LongIndex k = this -> offsets_[i]; k < this -> offsets_[i + 1]; ++k)
+            this -> countLanes(unsatisfiedPlanes, spin ^ this -> spins_[this -> nbhs_[k]] ^ this -> signs_[k]);
+    }
+
+    energies.assign(this -> replicas_, 0.0);
+    magnetizations.assign(this -> num_types_ + 1, std::vector<Real>(this -> replicas_, 0.0));
+
+    std::vector<Index> counts(this -> replicas_);
+    for (Index t = 0; t < this -> num_types_; ++t)
+    {
+        this -> extractCounts(upPlanes[t], counts);
+        for (Index r = 0; r < this -> replicas_; ++r)
+        {
+            Real mag = this -> spinNorm_ * (2.0 * Real(counts[r]) - Real(this -> sizesByIndex_.at(t)));
+            magnetizations[t][r] = mag;
+            magnetizations[this -> num_types_][r] += mag;
+        }
+    }
+
+    const Real S2 = this -> spinNorm_ * this -> spinNorm_;
+    this -> extractCounts(unsatisfiedPlanes, counts);
+    for (Index r = 0; r < this -> replicas_; ++r)
+    {
+        Real exchangeEnergy = 0.5 * this -> exchange_ * S2 * (2.0 * Real(counts[r]) - Real(this -> nbhs_.size()));
+        Real zeemanEnergy = - H * this -> fieldZ_ * magnetizations[this -> num_types_][r];
+        energies[r] = exchangeEnergy + zeemanEnergy + this -> anisotropyEnergy_;
+    }
+}
+
+Index MultiSpin::getReplicas() const
+{
+    return this -> replicas_;
+}
@@ -1,8 +1,40 @@
 #include "../include/reporter.h"
 
+#include <algorithm>
+
+// Registered identifiers of the LZ4 and Zstandard filters of HDF5.
+const H5Z_filter_t FILTER_LZ4 = 32004;
+const H5Z_filter_t FILTER_ZSTD = 32015;
+
+std::string checkStorage(const StorageLayout& layout)
+{
+    const std::string& compression = layout.compression;
+    if (compression != "none" && compression != "deflate" && compression != "shuffle" &&
+        compression != "lz4" && compression != "zstd")
+        return "the compression " + compression + " does not exist";
+    if ((compression == "deflate" || compression == "shuffle") && layout.level > 9)
+        return "the level of deflate must be between 0 and 9";
+    if (compression == "lz4" && H5Zfilter_avail(FILTER_LZ4) <= 0)
+        return "the LZ4 filter is not available in this HDF5";
+    if (compression == "zstd" && H5Zfilter_avail(FILTER_ZSTD) <= 0)
+        return "the Zstandard filter is not available in this HDF5";
+    return "";
+}
+
 Reporter::Reporter()
 {
+    this -> replicas_ = 0;
+    this -> adaptive_ = false;
+    this -> snapshots_ = false;
+    this -> structure_ = false;
+    this -> correlation_ = false;
+    this -> timing_ = false;
+}
 
+std::mutex& hdf5Lock()
+{
+    static std::mutex lock;
+    return lock;
 }
 
 Reporter::Reporter(std::string filename,
@@ -12,19 +44,23 @@ Reporter::Reporter(std::string filename,
              const std::vector<Real>& fields,
              Index mcs,
              Index seed,
-             Real kb)
+             Real kb,
+             const StorageLayout& layout)
 {
+    this -> replicas_ = 0;
+    this -> adaptive_ = false;
+    this -> snapshots_ = false;
+    this -> structure_ = false;
+    this -> correlation_ = false;
+    this -> timing_ = false;
+    this -> layout_ = layout;
     this -> file =  H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
 
     hid_t space, dcpl;
     hsize_t dims[2] = {temps.size(), mcs};
     space = H5Screate_simple(2, dims, NULL);
-    dcpl = H5Pcreate(H5P_DATASET_CREATE);
-
-    hsize_t CHUNK[2] = {1, Index(mcs / AMOUNTCHUNKS)};
-
-    this -> status = H5Pset_deflate(dcpl, 1);
-    this -> status = H5Pset_chunk(dcpl, 2, CHUNK);
+    dcpl = this -> seriesProperties(2, dims);
+    hid_t seriesType = this -> seriesType();
 
     Index num_types = lattice.getMapTypeIndexes().size();
     this -> mags_dset_x_ = std::vector<hid_t>(num_types + 1);
@@ -37,32 +73,32 @@ Reporter::Reporter(std::string filename,
     for (auto& type : lattice.getMapTypeIndexes())
     {
         this -> mags_dset_x_.at(type.second) = H5Dcreate(file, (type.first + "_x").c_str(),
-                    H5T_IEEE_F64LE, space, H5P_DEFAULT,
+                    seriesType, space, H5P_DEFAULT,
                     dcpl, H5P_DEFAULT);
 
         this -> mags_dset_y_.at(type.second) = H5Dcreate(file, (type.first + "_y").c_str(),
-                    H5T_IEEE_F64LE, space, H5P_DEFAULT,
+                    seriesType, space, H5P_DEFAULT,
                     dcpl, H5P_DEFAULT);
 
         this -> mags_dset_z_.at(type.second) = H5Dcreate(file, (type.first + "_z").c_str(),
-                    H5T_IEEE_F64LE, space, H5P_DEFAULT,
+                    seriesType, space, H5P_DEFAULT,
                     dcpl, H5P_DEFAULT);
     }
 
     this -> mags_dset_x_.at(num_types) = H5Dcreate(file, "magnetization_x",
-                H5T_IEEE_F64LE, space, H5P_DEFAULT,
+                seriesType, space, H5P_DEFAULT,
                 dcpl, H5P_DEFAULT);
 
     this -> mags_dset_y_.at(num_types) = H5Dcreate(file, "magnetization_y",
-                H5T_IEEE_F64LE, space, H5P_DEFAULT,
+                seriesType, space, H5P_DEFAULT,
                 dcpl, H5P_DEFAULT);
 
     this -> mags_dset_z_.at(num_types) = H5Dcreate(file, "magnetization_z",
-                H5T_IEEE_F64LE, space, H5P_DEFAULT,
+                seriesType, space, H5P_DEFAULT,
                 dcpl, H5P_DEFAULT);
 
     this -> energies_dset = H5Dcreate(file, "energy",
-                H5T_IEEE_F64LE, space, H5P_DEFAULT,
+                seriesType, space, H5P_DEFAULT,
                 dcpl, H5P_DEFAULT);
 
 
@@ -103,18 +139,45 @@ Reporter::Reporter(std::string filename,
                 H5P_DEFAULT, H5P_DEFAULT);
 
 
-    double positions[lattice.getAtoms().size()][3];
-    const char *types[lattice.getAtoms().size()];
-    int i = 0;
-    for(auto& atom : lattice.getAtoms())
+    hsize_t dims_statistics[1] = {temps.size()};
+    space = H5Screate_simple(1, dims_statistics, NULL);
+    for (auto&& name : {"tau_energy", "tau_magnetization",
+                        "ess_energy", "ess_magnetization",
+                        "error_energy", "error_magnetization"})
+        this -> statistics_dsets_.push_back(H5Dcreate(file, name,
+                    H5T_IEEE_F64LE, space, H5P_DEFAULT,
+                    H5P_DEFAULT, H5P_DEFAULT));
+
+    // State of the random generator and width of the moves of each type at
+    // the end of each point, so a run can be continued from any point.
+    this -> rng_dset = H5Dcreate(file, "rng_state",
+                filetype, space, H5P_DEFAULT,
+                H5P_DEFAULT, H5P_DEFAULT);
+    hsize_t dims_sigma[2] = {temps.size(), num_types};
+    space = H5Screate_simple(2, dims_sigma, NULL);
+    this -> sigma_dset = H5Dcreate(file, "sigma",
+                H5T_IEEE_F64LE, space, H5P_DEFAULT,
+                H5P_DEFAULT, H5P_DEFAULT);
+
+
+    // The positions and types are written by blocks of sites in the order
+    // of the sample file, so the buffers don't grow with the sample.
+    const Index num_sites = lattice.getAtoms().size();
+    std::vector<double> positions(3 * std::min(num_sites, BLOCKSITES));
+    std::vector<const char*> types(std::min(num_sites, BLOCKSITES));
+    for (Index begin = 0; begin < num_sites; begin += BLOCKSITES)
     {
-        std::copy(std::begin(atom.getPosition()), std::end(atom.getPosition()), positions[i]);
-        types[i] = atom.getType().c_str();
-        i++;
+        Index count = std::min(BLOCKSITES, num_sites - begin);
+        for (Index k = 0; k < count; ++k)
+        {
+            const Atom& atom = lattice.getAtoms().at(lattice.getSiteByIndex(begin + k));
+            std::copy(std::begin(atom.getPosition()), std::end(atom.getPosition()), &positions[3 * k]);
+            types[k] = lattice.getMapIndexTypes().at(atom.getTypeIndex()).c_str();
+        }
+        this -> writeSites(this -> types_dset, memtype, 0, begin, count, types.data());
+        this -> writeSites(this -> position_dset, H5T_NATIVE_DOUBLE, 0, begin, count, positions.data());
     }
 
-    this -> status = H5Dwrite(types_dset, memtype, H5S_ALL, H5S_ALL, H5P_DEFAULT, types);
-    this -> status = H5Dwrite(position_dset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, positions);
     this -> status = H5Dwrite(temps_dset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, temps.data());
     this -> status = H5Dwrite(fields_dset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, fields.data());
 
@@ -142,24 +205,6 @@ Reporter::Reporter(std::string filename,
     }
 
 
-    this -> dims_select_finalstates[0] = 3;
-    this -> memspace_id_finalstates = H5Screate_simple(1, this -> dims_select_finalstates, NULL);
-    this -> dataspace_id_finalstates = H5Dget_space(this -> finalstates_dset);
-
-    this -> start_finalstates[2] = 0;
-
-    this -> count_finalstates[0] = 1;
-    this -> count_finalstates[1] = 1;
-    this -> count_finalstates[2] = 3;
-
-    this -> stride_finalstates[0] = 1;
-    this -> stride_finalstates[1] = 1;
-    this -> stride_finalstates[2] = 1;
-
-    this -> block_finalstates[0] = 1;
-    this -> block_finalstates[1] = 1;
-    this -> block_finalstates[2] = 1;
-
     this -> status = H5Pclose(dcpl);
     this -> status = H5Sclose(space);
 
@@ -216,26 +261,498 @@ void Reporter::partial_report(
     }
 
 
-    this -> start_finalstates[0] = index;
-    i = 0;
-    for(auto& atom : lattice.getAtoms())
+    const Index num_sites = lattice.getAtoms().size();
+    std::vector<double> spins(3 * std::min(num_sites, BLOCKSITES));
+    for (Index begin = 0; begin < num_sites; begin += BLOCKSITES)
     {
-        this -> start_finalstates[1] = i;
-        std::vector<double> spin;
-        spin.assign(std::begin(atom.getSpin()), std::end(atom.getSpin()));
+        Index count = std::min(BLOCKSITES, num_sites - begin);
+        for (Index k = 0; k < count; ++k)
+        {
+            const Atom& atom = lattice.getAtoms().at(lattice.getSiteByIndex(begin + k));
+            std::copy(std::begin(atom.getSpin()), std::end(atom.getSpin()), &spins[3 * k]);
+        }
+        this -> writeSites(this -> finalstates_dset, H5T_NATIVE_DOUBLE, index, begin, count, spins.data());
+    }
+}
 
-        this -> status = H5Sselect_hyperslab(this -> dataspace_id_finalstates, H5S_SELECT_SET, this -> start_finalstates,
-                                             this -> stride_finalstates, this -> count_finalstates, this -> block_finalstates);
-        this -> status = H5Dwrite (this -> finalstates_dset, H5T_NATIVE_DOUBLE, this -> memspace_id_finalstates,
-                                   this -> dataspace_id_finalstates, H5P_DEFAULT, spin.data());
+void Reporter::statistics_report(
+    const SeriesStatistics& energy,
+    const SeriesStatistics& magnetization,
+    Index index)
+{
+    const double values[6] = {energy.tau, magnetization.tau,
+                              energy.ess, magnetization.ess,
+                              energy.error, magnetization.error};
+    for (Index k = 0; k < this -> statistics_dsets_.size(); ++k)
+        this -> writeSites(this -> statistics_dsets_.at(k), H5T_NATIVE_DOUBLE, 0, index, 1, &values[k]);
+}
 
-        i++;
+hid_t Reporter::seriesType() const
+{
+    return this -> layout_.single ? H5T_IEEE_F32LE : H5T_IEEE_F64LE;
+}
+
+// The chunks hold one point (and all its replicas) and 'chunk' steps, by
+// default a fifth of them.
+hid_t Reporter::seriesProperties(int rank, const hsize_t* dims) const
+{
+    hsize_t steps = dims[rank - 1];
+    hsize_t chunk = (this -> layout_.chunk > 0) ? this -> layout_.chunk : steps / AMOUNTCHUNKS;
+    hsize_t CHUNK[3] = {1, 1, 1};
+    for (int i = 1; i < rank - 1; ++i)
+        CHUNK[i] = dims[i];
+    CHUNK[rank - 1] = std::max<hsize_t>(1, std::min(chunk, steps));
+    return this -> compressedProperties(rank, CHUNK);
+}
+
+hid_t Reporter::compressedProperties(int rank, const hsize_t* chunk) const
+{
+    hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_chunk(dcpl, rank, chunk);
+
+    const std::string& compression = this -> layout_.compression;
+    if (compression == "shuffle")
+        H5Pset_shuffle(dcpl);
+    if (compression == "deflate" || compression == "shuffle")
+        H5Pset_deflate(dcpl, this -> layout_.level);
+    if (compression == "lz4")
+        H5Pset_filter(dcpl, FILTER_LZ4, H5Z_FLAG_MANDATORY, 0, NULL);
+    if (compression == "zstd")
+    {
+        const unsigned int level = this -> layout_.level;
+        H5Pset_filter(dcpl, FILTER_ZSTD, H5Z_FLAG_MANDATORY, 1, &level);
     }
+    return dcpl;
+}
 
+void Reporter::restart_report(const std::string& rngState, const std::vector<Real>& sigma, Index index)
+{
+    hid_t memtype = H5Tcopy(H5T_C_S1);
+    this -> status = H5Tset_size(memtype, H5T_VARIABLE);
+    const char* state = rngState.c_str();
+    this -> writeSites(this -> rng_dset, memtype, 0, index, 1, &state);
+    this -> status = H5Tclose(memtype);
+    this -> writeSites(this -> sigma_dset, H5T_NATIVE_DOUBLE, 0, index, 1, sigma.data());
+}
+
+// Writes the rows [begin, begin + count) of a dataset whose second to last
+// dimension runs over the sites. The datasets of rank 3 are indexed by
+// the point first.
+void Reporter::writeSites(hid_t dset, hid_t memtype, Index point, Index begin, Index count, const void* data)
+{
+    hid_t filespace = H5Dget_space(dset);
+    int rank = H5Sget_simple_extent_ndims(filespace);
+    hsize_t dims[3];
+    H5Sget_simple_extent_dims(filespace, dims, NULL);
+
+    hsize_t start[3] = {begin, 0, 0};
+    hsize_t block[3] = {count, (rank > 1) ? dims[1] : 1, 1};
+    if (rank == 3)
+    {
+        start[0] = point;
+        start[1] = begin;
+        block[0] = 1;
+        block[1] = count;
+        block[2] = dims[2];
+    }
+    this -> status = H5Sselect_hyperslab(filespace, H5S_SELECT_SET, start, NULL, block, NULL);
+
+    hsize_t dims_memory[1] = {block[0] * block[1] * block[2]};
+    hid_t memspace = H5Screate_simple(1, dims_memory, NULL);
+    this -> status = H5Dwrite(dset, memtype, memspace, filespace, H5P_DEFAULT, data);
+    this -> status = H5Sclose(memspace);
+    this -> status = H5Sclose(filespace);
+}
+
+void Reporter::createReplicaDatasets(Index numPoints, Index replicas, Index mcs)
+{
+    this -> replicas_ = replicas;
+    this -> replicas_mcs_ = mcs;
+
+    hsize_t dims[3] = {numPoints, replicas, mcs};
+    hid_t space = H5Screate_simple(3, dims, NULL);
+    hid_t dcpl = this -> seriesProperties(3, dims);
+
+    this -> replicas_energy_dset = H5Dcreate(file, "replicas_energy",
+                this -> seriesType(), space, H5P_DEFAULT,
+                dcpl, H5P_DEFAULT);
+    this -> replicas_mag_dset = H5Dcreate(file, "replicas_magnetization_z",
+                this -> seriesType(), space, H5P_DEFAULT,
+                dcpl, H5P_DEFAULT);
+
+    this -> status = H5Pclose(dcpl);
+    this -> status = H5Sclose(space);
+}
+
+void Reporter::replica_report(
+    const std::vector< std::vector<Real> >& enes,
+    const std::vector< std::vector<Real> >& mags,
+    Index index)
+{
+    hsize_t start[3] = {index, 0, 0};
+    hsize_t count[3] = {1, 1, this -> replicas_mcs_};
+    hsize_t dims_select[1] = {this -> replicas_mcs_};
+    hid_t memspace = H5Screate_simple(1, dims_select, NULL);
+    hid_t dataspace_energy = H5Dget_space(this -> replicas_energy_dset);
+    hid_t dataspace_mag = H5Dget_space(this -> replicas_mag_dset);
+
+    for (Index r = 0; r < this -> replicas_; ++r)
+    {
+        start[1] = r;
+        this -> status = H5Sselect_hyperslab(dataspace_energy, H5S_SELECT_SET, start, NULL, count, NULL);
+        this -> status = H5Dwrite(this -> replicas_energy_dset, H5T_NATIVE_DOUBLE, memspace,
+                                  dataspace_energy, H5P_DEFAULT, enes.at(r).data());
+
+        this -> status = H5Sselect_hyperslab(dataspace_mag, H5S_SELECT_SET, start, NULL, count, NULL);
+        this -> status = H5Dwrite(this -> replicas_mag_dset, H5T_NATIVE_DOUBLE, memspace,
+                                  dataspace_mag, H5P_DEFAULT, mags.at(r).data());
+    }
+
+    this -> status = H5Sclose(dataspace_mag);
+    this -> status = H5Sclose(dataspace_energy);
+    this -> status = H5Sclose(memspace);
+}
+
+void Reporter::createAdaptiveDatasets(Index numPoints)
+{
+    this -> adaptive_ = true;
+
+    hsize_t dims[1] = {numPoints};
+    hid_t space = H5Screate_simple(1, dims, NULL);
+    this -> used_dset = H5Dcreate(file, "mcs_used",
+                H5T_STD_U32LE, space, H5P_DEFAULT,
+                H5P_DEFAULT, H5P_DEFAULT);
+    this -> equilibration_dset = H5Dcreate(file, "equilibration",
+                H5T_STD_U32LE, space, H5P_DEFAULT,
+                H5P_DEFAULT, H5P_DEFAULT);
+    this -> status = H5Sclose(space);
+}
+
+void Reporter::adaptive_report(Index used, Index equilibration, Index index)
+{
+    this -> writeSites(this -> used_dset, H5T_NATIVE_UINT, 0, index, 1, &used);
+    this -> writeSites(this -> equilibration_dset, H5T_NATIVE_UINT, 0, index, 1, &equilibration);
+}
+
+void Reporter::createRecordDatasets(Index numPoints, Index mcs, Index steps, bool blocks, Lattice& lattice)
+{
+    const Index records = mcs / steps;
+
+    // The series hold one value by record, but the attribute 'mcs' keeps
+    // the amount of steps of the points.
+    hid_t attr = H5Aopen(file, "mcs", H5P_DEFAULT);
+    this -> status = H5Awrite(attr, H5T_NATIVE_INT, &mcs);
+    this -> status = H5Aclose(attr);
+
+    hid_t aid = H5Screate(H5S_SCALAR);
+    attr = H5Acreate(file, "steps_by_record", H5T_NATIVE_INT, aid, H5P_DEFAULT, H5P_DEFAULT);
+    this -> status = H5Awrite(attr, H5T_NATIVE_INT, &steps);
+    this -> status = H5Aclose(attr);
+    int averages = blocks;
+    attr = H5Acreate(file, "block_averages", H5T_NATIVE_INT, aid, H5P_DEFAULT, H5P_DEFAULT);
+    this -> status = H5Awrite(attr, H5T_NATIVE_INT, &averages);
+    this -> status = H5Aclose(attr);
+    this -> status = H5Sclose(aid);
+
+    if (!blocks)
+        return;
+
+    std::vector<std::string> names;
+    for (auto&& suffix : {"_norm", "_variance"})
+    {
+        for (auto& type : lattice.getMapIndexTypes())
+            names.push_back(type.second + suffix);
+        names.push_back(std::string("magnetization") + suffix);
+    }
+    names.push_back("energy_variance");
+
+    hsize_t dims[2] = {numPoints, records};
+    hid_t space = H5Screate_simple(2, dims, NULL);
+    hid_t dcpl = this -> seriesProperties(2, dims);
+    for (auto&& name : names)
+        this -> block_dsets_.push_back(H5Dcreate(file, name.c_str(),
+                    this -> seriesType(), space, H5P_DEFAULT,
+                    dcpl, H5P_DEFAULT));
+    this -> status = H5Pclose(dcpl);
+    this -> status = H5Sclose(space);
+}
+
+void Reporter::block_report(
+    const std::vector<Real>& eneVariances,
+    const std::vector< std::vector<Real> >& magNorms,
+    const std::vector< std::vector<Real> >& magVariances,
+    Index index)
+{
+    std::vector<const Real*> series;
+    for (auto&& values : magNorms)
+        series.push_back(values.data());
+    for (auto&& values : magVariances)
+        series.push_back(values.data());
+    series.push_back(eneVariances.data());
+
+    this -> start_[0] = index;
+    for (Index i = 0; i < this -> block_dsets_.size(); ++i)
+    {
+        hid_t filespace = H5Dget_space(this -> block_dsets_.at(i));
+        this -> status = H5Sselect_hyperslab(filespace, H5S_SELECT_SET, this -> start_,
+                                             this -> stride_, this -> count_, this -> block_);
+        this -> status = H5Dwrite(this -> block_dsets_.at(i), H5T_NATIVE_DOUBLE, this -> memspace_id_,
+                                  filespace, H5P_DEFAULT, series.at(i));
+        this -> status = H5Sclose(filespace);
+    }
+}
+
+// The snapshots are appended along the first axis, by chunks of one
+// snapshot of a block of sites.
+void Reporter::createSnapshotDatasets(Index numSites)
+{
+    this -> snapshots_ = true;
+    this -> numSnapshots_ = 0;
+
+    hsize_t dims[3] = {0, numSites, 3};
+    hsize_t maxdims[3] = {H5S_UNLIMITED, numSites, 3};
+    hsize_t CHUNK[3] = {1, std::max(1u, std::min(numSites, BLOCKSITES)), 3};
+    hid_t space = H5Screate_simple(3, dims, maxdims);
+    hid_t dcpl = this -> compressedProperties(3, CHUNK);
+    this -> snapshots_dset = H5Dcreate(file, "snapshots",
+                this -> seriesType(), space, H5P_DEFAULT,
+                dcpl, H5P_DEFAULT);
+    this -> status = H5Pclose(dcpl);
+    this -> status = H5Sclose(space);
+
+    // The point and the step of each snapshot.
+    hsize_t dims_tags[1] = {0};
+    hsize_t maxdims_tags[1] = {H5S_UNLIMITED};
+    hsize_t CHUNK_TAGS[1] = {1024};
+    space = H5Screate_simple(1, dims_tags, maxdims_tags);
+    dcpl = H5Pcreate(H5P_DATASET_CREATE);
+    this -> status = H5Pset_chunk(dcpl, 1, CHUNK_TAGS);
+    this -> snapshot_point_dset = H5Dcreate(file, "snapshot_point",
+                H5T_STD_U32LE, space, H5P_DEFAULT,
+                dcpl, H5P_DEFAULT);
+    this -> snapshot_mcs_dset = H5Dcreate(file, "snapshot_mcs",
+                H5T_STD_U32LE, space, H5P_DEFAULT,
+                dcpl, H5P_DEFAULT);
+    this -> status = H5Pclose(dcpl);
+    this -> status = H5Sclose(space);
+}
+
+void Reporter::snapshot_report(Index point, Index step, const double* spins)
+{
+    const hsize_t row = this -> numSnapshots_++;
+    const Index tags[2] = {point, step};
+    const hid_t tag_dsets[2] = {this -> snapshot_point_dset, this -> snapshot_mcs_dset};
+    for (Index k = 0; k < 2; ++k)
+    {
+        hsize_t size[1] = {row + 1};
+        this -> status = H5Dset_extent(tag_dsets[k], size);
+        this -> writeSites(tag_dsets[k], H5T_NATIVE_UINT, 0, row, 1, &tags[k]);
+    }
+
+    hsize_t dims[3];
+    hid_t filespace = H5Dget_space(this -> snapshots_dset);
+    H5Sget_simple_extent_dims(filespace, dims, NULL);
+    this -> status = H5Sclose(filespace);
+    dims[0] = row + 1;
+    this -> status = H5Dset_extent(this -> snapshots_dset, dims);
+
+    // The whole configuration is written at once.
+    filespace = H5Dget_space(this -> snapshots_dset);
+    hsize_t start[3] = {row, 0, 0};
+    hsize_t count[3] = {1, dims[1], 3};
+    this -> status = H5Sselect_hyperslab(filespace, H5S_SELECT_SET, start, NULL, count, NULL);
+    hsize_t dims_memory[1] = {dims[1] * 3};
+    hid_t memspace = H5Screate_simple(1, dims_memory, NULL);
+    this -> status = H5Dwrite(this -> snapshots_dset, H5T_NATIVE_DOUBLE, memspace, filespace, H5P_DEFAULT, spins);
+    this -> status = H5Sclose(memspace);
+    this -> status = H5Sclose(filespace);
+}
+
+void Reporter::createStructureDatasets(Index numPoints, const std::vector<Array>& vectors, Lattice& lattice)
+{
+    this -> structure_ = true;
+
+    const Index numVectors = vectors.size();
+    hsize_t dims_q[2] = {numVectors, 3};
+    hid_t space = H5Screate_simple(2, dims_q, NULL);
+    hid_t dset = H5Dcreate(file, "structure_q",
+                H5T_IEEE_F64LE, space, H5P_DEFAULT,
+                H5P_DEFAULT, H5P_DEFAULT);
+    std::vector<double> components(3 * numVectors);
+    for (Index k = 0; k < numVectors; ++k)
+        for (Index a = 0; a < 3; ++a)
+            components[3 * k + a] = vectors[k][a];
+    this -> status = H5Dwrite(dset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, components.data());
+    this -> status = H5Dclose(dset);
+    this -> status = H5Sclose(space);
+
+    // The pairs of types (a, b), a <= b, named 'a-b'.
+    std::vector<std::string> pairs;
+    for (auto&& a : lattice.getMapIndexTypes())
+        for (auto&& b : lattice.getMapIndexTypes())
+            if (a.first <= b.first)
+                pairs.push_back(a.second + "-" + b.second);
+    std::vector<const char*> names;
+    for (auto&& pair : pairs)
+        names.push_back(pair.c_str());
+    hid_t filetype = H5Tcopy(H5T_C_S1);
+    this -> status = H5Tset_size(filetype, H5T_VARIABLE);
+    hsize_t dims_pairs[1] = {pairs.size()};
+    space = H5Screate_simple(1, dims_pairs, NULL);
+    dset = H5Dcreate(file, "structure_pairs",
+                filetype, space, H5P_DEFAULT,
+                H5P_DEFAULT, H5P_DEFAULT);
+    this -> status = H5Dwrite(dset, filetype, H5S_ALL, H5S_ALL, H5P_DEFAULT, names.data());
+    this -> status = H5Dclose(dset);
+    this -> status = H5Sclose(space);
+    this -> status = H5Tclose(filetype);
+
+    hsize_t dims[3] = {numPoints, pairs.size(), numVectors};
+    hsize_t CHUNK[3] = {1, 1, std::max(1u, std::min(numVectors, BLOCKSITES))};
+    space = H5Screate_simple(3, dims, NULL);
+    hid_t dcpl = this -> compressedProperties(3, CHUNK);
+    this -> structure_dset = H5Dcreate(file, "structure_factor",
+                this -> seriesType(), space, H5P_DEFAULT,
+                dcpl, H5P_DEFAULT);
+    this -> status = H5Pclose(dcpl);
+    this -> status = H5Sclose(space);
+}
+
+void Reporter::structure_report(const std::vector<Real>& values, Index index)
+{
+    hid_t filespace = H5Dget_space(this -> structure_dset);
+    hsize_t dims[3];
+    H5Sget_simple_extent_dims(filespace, dims, NULL);
+    hsize_t start[3] = {index, 0, 0};
+    hsize_t count[3] = {1, dims[1], dims[2]};
+    this -> status = H5Sselect_hyperslab(filespace, H5S_SELECT_SET, start, NULL, count, NULL);
+    hsize_t dims_memory[1] = {dims[1] * dims[2]};
+    hid_t memspace = H5Screate_simple(1, dims_memory, NULL);
+    this -> status = H5Dwrite(this -> structure_dset, H5T_NATIVE_DOUBLE, memspace, filespace, H5P_DEFAULT, values.data());
+    this -> status = H5Sclose(memspace);
+    this -> status = H5Sclose(filespace);
+}
+
+void Reporter::createCorrelationDatasets(Index numPoints, const std::vector<Real>& distances, const std::vector<Real>& pairs)
+{
+    this -> correlation_ = true;
+
+    hsize_t dims_bins[1] = {distances.size()};
+    hid_t space = H5Screate_simple(1, dims_bins, NULL);
+    hid_t dset = H5Dcreate(file, "correlation_distance",
+                H5T_IEEE_F64LE, space, H5P_DEFAULT,
+                H5P_DEFAULT, H5P_DEFAULT);
+    this -> status = H5Dwrite(dset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, distances.data());
+    this -> status = H5Dclose(dset);
+    dset = H5Dcreate(file, "correlation_pairs",
+                H5T_IEEE_F64LE, space, H5P_DEFAULT,
+                H5P_DEFAULT, H5P_DEFAULT);
+    this -> status = H5Dwrite(dset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, pairs.data());
+    this -> status = H5Dclose(dset);
+    this -> status = H5Sclose(space);
+
+    hsize_t dims[2] = {numPoints, distances.size()};
+    space = H5Screate_simple(2, dims, NULL);
+    this -> correlation_dset = H5Dcreate(file, "correlation",
+                H5T_IEEE_F64LE, space, H5P_DEFAULT,
+                H5P_DEFAULT, H5P_DEFAULT);
+    this -> status = H5Sclose(space);
+
+    hsize_t dims_points[1] = {numPoints};
+    space = H5Screate_simple(1, dims_points, NULL);
+    this -> correlation_length_dset = H5Dcreate(file, "correlation_length",
+                H5T_IEEE_F64LE, space, H5P_DEFAULT,
+                H5P_DEFAULT, H5P_DEFAULT);
+    this -> status = H5Sclose(space);
+}
+
+void Reporter::correlation_report(const std::vector<Real>& values, Real length, Index index)
+{
+    this -> writeSites(this -> correlation_dset, H5T_NATIVE_DOUBLE, 0, index, 1, values.data());
+    this -> writeSites(this -> correlation_length_dset, H5T_NATIVE_DOUBLE, 0, index, 1, &length);
+}
+
+void Reporter::createTimingDatasets(Index numPoints, Index numTypes)
+{
+    this -> timing_ = true;
+    this -> timing_group = H5Gcreate(file, "timing", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+
+    std::vector<std::string> names(TIMING_NAMES, TIMING_NAMES + NUM_PHASES);
+    names.push_back("total");
+    names.push_back("trials_per_second");
+    hsize_t dims[1] = {numPoints};
+    hid_t space = H5Screate_simple(1, dims, NULL);
+    this -> timing_dsets_.clear();
+    for (auto&& name : names)
+        this -> timing_dsets_.push_back(H5Dcreate(this -> timing_group, name.c_str(),
+                H5T_IEEE_F64LE, space, H5P_DEFAULT,
+                H5P_DEFAULT, H5P_DEFAULT));
+    this -> status = H5Sclose(space);
+
+    hsize_t dims_types[2] = {numPoints, numTypes};
+    space = H5Screate_simple(2, dims_types, NULL);
+    this -> acceptance_dset = H5Dcreate(this -> timing_group, "acceptance",
+                H5T_IEEE_F64LE, space, H5P_DEFAULT,
+                H5P_DEFAULT, H5P_DEFAULT);
+    this -> status = H5Sclose(space);
+}
+
+void Reporter::timing_report(const Timing& timing, Index index)
+{
+    std::vector<Real> values;
+    for (Index p = 0; p < NUM_PHASES; ++p)
+        values.push_back(timing.getSeconds(TimingPhase(p)));
+    values.push_back(timing.getTotal());
+    values.push_back(timing.getTrialsPerSecond());
+    for (Index k = 0; k < values.size(); ++k)
+        this -> writeSites(this -> timing_dsets_.at(k), H5T_NATIVE_DOUBLE, 0, index, 1, &values[k]);
+
+    std::vector<Real> acceptances = timing.getAcceptances();
+    if (!acceptances.empty())
+        this -> writeSites(this -> acceptance_dset, H5T_NATIVE_DOUBLE, 0, index, 1, acceptances.data());
 }
 
 void Reporter::close()
 {
+    if (this -> timing_)
+    {
+        for (auto&& dset : this -> timing_dsets_)
+            this -> status = H5Dclose(dset);
+        this -> status = H5Dclose(this -> acceptance_dset);
+        this -> status = H5Gclose(this -> timing_group);
+    }
+
+    if (this -> correlation_)
+    {
+        this -> status = H5Dclose(this -> correlation_dset);
+        this -> status = H5Dclose(this -> correlation_length_dset);
+    }
+
+    if (this -> structure_)
+        this -> status = H5Dclose(this -> structure_dset);
+
+    if (this -> snapshots_)
+    {
+        this -> status = H5Dclose(this -> snapshots_dset);
+        this -> status = H5Dclose(this -> snapshot_point_dset);
+        this -> status = H5Dclose(this -> snapshot_mcs_dset);
+    }
+
+    for (auto&& dset : this -> block_dsets_)
+        this -> status = H5Dclose(dset);
+
+    if (this -> adaptive_)
+    {
+        this -> status = H5Dclose(this -> used_dset);
+        this -> status = H5Dclose(this -> equilibration_dset);
+    }
+
+    if (this -> replicas_ > 0)
+    {
+        this -> status = H5Dclose(this -> replicas_energy_dset);
+        this -> status = H5Dclose(this -> replicas_mag_dset);
+    }
+
     Index i = 0;
     for (auto& val : this -> mags_dset_x_)
     {
@@ -251,6 +768,10 @@ void Reporter::close()
     this -> status = H5Dclose(this -> position_dset);
     this -> status = H5Dclose(this -> types_dset);
     this -> status = H5Dclose(this -> finalstates_dset);
+    for (auto&& dset : this -> statistics_dsets_)
+        this -> status = H5Dclose(dset);
+    this -> status = H5Dclose(this -> rng_dset);
+    this -> status = H5Dclose(this -> sigma_dset);
     this -> status = H5Fclose(this -> file);
 }
 
@@ -0,0 +1,181 @@
+#include "../include/reweighting.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+// Runs work(begin, end, chunk) over 'threads' contiguous chunks of [0, n).
+template <typename Work>
+void parallelChunks(Index threads, Index n, Work work)
+{
+    threads = std::max(Index(1), std::min(threads, n));
+    std::vector<std::thread> pool;
+    for (Index chunk = 1; chunk < threads; ++chunk)
+        pool.push_back(std::thread(work, (n * chunk) / threads, (n * (chunk + 1)) / threads, chunk));
+    work(0, n / threads, 0);
+    for (auto&& thread : pool)
+        thread.join();
+}
+
+// Partial log-sum-exp, kept like a maximum and a sum scaled by it.
+struct LogSum
+{
+    Real max = - std::numeric_limits<Real>::infinity();
+    Real sum = 0.0;
+
+    void add(Real value)
+    {
+        if (value > this -> max)
+        {
+            this -> sum = this -> sum * std::exp(this -> max - value) + 1.0;
+            this -> max = value;
+        }
+        else
+        {
+            this -> sum += std::exp(value - this -> max);
+        }
+    }
+
+    void merge(const LogSum& other)
+    {
+        if (other.sum == 0.0)
+            return;
+        if (other.max > this -> max)
+        {
+            this -> sum = this -> sum * std::exp(this -> max - other.max) + other.sum;
+            this -> max = other.max;
+        }
+        else
+        {
+            this -> sum += other.sum * std::exp(other.max - this -> max);
+        }
+    }
+
+    Real value() const
+    {
+        return this -> max + std::log(this -> sum);
+    }
+};
+
+MultiHistogram::MultiHistogram(Index numObservables)
+{
+    this -> numObservables_ = numObservables;
+}
+
+void MultiHistogram::addSimulation(Real beta,
+                                   const std::vector<Real>& energies,
+                                   const std::vector<Real>& observables)
+{
+    this -> betas_.push_back(beta);
+    this -> logSizes_.push_back(std::log(Real(energies.size())));
+    this -> freeEnergies_.push_back(0.0);
+    this -> energies_.insert(this -> energies_.end(), energies.begin(), energies.end());
+    this -> observables_.insert(this -> observables_.end(), observables.begin(), observables.end());
+}
+
+void MultiHistogram::computeDenominators(Index threads)
+{
+    const Index num_samples = this -> energies_.size();
+    const Index num_simulations = this -> betas_.size();
+    this -> logDenominators_.resize(num_samples);
+
+    parallelChunks(threads, num_samples, [&](Index begin, Index end, Index){
+        std::vector<Real> terms(num_simulations);
+        for (Index t = begin; t < end; ++t)
+        {
+            Real max = - std::numeric_limits<Real>::infinity();
+            for (Index m = 0; m < num_simulations; ++m)
+            {
+                terms[m] = this -> logSizes_[m] + this -> freeEnergies_[m] - this -> betas_[m] * this -> energies_[t];
+                max = std::max(max, terms[m]);
+            }
+            Real sum = 0.0;
+            for (Index m = 0; m < num_simulations; ++m)
+                sum += std::exp(terms[m] - max);
+            this -> logDenominators_[t] = max + std::log(sum);
+        }
+    });
+}
+
+Real MultiHistogram::logPartition(Real beta, Index threads) const
+{
+    std::vector<LogSum> partial(std::max(Index(1), threads));
+    parallelChunks(threads, this -> energies_.size(), [&](Index begin, Index end, Index chunk){
+        for (Index t = begin; t < end; ++t)
+            partial[chunk].add(- beta * this -> energies_[t] - this -> logDenominators_[t]);
+    });
+    for (Index chunk = 1; chunk < partial.size(); ++chunk)
+        partial[0].merge(partial[chunk]);
+    return partial[0].value();
+}
+
+Index MultiHistogram::solve(Index threads, Real tolerance, Index maxIterations)
+{
+    const Index num_simulations = this -> betas_.size();
+    Index iteration = 0;
+    while (iteration < maxIterations)
+    {
+        ++iteration;
+        this -> computeDenominators(threads);
+
+        // The free energies are defined up to a constant, so the first one
+        // is kept at zero.
+        std::vector<Real> freeEnergies(num_simulations);
+        for (Index m = 0; m < num_simulations; ++m)
+            freeEnergies[m] = - this -> logPartition(this -> betas_[m], threads);
+        Real change = 0.0;
+        for (Index m = 0; m < num_simulations; ++m)
+        {
+            freeEnergies[m] -= freeEnergies[0];
+            change = std::max(change, std::abs(freeEnergies[m] - this -> freeEnergies_[m]));
+        }
+        this -> freeEnergies_ = freeEnergies;
+        if (change < tolerance)
+            break;
+    }
+
+    this -> computeDenominators(threads);
+    return iteration;
+}
+
+void MultiHistogram::moments(Real beta, Index threads,
+                             std::vector<Real>& means,
+                             std::vector<Real>& variances) const
+{
+    const Index K = this -> numObservables_;
+    const Real logZ = this -> logPartition(beta, threads);
+    const Index chunks = std::max(Index(1), threads);
+
+    // Two passes, the variances are computed around the means.
+    std::vector< std::vector<Real> > partial(chunks, std::vector<Real>(K, 0.0));
+    parallelChunks(threads, this -> energies_.size(), [&](Index begin, Index end, Index chunk){
+        for (Index t = begin; t < end; ++t)
+        {
+            Real weight = std::exp(- beta * this -> energies_[t] - this -> logDenominators_[t] - logZ);
+            for (Index k = 0; k < K; ++k)
+                partial[chunk][k] += weight * this -> observables_[t * K + k];
+        }
+    });
+    means = std::vector<Real>(K, 0.0);
+    for (auto&& values : partial)
+        for (Index k = 0; k < K; ++k)
+            means[k] += values[k];
+
+    partial = std::vector< std::vector<Real> >(chunks, std::vector<Real>(K, 0.0));
+    parallelChunks(threads, this -> energies_.size(), [&](Index begin, Index end, Index chunk){
+        for (Index t = begin; t < end; ++t)
+        {
+            Real weight = std::exp(- beta * this -> energies_[t] - this -> logDenominators_[t] - logZ);
+            for (Index k = 0; k < K; ++k)
+            {
+                Real delta = this -> observables_[t * K + k] - means[k];
+                partial[chunk][k] += weight * delta * delta;
+            }
+        }
+    });
+    variances = std::vector<Real>(K, 0.0);
+    for (auto&& values : partial)
+        for (Index k = 0; k < K; ++k)
+            variances[k] += values[k];
+}
@@ -0,0 +1,83 @@
+#include "../include/snapshots.h"
+
+SnapshotWriter::SnapshotWriter(Reporter& reporter, Index numSites, Index buffers)
+    : reporter_(reporter)
+{
+    this -> buffers_ = std::vector< std::vector<double> >(buffers, std::vector<double>(3 * std::size_t(numSites)));
+    for (Index i = 0; i < buffers; ++i)
+        this -> free_.push_back(i);
+    this -> finished_ = false;
+    this -> thread_ = std::thread(&SnapshotWriter::run, this);
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+    this -> finish();
+}
+
+void SnapshotWriter::push(Lattice& lattice, Index point, Index step)
+{
+    Index buffer = 0;
+    {
+        std::unique_lock<std::mutex> lock(this -> mutex_);
+        this -> released_.wait(lock, [this](){ return !this -> free_.empty(); });
+        buffer = this -> free_.back();
+        this -> free_.pop_back();
+    }
+
+    // The sites are stored in the order of the sample file, like the
+    // final states.
+    double* spins = this -> buffers_.at(buffer).data();
+    const Index num_sites = lattice.getAtoms().size();
+    for (Index k = 0; k < num_sites; ++k)
+    {
+        const Array& spin = lattice.getAtoms().at(lattice.getSiteByIndex(k)).getSpin();
+        spins[3 * k] = spin[0];
+        spins[3 * k + 1] = spin[1];
+        spins[3 * k + 2] = spin[2];
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this -> mutex_);
+        this -> queue_.push_back({buffer, point, step});
+    }
+    this -> queued_.notify_one();
+}
+
+void SnapshotWriter::finish()
+{
+    {
+        std::lock_guard<std::mutex> lock(this -> mutex_);
+        this -> finished_ = true;
+    }
+    this -> queued_.notify_one();
+    if (this -> thread_.joinable())
+        this -> thread_.join();
+}
+
+void SnapshotWriter::run()
+{
+    while (true)
+    {
+        Snapshot snapshot;
+        {
+            std::unique_lock<std::mutex> lock(this -> mutex_);
+            this -> queued_.wait(lock, [this](){ return this -> finished_ || !this -> queue_.empty(); });
+            if (this -> queue_.empty())
+                return;
+            snapshot = this -> queue_.front();
+            this -> queue_.pop_front();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(hdf5Lock());
+            this -> reporter_.snapshot_report(snapshot.point, snapshot.step, this -> buffers_.at(snapshot.buffer).data());
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(this -> mutex_);
+            this -> free_.push_back(snapshot.buffer);
+        }
+        this -> released_.notify_one();
+    }
+}
@@ -19,6 +19,13 @@ namespace STARTER {
         if (!infile.good())
             EXIT("The sample file can't open or doesn't exist !!!");
 
+        CHECKPOINTS(mcs, temps, fields);
+    }
+
+    void CHECKPOINTS(Index mcs,
+                     const std::vector<Real>& temps,
+                     const std::vector<Real>& fields)
+    {
         if (mcs < 10)
             EXIT("The number of MCS must be greater than 10 !!!");
 
@@ -105,6 +112,7 @@ namespace STARTER {
 
         std::cout << std::endl;
         std::cout << "\t\tNum Ions = \n\t\t\t" << system_.getLattice().getAtoms().size() << std::endl;
+        std::cout << "\t\tMemory by site = \n\t\t\t" << std::round(system_.getLattice().getMemoryBySite()) << " bytes" << std::endl;
 
         // The amount of ions are printed for type ion.
         for (auto&& type : system_.getLattice().getMapTypeIndexes())
@@ -114,44 +122,257 @@ namespace STARTER {
 
         std::cout << "\t\tkb = \n\t\t\t" << kb << std::endl;
         std::cout << "\t\tseed = \n\t\t\t" << system_.getSeed() << std::endl;
+        std::cout << "\t\tengine = \n\t\t\t" << system_.getEngine() << std::endl;
+        std::cout << "\t\tsweep = \n\t\t\t" << system_.getSweep() << std::endl;
+        if (system_.getDipolar().isEnabled())
+        {
+            std::cout << "\t\tdipolar strength = \n\t\t\t" << system_.getDipolar().getStrength() << std::endl;
+            std::cout << "\t\tdipolar refresh = \n\t\t\t" << system_.getDipolar().getRefresh() << std::endl;
+        }
+        if (system_.getEngine() == "llg")
+        {
+            std::cout << "\t\tllg damping = \n\t\t\t" << system_.getLLG().getDamping() << std::endl;
+            std::cout << "\t\tllg time step = \n\t\t\t" << system_.getLLG().getTimestep() << std::endl;
+            std::cout << "\t\tllg steps by sample = \n\t\t\t" << system_.getLLG().getSteps() << std::endl;
+        }
+        if (system_.getEngine() == "wanglandau")
+        {
+            std::cout << "\t\twang-landau bins = \n\t\t\t" << system_.getWangLandau().getBins() << std::endl;
+            std::cout << "\t\twang-landau flatness = \n\t\t\t" << system_.getWangLandau().getFlatness() << std::endl;
+            std::cout << "\t\twang-landau final ln f = \n\t\t\t" << system_.getWangLandau().getFinalLogF() << std::endl;
+        }
+        if (system_.getIndependent())
+            std::cout << "\t\tindependent points = \n\t\t\t" << "true" << std::endl;
+        if (system_.getAdaptiveError() > 0.0)
+        {
+            std::cout << "\t\tadaptive error = \n\t\t\t" << system_.getAdaptiveError() << std::endl;
+            std::cout << "\t\tminimum mcs = \n\t\t\t" << system_.getMinimumMcs() << std::endl;
+        }
+        if (system_.getRecordSteps() > 1)
+        {
+            std::string record = system_.getRecordBlocks() ? "block" : "every";
+            std::cout << "\t\trecord " << record << " = \n\t\t\t" << system_.getRecordSteps() << " mcs" << std::endl;
+        }
+        if (system_.getStructure().isEnabled())
+        {
+            std::cout << "\t\tstructure factor every = \n\t\t\t" << system_.getStructureSteps() << " mcs" << std::endl;
+            std::cout << "\t\tstructure factor vectors = \n\t\t\t" << system_.getStructure().getVectors().size() << std::endl;
+        }
+        if (system_.getTimingStderr())
+            std::cout << "\t\ttiming = \n\t\t\tstderr" << std::endl;
+        if (system_.getCorrelation().isEnabled())
+        {
+            std::cout << "\t\tcorrelation every = \n\t\t\t" << system_.getCorrelationSteps() << " mcs" << std::endl;
+            std::cout << "\t\tcorrelation cutoff = \n\t\t\t" << system_.getCorrelation().getCutoff() << std::endl;
+        }
+        if (system_.getSnapshotSteps() > 0)
+        {
+            std::cout << "\t\tsnapshots every = \n\t\t\t" << system_.getSnapshotSteps() << " mcs" << std::endl;
+            std::cout << "\t\tsnapshots in flight = \n\t\t\t" << system_.getSnapshotBuffers() << std::endl;
+        }
+        const StorageLayout& storage = system_.getStorage();
+        if (storage.chunk > 0)
+            std::cout << "\t\toutput chunk = \n\t\t\t" << storage.chunk << std::endl;
+        if (storage.compression != "deflate" || storage.level != 1)
+            std::cout << "\t\toutput compression = \n\t\t\t" << storage.compression << " " << storage.level << std::endl;
+        if (storage.single)
+            std::cout << "\t\toutput precision = \n\t\t\t" << "float" << std::endl;
 
         std::cout << std::endl;
         std::cout << std::endl;
 
     }
 
-    System CREATE_SYSTEM(std::string jsonfile, bool print)
+    std::string BYTES(double bytes)
+    {
+        const char* units[5] = {"B", "KiB", "MiB", "GiB", "TiB"};
+        Index unit = 0;
+        while (bytes >= 1024.0 && unit < 4)
+        {
+            bytes /= 1024.0;
+            unit++;
+        }
+        std::ostringstream out;
+        out << std::setprecision(2) << std::fixed << bytes << " " << units[unit];
+        return out.str();
+    }
+
+    void PRINT_MEMORY(Index num_ions,
+                      std::uint64_t num_interactions,
+                      Index num_types,
+                      Index mcs,
+                      Index num_anisotropies,
+                      Index num_snapshots,
+                      const std::string& engine)
+    {
+        // Every atom has four arrays of three components (position, spin,
+        // old spin and field).
+        double spins = double(num_ions) * (sizeof(Atom) + 4 * 3 * sizeof(Real));
+        double nbhs = double(num_interactions) * (sizeof(Atom*) + sizeof(Real));
+        // Each anisotropy term holds three axes and its constant.
+        double anisotropy = double(num_anisotropies) * num_ions * (sizeof(AnisotropyTerm) + 9 * sizeof(Real));
+        // Time series of one point and the block of sites being written.
+        double output = double(mcs) * (1 + 3 * (num_types + 1)) * sizeof(Real) + 3 * BLOCKSITES * sizeof(double);
+        // Buffers of the snapshots in flight.
+        output += double(num_snapshots) * num_ions * 3 * sizeof(double);
+        double engines = 0.0;
+        if (engine == "msc")
+            engines = double(num_ions) * (8 + sizeof(LongIndex) + sizeof(Index)) + double(num_interactions) * (sizeof(Index) + 8);
+        // The LLG engine keeps four fields of three components by site, and
+        // a copy of the neighbors and of the anisotropy terms.
+        if (engine == "llg")
+            engines = double(num_ions) * (14 * sizeof(Real) + sizeof(LongIndex) + sizeof(Index)) + double(num_interactions) * (sizeof(Index) + sizeof(Real)) + anisotropy;
+
+        std::cout << "\t\tEstimated memory = " << std::endl;
+        std::cout << "\t\t\tspins           " << BYTES(spins) << std::endl;
+        std::cout << "\t\t\tneighbor tables " << BYTES(nbhs) << std::endl;
+        std::cout << "\t\t\tanisotropy      " << BYTES(anisotropy) << std::endl;
+        std::cout << "\t\t\toutput buffers  " << BYTES(output) << std::endl;
+        if (engines > 0.0)
+            std::cout << "\t\t\tengine          " << BYTES(engines) << std::endl;
+        std::cout << "\t\t\ttotal           " << BYTES(spins + nbhs + anisotropy + output + engines) << std::endl;
+        std::cout << std::endl;
+    }
+
+    Index COUNT_ANISOTROPIES(const Json::Value& root)
+    {
+        if (root.isMember("anisotropy") == false)
+            return 0;
+        if (root.get("anisotropy", 0.0).type() == 6)
+            return root["anisotropy"].size();
+        return 1;
+    }
+
+    // Steps held by the series of a point: the records and the raw steps
+    // of the record being taken.
+    Index COUNT_STEPS(const Json::Value& root, Index mcs)
+    {
+        if (root.isMember("record") == false || !root["record"].isObject())
+            return mcs;
+        Index steps = std::max(1u, root["record"].get("every", root["record"].get("block", 1)).asUInt());
+        return (steps > 1) ? mcs / steps + steps : mcs;
+    }
+
+    // Snapshots which can be kept in memory while they are written.
+    Index COUNT_SNAPSHOTS(const Json::Value& root)
+    {
+        if (root.isMember("snapshots") == false || !root["snapshots"].isObject())
+            return 0;
+        return root["snapshots"].get("buffers", 4).asUInt();
+    }
+
+    UnitCell READ_UNITCELL(const Json::Value& json)
+    {
+        // The lattice vectors are the rows of 'vectors', by default the
+        // ones of a simple cubic lattice.
+        std::vector<Array> vectors = {{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}};
+        if (json.isMember("vectors"))
+        {
+            vectors.clear();
+            for (auto&& vector : json["vectors"])
+                vectors.push_back({vector[0].asDouble(), vector[1].asDouble(), vector[2].asDouble()});
+        }
+
+        // Repetitions of the unit cell along each lattice vector.
+        std::vector<Index> size;
+        for (auto&& L : json["size"])
+            size.push_back(L.asUInt());
+
+        // The boundaries can be given like a boolean for all the axes or
+        // like an array with one boolean by axis. By default they are periodic.
+        std::vector<bool> periodic(3, true);
+        if (json.get("periodic", true).isArray())
+        {
+            periodic.clear();
+            for (auto&& p : json["periodic"])
+                periodic.push_back(p.asBool());
+        }
+        else
+        {
+            periodic = std::vector<bool>(3, json.get("periodic", true).asBool());
+        }
+
+        std::vector<BasisSite> basis;
+        for (auto&& site : json["basis"])
+        {
+            const Json::Value& position = site["position"];
+            Array field = {0.0, 0.0, 0.0};
+            if (site.isMember("field"))
+                field = {site["field"][0].asDouble(), site["field"][1].asDouble(), site["field"][2].asDouble()};
+            basis.push_back({{position[0].asDouble(), position[1].asDouble(), position[2].asDouble()},
+                             site.get("spin", 1.0).asDouble(),
+                             field,
+                             site.get("type", "atom").asString(),
+                             site.get("model", "random").asString()});
+        }
+
+        // The exchange constants are given by shells of distance
+        // for each pair of types.
+        std::vector<ExchangeShell> shells;
+        for (auto&& exchange : json["exchanges"])
+        {
+            if (exchange["types"].size() != 2)
+                EXIT("Each exchange of the unit cell needs a pair of types !!!");
+            shells.push_back({{exchange["types"][0].asString(), exchange["types"][1].asString()},
+                              exchange.get("distance", 1.0).asDouble(),
+                              exchange.get("J", 1.0).asDouble()});
+        }
+
+        UnitCell cell(vectors, basis, size, periodic, shells, json.get("tolerance", 1e-3).asDouble());
+        std::string reason = cell.check();
+        if (reason != "")
+            EXIT("The unit cell is not valid because " + reason + " !!!");
+        cell.computeStencil();
+
+        return cell;
+    }
+
+    void READ_SIZES(const Json::Value& root,
+                    Index& num_ions,
+                    std::uint64_t& num_interactions,
+                    Index& num_types)
+    {
+        if (root["sample"].isObject())
+        {
+            UnitCell cell = READ_UNITCELL(root["sample"]);
+            num_ions = Index(cell.getNumSites());
+            num_interactions = cell.getNumInteractions();
+            num_types = cell.getTypes().size();
+        }
+        else
+        {
+            std::ifstream file(root["sample"].asString());
+            file >> num_ions >> num_interactions >> num_types;
+        }
+    }
+
+    void ESTIMATE(std::string jsonfile)
     {
-        // Read the json file which was passed like argument and
-        // check if the format is correct.
-        // If the file doesn't exist or the format is wrong,
-        // an error is launched.
         Json::Value root;
         Json::Reader reader;
         std::ifstream file(jsonfile, std::ifstream::binary);
         if (!reader.parse(file, root, false))
             EXIT("The parameters file can't be open or doesn't exist !!!");
 
-        // Put the name of the sample into the variable 'sample'
-        std::string sample = root["sample"].asString();
-
-        // Put the amount of Monte Carlo Steps (MCS) into the variable 'mcs'.
-        // By default the amount of MCS is 5000.
         Index mcs = root.get("mcs", 5000).asInt();
+        if (root["sample"].isObject() == false)
+        {
+            std::ifstream infile(root["sample"].asString());
+            if (!infile.good())
+                EXIT("The sample file can't open or doesn't exist !!!");
+        }
 
-        // Put the value of kb into the variable 'kb'.
-        // By default the value of kb is 1.0.
-        Real kb = root.get("kb", 1.0).asDouble();
-
-        // Put the output name into the variable 'out'.
-        // By default the value of out is the sample name
-        // plus the extension '.h5'.
-        std::string out = root.get("out", sample + ".h5").asString();
-
-        // Put the seed value into the variable 'seed'.
-        // By default the value of seed is the actual time.
-        Index seed = root.get("seed", Index(time(NULL))).asUInt();
+        Index num_ions;
+        std::uint64_t num_interactions;
+        Index num_types;
+        READ_SIZES(root, num_ions, num_interactions, num_types);
+        PRINT_MEMORY(num_ions, num_interactions, num_types, COUNT_STEPS(root, mcs), COUNT_ANISOTROPIES(root), COUNT_SNAPSHOTS(root), root.get("engine", "metropolis").asString());
+    }
 
+    void READ_POINTS(const Json::Value& root,
+                     std::vector<Real>& temps,
+                     std::vector<Real>& fields)
+    {
         // The temperature can be given like a constant or a vector.
         // An array of temperatures must be created in the case that
         // the temperature is given like a constant.
@@ -165,7 +386,6 @@ namespace STARTER {
         // the temperature.
         bool unique_T = true;
 
-        std::vector<Real> temps(0);
         if (root.get("temperature", 0.0).type() == 1)
         {
             T = root.get("temperature", 0.0).asInt();
@@ -235,7 +455,6 @@ namespace STARTER {
         // with the field.
         Real H;
         bool unique_H = true;
-        std::vector<Real> fields(0);
         if (root.get("field", 0.0).type() == 1)
         {
             H = root.get("field", 0.0).asInt();
@@ -325,13 +544,97 @@ namespace STARTER {
                 fields.push_back(H);
             }
         }
+    }
+
+    System CREATE_SYSTEM(std::string jsonfile, bool print)
+    {
+        // Read the json file which was passed like argument and
+        // check if the format is correct.
+        // If the file doesn't exist or the format is wrong,
+        // an error is launched.
+        Json::Value root;
+        Json::Reader reader;
+        std::ifstream file(jsonfile, std::ifstream::binary);
+        if (!reader.parse(file, root, false))
+            EXIT("The parameters file can't be open or doesn't exist !!!");
+
+        // Put the name of the sample into the variable 'sample'.
+        // The sample can also be given like a dictionary with the
+        // description of its unit cell, which is built in memory.
+        bool generated = root["sample"].isObject();
+        std::string sample = generated ? "unit cell" : root["sample"].asString();
+
+        // Put the amount of Monte Carlo Steps (MCS) into the variable 'mcs'.
+        // By default the amount of MCS is 5000.
+        Index mcs = root.get("mcs", 5000).asInt();
+
+        // Put the value of kb into the variable 'kb'.
+        // By default the value of kb is 1.0.
+        Real kb = root.get("kb", 1.0).asDouble();
+
+        // Put the output name into the variable 'out'.
+        // By default the value of out is the sample name
+        // plus the extension '.h5'.
+        std::string out = root.get("out", (generated ? "lattice" : sample) + ".h5").asString();
+
+        // Put the seed value into the variable 'seed'.
+        // By default the value of seed is the actual time.
+        Index seed = root.get("seed", Index(time(NULL))).asUInt();
+
+        // The temperatures and fields of each point of the simulation.
+        std::vector<Real> temps(0);
+        std::vector<Real> fields(0);
+        READ_POINTS(root, temps, fields);
 
         // In this point we check if the values of sample name, MCS, temps and
         // fields are fine.
-        CHECK(sample, mcs, temps, fields);
+        UnitCell cell;
+        if (generated)
+        {
+            CHECKPOINTS(mcs, temps, fields);
+            cell = READ_UNITCELL(root["sample"]);
+            if (cell.getNumInteractions() > std::numeric_limits<LongIndex>::max())
+                EXIT("The sample has more interactions than the supported by the indexes, build vegas with -DVEGAS_LARGE_SAMPLES=ON !!!");
+        }
+        else
+        {
+            CHECK(sample, mcs, temps, fields);
+        }
+
+        if (print)
+        {
+            Index num_ions;
+            std::uint64_t num_interactions;
+            Index num_types;
+            if (generated)
+            {
+                num_ions = Index(cell.getNumSites());
+                num_interactions = cell.getNumInteractions();
+                num_types = cell.getTypes().size();
+            }
+            else
+            {
+                READ_SIZES(root, num_ions, num_interactions, num_types);
+            }
+            PRINT_MEMORY(num_ions, num_interactions, num_types, COUNT_STEPS(root, mcs), COUNT_ANISOTROPIES(root), COUNT_SNAPSHOTS(root), root.get("engine", "metropolis").asString());
+        }
 
         // Create the system with the previous values.
-        System system_(sample, temps, fields, mcs, seed, out, kb);
+        System system_ = generated ? System(cell, temps, fields, mcs, seed, out, kb)
+                                   : System(sample, temps, fields, mcs, seed, out, kb);
+
+        // The sites can be renumbered to improve the memory locality of
+        // the neighbors. The outputs keep the order of the sample file.
+        std::string reorder = root.get("reorder", "none").asString();
+        if (reorder != "none" && reorder != "morton" && reorder != "hilbert" && reorder != "rcm")
+            EXIT("The reordering method " + reorder + " does not exist !!!");
+        system_.getLattice().reorder(reorder);
+
+        // Order in which the sites are visited in each sweep: 'random'
+        // (default), 'sequential' or 'strided' (with a given 'stride').
+        std::string sweep = root.get("sweep", "random").asString();
+        Index stride = root.get("stride", 2).asUInt();
+        system_.setSweep(sweep, stride);
 
         // In case that an initial state is given in the Json file,
         // we checked it. If this is not given, the initial
@@ -343,8 +646,19 @@ namespace STARTER {
         }
         else
         {
-            CHECKFILE(root.get("initialstate", "").asString());
-            system_.setState(root.get("initialstate", "").asString());
+            // The point 'row' of a previous output is given like
+            // 'file.h5:row'.
+            std::string initialfile = initialstate;
+            int row = -1;
+            std::size_t colon = initialstate.rfind(':');
+            if (colon != std::string::npos && colon + 1 < initialstate.size() &&
+                initialstate.find_first_not_of("0123456789", colon + 1) == std::string::npos)
+            {
+                initialfile = initialstate.substr(0, colon);
+                row = std::stoi(initialstate.substr(colon + 1));
+            }
+            CHECKFILE(initialfile);
+            system_.setState(initialfile, row);
         }
 
 
@@ -370,6 +684,168 @@ namespace STARTER {
         }
         system_.setAnisotropies(anisotropyfiles);
 
+        // The long-range dipolar interaction is given like its strength or
+        // like a dictionary with the strength, the spacing of the grid of
+        // the sites and the amount of accepted changes between the
+        // refreshes of the dipolar field (0 for an automatic value).
+        if (root.isMember("dipolar") == true)
+        {
+            const Json::Value dipolar = root["dipolar"];
+            Real strength = 0.0;
+            Array spacing = {0.0, 0.0, 0.0};
+            Index refresh = 0;
+            if (dipolar.isObject())
+            {
+                strength = dipolar.get("strength", 1.0).asDouble();
+                refresh = dipolar.get("refresh", 0).asUInt();
+                if (dipolar.isMember("spacing"))
+                    spacing = {dipolar["spacing"][0].asDouble(), dipolar["spacing"][1].asDouble(), dipolar["spacing"][2].asDouble()};
+            }
+            else
+            {
+                strength = dipolar.asDouble();
+            }
+            system_.setDipolar(strength, spacing, refresh);
+        }
+
+        // The independent points start from the same state and are
+        // simulated in parallel, one thread by point.
+        system_.setIndependent(root.get("independent", false).asBool());
+
+        // In the adaptive mode each point stops when the error of its mean
+        // energy per site is below 'error', with 'mcs' like the maximum of
+        // steps and 'minimum' (1000 by default) like the minimum.
+        if (root.isMember("adaptive") == true)
+        {
+            const Json::Value adaptive = root["adaptive"];
+            if (!adaptive.isObject() || !adaptive.isMember("error"))
+                EXIT("The adaptive section in Json needs the target 'error' !!!");
+            Index minimum = adaptive.get("minimum", std::min(mcs, Index(1000))).asUInt();
+            system_.setAdaptive(adaptive["error"].asDouble(), minimum);
+        }
+
+        // The time series can keep only one step 'every' few steps, or the
+        // averages of each 'block' of steps with their variances.
+        if (root.isMember("record") == true)
+        {
+            const Json::Value record = root["record"];
+            if (!record.isObject() || record.isMember("every") == record.isMember("block"))
+                EXIT("The record section in Json needs either 'every' or 'block' !!!");
+            bool blocks = record.isMember("block");
+            system_.setRecord(record.get(blocks ? "block" : "every", 1).asUInt(), blocks);
+        }
+
+        // The structure factor is measured 'every' few steps (10 by
+        // default) on the wave vectors 'q', or with FFTs on the grid of the
+        // sites with the given 'spacing' (automatic by default).
+        if (root.isMember("structure") == true)
+        {
+            const Json::Value structure = root["structure"];
+            if (!structure.isObject())
+                EXIT("The structure section in Json must be a dictionary !!!");
+            std::vector<Array> vectors;
+            for (auto&& q : structure["q"])
+                vectors.push_back({q[0].asDouble(), q[1].asDouble(), q[2].asDouble()});
+            if (structure.isMember("q") && vectors.empty())
+                EXIT("The list of wave vectors of the structure factor is empty !!!");
+            Array spacing = {0.0, 0.0, 0.0};
+            if (structure.isMember("spacing"))
+                spacing = {structure["spacing"][0].asDouble(), structure["spacing"][1].asDouble(), structure["spacing"][2].asDouble()};
+            system_.setStructure(vectors, spacing, structure.get("every", 10).asUInt());
+        }
+
+        // The times of each point can be also written to stderr.
+        if (root.isMember("timing") == true)
+        {
+            const Json::Value timing = root["timing"];
+            if (!timing.isObject())
+                EXIT("The timing section in Json must be a dictionary !!!");
+            system_.setTimingStderr(timing.get("stderr", false).asBool());
+        }
+
+        // The correlation function is measured 'every' few steps (10 by
+        // default) up to the distance 'cutoff' (3 by default), in bins of
+        // width 'width' (0.1 by default).
+        if (root.isMember("correlation") == true)
+        {
+            const Json::Value correlation = root["correlation"];
+            if (!correlation.isObject())
+                EXIT("The correlation section in Json must be a dictionary !!!");
+            system_.setCorrelation(correlation.get("cutoff", 3.0).asDouble(),
+                                   correlation.get("width", 0.1).asDouble(),
+                                   correlation.get("every", 10).asUInt());
+        }
+
+        // The configurations can be written 'every' few steps during the
+        // points, keeping at most 'buffers' (4 by default) of them in memory
+        // while they are written.
+        if (root.isMember("snapshots") == true)
+        {
+            const Json::Value snapshots = root["snapshots"];
+            if (!snapshots.isObject() || !snapshots.isMember("every"))
+                EXIT("The snapshots section in Json needs the steps 'every' !!!");
+            system_.setSnapshots(snapshots["every"].asUInt(), snapshots.get("buffers", 4).asUInt());
+        }
+
+        // The layout of the time series in the output: the steps by chunk
+        // ('chunk', a fifth of them by default), the 'compression' ('none',
+        // 'deflate', 'shuffle', 'lz4' or 'zstd') with its 'level', and the
+        // 'precision' of the stored values ('double' or 'float').
+        if (root.isMember("output") == true)
+        {
+            const Json::Value output = root["output"];
+            if (!output.isObject())
+                EXIT("The output section in Json must be a dictionary !!!");
+            StorageLayout layout;
+            layout.chunk = output.get("chunk", 0).asUInt();
+            layout.compression = output.get("compression", "deflate").asString();
+            layout.level = output.get("level", (layout.compression == "zstd") ? 3 : 1).asUInt();
+            std::string precision = output.get("precision", "double").asString();
+            if (precision != "double" && precision != "float")
+                EXIT("The precision of the output must be double or float !!!");
+            layout.single = (precision == "float");
+            system_.setStorage(layout);
+        }
+
+        // The engine used to sample the configurations. By default the
+        // Metropolis algorithm over the atoms is used. The multi-spin
+        // coding engine ('msc') simulates up to 64 replicas of a pure
+        // Ising sample at once.
+        std::string engine = root.get("engine", "metropolis").asString();
+        Index replicas = root.get("replicas", 64).asUInt();
+        system_.setEngine(engine, replicas);
+
+        // The LLG engine integrates the spin dynamics with a 'timestep' and
+        // a 'damping', and samples the series every 'steps' time steps.
+        if (engine == "llg" && root.isMember("llg"))
+        {
+            const Json::Value llg = root["llg"];
+            system_.setLLG(llg.get("damping", 0.1).asDouble(),
+                           llg.get("timestep", 0.01).asDouble(),
+                           llg.get("steps", 10).asUInt());
+        }
+
+        // The Wang-Landau engine estimates ln g(E) over 'bins' bins of the
+        // range 'energy' (estimated from the temperatures by default), and
+        // refines ln f until it's below 'final'.
+        if (engine == "wanglandau" && root.isMember("wanglandau"))
+        {
+            const Json::Value wanglandau = root["wanglandau"];
+            Real minimum = 0.0;
+            Real maximum = 0.0;
+            if (wanglandau.isMember("energy"))
+            {
+                minimum = wanglandau["energy"][0].asDouble();
+                maximum = wanglandau["energy"][1].asDouble();
+                if (minimum >= maximum)
+                    EXIT("The range of energies of the Wang-Landau engine is not valid !!!");
+            }
+            system_.setWangLandau(wanglandau.get("bins", 200).asUInt(),
+                                  wanglandau.get("flatness", 0.8).asDouble(),
+                                  wanglandau.get("final", 1e-6).asDouble(),
+                                  minimum, maximum);
+        }
+
         if (print)
             PRINT_VALUES(system_, sample, mcs, out, kb, mcs, initialstate, anisotropyfiles);
 
@@ -0,0 +1,111 @@
+#include "../include/statistics.h"
+#include "../include/fft.h"
+
+#include <cmath>
+
+const Real WINDOW_FACTOR = 5.0;
+
+SeriesStatistics analyzeSeries(const std::vector<Real>& series, Index begin)
+{
+    SeriesStatistics statistics = {0.0, 0.0, 0.5, 0.0, 0.0};
+    if (begin >= series.size())
+        return statistics;
+
+    const Index n = series.size() - begin;
+    for (Index t = begin; t < series.size(); ++t)
+        statistics.mean += series[t];
+    statistics.mean /= n;
+
+    // The series is padded with zeros up to twice its size, so the circular
+    // correlation of the FFT is the linear one.
+    std::vector<Complex> data(nextPowerOfTwo(2 * n), 0.0);
+    for (Index t = 0; t < n; ++t)
+        data[t] = series[begin + t] - statistics.mean;
+    fft(data, false);
+    for (auto&& value : data)
+        value = std::norm(value);
+    fft(data, true);
+
+    const Real C0 = data[0].real();
+    statistics.variance = C0 / data.size() / n;
+    statistics.ess = n;
+    if (C0 <= 0.0)
+        return statistics;
+
+    Real tau = 0.5;
+    for (Index W = 1; W < n; ++W)
+    {
+        tau += data[W].real() / C0;
+        if (W >= WINDOW_FACTOR * tau)
+            break;
+    }
+
+    statistics.tau = tau;
+    statistics.ess = n / (2.0 * tau);
+    statistics.error = std::sqrt(statistics.variance / statistics.ess);
+    return statistics;
+}
+
+Index equilibrationMSER(const std::vector<Real>& series, Index batch)
+{
+    const Index batches = series.size() / batch;
+    if (batches < 4)
+        return series.size();
+
+    std::vector<Real> means(batches, 0.0);
+    for (Index b = 0; b < batches; ++b)
+    {
+        for (Index t = b * batch; t < (b + 1) * batch; ++t)
+            means[b] += series[t];
+        means[b] /= batch;
+    }
+
+    // Suffix sums of the batch means and of their squares.
+    Real sum = 0.0;
+    Real squares = 0.0;
+    Index best = batches;
+    Real bestValue = 0.0;
+    for (Index d = batches; d-- > 0;)
+    {
+        sum += means[d];
+        squares += means[d] * means[d];
+        if (d > batches / 2)
+            continue;
+
+        const Real k = batches - d;
+        const Real value = (squares - sum * sum / k) / (k * k);
+        if (best == batches || value <= bestValue)
+        {
+            best = d;
+            bestValue = value;
+        }
+    }
+
+    if (best == batches / 2)
+        return series.size();
+    return best * batch;
+}
+
+void recordTail(std::vector<Real>& series, Index steps, bool blocks, std::vector<Real>* variances)
+{
+    const Index begin = series.size() - steps;
+    Real record = series.back();
+    if (blocks)
+    {
+        Real mean = 0.0;
+        for (Index t = begin; t < series.size(); ++t)
+            mean += series.at(t);
+        mean /= steps;
+
+        if (variances != nullptr)
+        {
+            Real variance = 0.0;
+            for (Index t = begin; t < series.size(); ++t)
+                variance += (series.at(t) - mean) * (series.at(t) - mean);
+            variances -> push_back(variance / steps);
+        }
+        record = mean;
+    }
+    series.resize(begin);
+    series.push_back(record);
+}
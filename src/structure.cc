@@ -0,0 +1,194 @@
+#include "../include/structure.h"
+
+#include <cmath>
+#include <limits>
+
+StructureFactor::StructureFactor()
+{
+    this -> enabled_ = false;
+    this -> grid_ = false;
+    this -> numTypes_ = 0;
+    this -> numSites_ = 0;
+    this -> measurements_ = 0;
+}
+
+std::string StructureFactor::setVectors(Lattice& lattice, const std::vector<Array>& vectors)
+{
+    if (vectors.empty())
+        return "there are no wave vectors";
+    for (auto&& q : vectors)
+        if (q.size() != 3)
+            return "the wave vectors must have three components";
+
+    std::vector<Atom>& atoms = lattice.getAtoms();
+    this -> numSites_ = atoms.size();
+    this -> numTypes_ = lattice.getMapTypeIndexes().size();
+    this -> vectors_ = vectors;
+    this -> positions_ = std::vector<Real>(3 * this -> numSites_);
+    this -> types_ = std::vector<Index>(this -> numSites_);
+    for (Index i = 0; i < this -> numSites_; ++i)
+    {
+        for (Index a = 0; a < 3; ++a)
+            this -> positions_.at(3 * i + a) = atoms.at(i).getPosition()[a];
+        this -> types_.at(i) = atoms.at(i).getTypeIndex();
+    }
+
+    this -> grid_ = false;
+    this -> enabled_ = true;
+    this -> reset();
+    return "";
+}
+
+std::string StructureFactor::mapLattice(Lattice& lattice, Array spacing)
+{
+    Index sizes[3];
+    std::vector<Index> cells;
+    std::string reason = lattice.mapToGrid(spacing, sizes, cells);
+    if (reason != "")
+        return reason;
+
+    for (Index a = 0; a < 3; ++a)
+        this -> dims_[a] = nextPowerOfTwo(sizes[a]);
+    const long long numCells = (long long)(this -> dims_[0]) * this -> dims_[1] * this -> dims_[2];
+    if (numCells > 4294967295LL)
+        return "the grid of the structure factor is too large";
+
+    std::vector<Atom>& atoms = lattice.getAtoms();
+    this -> numSites_ = atoms.size();
+    this -> numTypes_ = lattice.getMapTypeIndexes().size();
+    this -> gridIndexes_ = std::vector<Index>(this -> numSites_);
+    this -> types_ = std::vector<Index>(this -> numSites_);
+    for (Index i = 0; i < this -> numSites_; ++i)
+    {
+        this -> gridIndexes_.at(i) = (cells.at(3 * i) * this -> dims_[1] + cells.at(3 * i + 1)) * this -> dims_[2] + cells.at(3 * i + 2);
+        this -> types_.at(i) = atoms.at(i).getTypeIndex();
+    }
+
+    // The wave vectors of the grid, with the last axis running fastest.
+    const Real PI = std::acos(-1.0);
+    this -> vectors_.clear();
+    for (Index x = 0; x < this -> dims_[0]; ++x)
+    for (Index y = 0; y < this -> dims_[1]; ++y)
+    for (Index z = 0; z < this -> dims_[2]; ++z)
+    {
+        const Index m[3] = {x, y, z};
+        Array q(3);
+        for (Index a = 0; a < 3; ++a)
+            q[a] = 2.0 * PI * m[a] / (this -> dims_[a] * spacing[a]);
+        this -> vectors_.push_back(q);
+    }
+
+    this -> transforms_ = std::vector< std::vector<Complex> >(3 * this -> numTypes_, std::vector<Complex>(numCells));
+    this -> grid_ = true;
+    this -> enabled_ = true;
+    this -> reset();
+    return "";
+}
+
+bool StructureFactor::isEnabled() const
+{
+    return this -> enabled_;
+}
+
+const std::vector<Array>& StructureFactor::getVectors() const
+{
+    return this -> vectors_;
+}
+
+Index StructureFactor::getNumPairs() const
+{
+    return this -> numTypes_ * (this -> numTypes_ + 1) / 2;
+}
+
+Index StructureFactor::getMeasurements() const
+{
+    return this -> measurements_;
+}
+
+// The pairs (a, b) with a <= b are numbered row by row.
+Index StructureFactor::pairIndex(Index a, Index b) const
+{
+    return a * this -> numTypes_ - a * (a + 1) / 2 + b;
+}
+
+void StructureFactor::reset()
+{
+    this -> measurements_ = 0;
+    this -> sums_ = std::vector<Real>(this -> getNumPairs() * this -> vectors_.size(), 0.0);
+}
+
+void StructureFactor::measure(Lattice& lattice)
+{
+    const std::vector<Atom>& atoms = lattice.getAtoms();
+    const Index T = this -> numTypes_;
+    const long nq = this -> vectors_.size();
+
+    if (this -> grid_)
+    {
+        for (auto& grid : this -> transforms_)
+            std::fill(grid.begin(), grid.end(), Complex(0.0, 0.0));
+        for (Index i = 0; i < this -> numSites_; ++i)
+            for (Index c = 0; c < 3; ++c)
+                this -> transforms_[3 * this -> types_[i] + c][this -> gridIndexes_[i]] = atoms[i].getSpin()[c];
+
+        #pragma omp parallel for schedule(static, 1)
+        for (long k = 0; k < long(this -> transforms_.size()); ++k)
+            fft3d(this -> transforms_.at(k), this -> dims_, false);
+
+        #pragma omp parallel for schedule(static)
+        for (long q = 0; q < nq; ++q)
+            for (Index a = 0; a < T; ++a)
+                for (Index b = a; b < T; ++b)
+                {
+                    Real value = 0.0;
+                    for (Index c = 0; c < 3; ++c)
+                        value += (this -> transforms_.at(3 * a + c).at(q) * std::conj(this -> transforms_.at(3 * b + c).at(q))).real();
+                    this -> sums_.at(this -> pairIndex(a, b) * nq + q) += value;
+                }
+    }
+    else
+    {
+        // Each thread sums the transforms of some wave vectors over all
+        // the sites.
+        #pragma omp parallel
+        {
+            std::vector<Complex> F(3 * T);
+            #pragma omp for schedule(static)
+            for (long q = 0; q < nq; ++q)
+            {
+                const Array& vector = this -> vectors_.at(q);
+                std::fill(F.begin(), F.end(), Complex(0.0, 0.0));
+                for (Index i = 0; i < this -> numSites_; ++i)
+                {
+                    const Real* r = &this -> positions_[3 * i];
+                    const Real phase = vector[0] * r[0] + vector[1] * r[1] + vector[2] * r[2];
+                    const Complex factor(std::cos(phase), std::sin(phase));
+                    const Array& spin = atoms[i].getSpin();
+                    Complex* f = &F[3 * this -> types_[i]];
+                    f[0] += spin[0] * factor;
+                    f[1] += spin[1] * factor;
+                    f[2] += spin[2] * factor;
+                }
+                for (Index a = 0; a < T; ++a)
+                    for (Index b = a; b < T; ++b)
+                    {
+                        Real value = 0.0;
+                        for (Index c = 0; c < 3; ++c)
+                            value += (F[3 * a + c] * std::conj(F[3 * b + c])).real();
+                        this -> sums_.at(this -> pairIndex(a, b) * nq + q) += value;
+                    }
+            }
+        }
+    }
+    this -> measurements_++;
+}
+
+std::vector<Real> StructureFactor::getMean() const
+{
+    std::vector<Real> mean(this -> sums_.size(), std::numeric_limits<Real>::quiet_NaN());
+    if (this -> measurements_ == 0)
+        return mean;
+    for (Index k = 0; k < mean.size(); ++k)
+        mean.at(k) = this -> sums_.at(k) / (Real(this -> measurements_) * this -> numSites_);
+    return mean;
+}
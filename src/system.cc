@@ -1,4 +1,5 @@
 #include "../include/system.h"
+#include "../include/textfile.h"
 #include <iostream>
 #include <iomanip>
 #include <cstdio>
@@ -6,6 +7,10 @@
 #include <sstream>
 #include "../include/rlutil.h"
 #include <functional>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <cstring>
 
 // Message to exit and launch an error.
 void EXIT(std::string message)
@@ -17,17 +22,6 @@ void EXIT(std::string message)
     exit(EXIT_FAILURE);
 }
 
-std::vector<std::string> split(const std::string& s, char delim)
-{
-    std::stringstream ss(s);
-    std::string item;
-    std::vector<std::string> tokens;
-    while (std::getline(ss, item, delim)) {
-        tokens.push_back(item);
-    }
-    return tokens;
-}
-
 const std::string ETA_seconds(const Index& seconds)
 {
     return "ETR: " + std::to_string(int(seconds / 3600)) + ":"
@@ -43,6 +37,33 @@ System::System(std::string fileName,
                std::string outName,
                Real kb) : lattice_(fileName)
 {
+    if (this -> lattice_.getError() != "")
+        EXIT("The sample file " + fileName + " can't be read because " + this -> lattice_.getError() + " !!!");
+    this -> initialize(temps, fields, mcs, seed, outName, kb);
+}
+
+System::System(const UnitCell& cell,
+               std::vector<Real> temps,
+               std::vector<Real> fields,
+               Index mcs,
+               Index seed,
+               std::string outName,
+               Real kb) : lattice_(cell)
+{
+    this -> initialize(temps, fields, mcs, seed, outName, kb);
+}
+
+void System::initialize(std::vector<Real> temps,
+                        std::vector<Real> fields,
+                        Index mcs,
+                        Index seed,
+                        std::string outName,
+                        Real kb)
+{
+    for (auto&& atom : this -> lattice_.getAtoms())
+        if (atom.getModel() == Model::UNKNOWN)
+            EXIT("The site " + std::to_string(atom.getIndex()) + " has an unknown model !!!");
+
     this -> mcs_ = mcs;
     this -> kb_ = kb;
     this -> temps_ = temps;
@@ -69,15 +90,26 @@ System::System(std::string fileName,
 
     std::remove(outName.c_str());
 
-
-    this -> reporter_ = Reporter(this -> outName_,
-                                 this -> magnetizationByTypeIndex_,
-                                 this -> lattice_,
-                                 this -> temps_,
-                                 this -> fields_,
-                                 this -> mcs_,
-                                 this -> seed_,
-                                 this -> kb_);
+    this -> engineType_ = "metropolis";
+    this -> sweep_ = "random";
+    this -> sweepOrder_ = SweepOrder::RANDOM;
+    this -> stride_ = 1;
+    this -> adaptiveError_ = 0.0;
+    this -> independent_ = false;
+    this -> acceptanceKT_ = - 1.0;
+    this -> acceptanceKeys_ = std::vector<Real>(ACCEPTANCESLOTS, std::numeric_limits<Real>::quiet_NaN());
+    this -> acceptanceValues_ = std::vector<Real>(ACCEPTANCESLOTS, 0.0);
+    this -> anisotropyRanges_ = std::vector<Real>(this -> lattice_.getAtoms().size(), 0.0);
+    this -> wangLandauRange_[0] = 0.0;
+    this -> wangLandauRange_[1] = 0.0;
+    this -> minimumMcs_ = mcs;
+    this -> recordSteps_ = 1;
+    this -> recordBlocks_ = false;
+    this -> snapshotSteps_ = 0;
+    this -> snapshotBuffers_ = 0;
+    this -> structureSteps_ = 1;
+    this -> correlationSteps_ = 1;
+    this -> timingStderr_ = false;
 }
 
 System::~System()
@@ -122,6 +154,8 @@ Real System::totalEnergy(Real H)
         other_energy += atom.getAnisotropyEnergy(atom);
         other_energy += atom.getZeemanEnergy(H);
     }
+    if (this -> dipolar_.isEnabled())
+        other_energy += this -> dipolar_.getEnergy();
     return 0.5 * exchange_energy + other_energy;
 }
 
@@ -130,133 +164,645 @@ void System::randomizeSpins()
     for (auto& atom : this -> lattice_.getAtoms())
         atom.randomInitialState(this -> engine_,
             this -> realRandomGenerator_,
-            this -> gaussianRandomGenerator_,
-            atom);
+            this -> gaussianRandomGenerator_);
 }
 
 
 void System::monteCarloStep(Real T, Real H)
 {
     Index num = Index(this -> realRandomGenerator_(this -> engine_) * 5);
-    for (Index _ = 0; _ < this -> lattice_.getAtoms().size(); ++_)
+    const Index N = this -> lattice_.getAtoms().size();
+    const Real kT = this -> kb_ * T;
+    Index site = 0;
+    Index offset = 0;
+    for (Index _ = 0; _ < N; ++_)
     {
-        Index randIndex = this -> intRandomGenerator_(this -> engine_);
+        // The sequential and strided orders walk the sites as they are
+        // stored, so they profit from a reordered lattice.
+        Index randIndex;
+        if (this -> sweepOrder_ == SweepOrder::SEQUENTIAL)
+        {
+            randIndex = _;
+        }
+        else if (this -> sweepOrder_ == SweepOrder::STRIDED)
+        {
+            if (site >= N)
+                site = ++offset;
+            randIndex = site;
+            site += this -> stride_;
+        }
+        else
+        {
+            randIndex = this -> intRandomGenerator_(this -> engine_);
+        }
         Atom& atom = this -> lattice_.getAtoms().at(randIndex);
-        Real oldEnergy = this -> localEnergy(atom, H);
+
+        // The uniform number is drawn first, so the move is rejected as
+        // soon as the energy change surely exceeds -kT ln(u).
+        Real u = this -> realRandomGenerator_(this -> engine_);
+        Real threshold = - 1.0;
+
+        // Exchange and Zeeman field over the site, which doesn't depend on
+        // its own spin.
+        Real field[3] = {0.0, 0.0, 0.0};
+        Index nbh_c = 0;
+        for (auto&& nbh : atom.getNbhs())
+        {
+            const Real J = atom.getExchanges()[nbh_c++];
+            const Array& spin = nbh -> getSpin();
+            field[0] += J * spin[0];
+            field[1] += J * spin[1];
+            field[2] += J * spin[2];
+        }
+        const Array& externalField = atom.getExternalField();
+        for (Index c = 0; c < 3; ++c)
+            field[c] += H * externalField[c];
+
         atom.randomizeSpin(this -> engine_,
             this -> realRandomGenerator_,
             this -> gaussianRandomGenerator_,
-            this -> sigma_.at(atom.getTypeIndex()), atom, num);
-        Real newEnergy = this -> localEnergy(atom, H);
-        Real deltaEnergy = newEnergy - oldEnergy;
+            this -> sigma_.at(atom.getTypeIndex()), num);
+        const Array& spin = atom.getSpin();
+        const Array& oldSpin = atom.getOldSpin();
+        Real deltaEnergy = - ((spin[0] - oldSpin[0]) * field[0] +
+                              (spin[1] - oldSpin[1]) * field[1] +
+                              (spin[2] - oldSpin[2]) * field[2]);
 
-        if (deltaEnergy > 0 && this -> realRandomGenerator_(this -> engine_) > std::exp(- deltaEnergy / (this -> kb_ * T)))
+        bool rejected = false;
+        if (!atom.getAnisotropyTerms().empty())
+        {
+            if (!this -> dipolar_.isEnabled() && kT > 0.0 && deltaEnergy - this -> anisotropyRanges_[randIndex] > 0.0)
+            {
+                threshold = - kT * std::log(u);
+                rejected = deltaEnergy - this -> anisotropyRanges_[randIndex] > threshold;
+            }
+            if (!rejected)
+            {
+                for (auto&& term : atom.getAnisotropyTerms())
+                    deltaEnergy += term.energy(spin) - term.energy(oldSpin);
+            }
+        }
+
+        // The dipolar field over the site doesn't depend on its own spin.
+        Real deltaDipolar = 0.0;
+        if (this -> dipolar_.isEnabled())
+        {
+            Array dipolarField = this -> dipolar_.getLocalField(randIndex);
+            deltaDipolar = - ((spin - oldSpin) * dipolarField).sum();
+            deltaEnergy += deltaDipolar;
+        }
+
+        if (!rejected && deltaEnergy > 0.0)
+        {
+            if (kT <= 0.0)
+                rejected = true;
+            else if (atom.getModel() == Model::FLIP || atom.getModel() == Model::QISING)
+                rejected = u >= this -> acceptance(deltaEnergy, kT);
+            else
+                rejected = deltaEnergy > ((threshold < 0.0) ? - kT * std::log(u) : threshold);
+        }
+
+        if (rejected)
         {
             atom.revertSpin();
             this -> counterRejections_.at(atom.getTypeIndex()) += 1;
         }
+        else if (this -> dipolar_.isEnabled())
+        {
+            this -> dipolar_.update(this -> lattice_.getAtoms(), randIndex, deltaDipolar);
+        }
     }
 }
 
+// The discrete models have few different energy changes at a given
+// temperature, so their acceptances are kept in a small table indexed by
+// the bits of the energy change, without calling exp() again.
+Real System::acceptance(Real deltaEnergy, Real kT)
+{
+    if (kT != this -> acceptanceKT_)
+    {
+        this -> acceptanceKT_ = kT;
+        std::fill(this -> acceptanceKeys_.begin(), this -> acceptanceKeys_.end(), std::numeric_limits<Real>::quiet_NaN());
+    }
+
+    std::uint64_t bits;
+    std::memcpy(&bits, &deltaEnergy, sizeof(bits));
+    Index slot = (bits ^ (bits >> 29) ^ (bits >> 41)) % ACCEPTANCESLOTS;
+    if (this -> acceptanceKeys_[slot] != deltaEnergy)
+    {
+        this -> acceptanceKeys_[slot] = deltaEnergy;
+        this -> acceptanceValues_[slot] = std::exp(- deltaEnergy / kT);
+    }
+    return this -> acceptanceValues_[slot];
+}
+
+// The width of the gaussian moves of each type is adapted towards a
+// rejection of the half of the attempts.
+void System::adaptSigma()
+{
+    for (Index i = 0; i < this -> num_types_; ++i)
+    {
+        Real rejection = this -> counterRejections_.at(i) / Real(this -> lattice_.getSizesByIndex().at(i));
+        Real sigma_temp = this -> sigma_.at(i) * (0.5 / rejection);
+        if (sigma_temp > 60.0 || sigma_temp < 1e-10)
+        {
+            sigma_temp = 60.0;
+        }
+        this -> sigma_.at(i) = sigma_temp;
+        this -> counterRejections_.at(i) = 0;
+    }
+}
+
+void System::wangLandauCycle()
+{
+    const Real H = this -> fields_.at(0);
+    const Index N = this -> lattice_.getAtoms().size();
+    const Real Tmin = *std::min_element(this -> temps_.begin(), this -> temps_.end());
+    const Real Tmax = *std::max_element(this -> temps_.begin(), this -> temps_.end());
+
+    if (this -> dipolar_.isEnabled())
+        this -> dipolar_.refresh(this -> lattice_.getAtoms());
+
+    // By default the range goes from the lowest energy found after 'mcs'
+    // steps at the lowest temperature to the highest one found at the
+    // highest temperature, with a margin of 5 % at each side.
+    Real minimum = this -> wangLandauRange_[0];
+    Real maximum = this -> wangLandauRange_[1];
+    if (minimum >= maximum)
+    {
+        minimum = std::numeric_limits<Real>::infinity();
+        maximum = - std::numeric_limits<Real>::infinity();
+        for (Index _ = 0; _ < this -> mcs_; ++_)
+        {
+            this -> monteCarloStep(Tmin, H);
+            this -> adaptSigma();
+            minimum = std::min(minimum, this -> totalEnergy(H));
+        }
+        for (Index _ = 0; _ < this -> mcs_; ++_)
+        {
+            this -> monteCarloStep(Tmax, H);
+            this -> adaptSigma();
+            if (_ >= this -> mcs_ / THERMALIZATION_FRACTION)
+                maximum = std::max(maximum, this -> totalEnergy(H));
+        }
+        Real margin = 0.05 * (maximum - minimum);
+        minimum -= margin;
+        maximum += margin;
+    }
+    this -> wangLandau_.setRange(minimum, maximum);
+
+    // The walk starts inside the range, so a state out of it is cooled or
+    // heated first.
+    Real energy = this -> totalEnergy(H);
+    for (Index _ = 0; _ < this -> mcs_ && this -> wangLandau_.getBin(energy) < 0; ++_)
+    {
+        this -> monteCarloStep((energy >= maximum) ? Tmin : Tmax, H);
+        this -> adaptSigma();
+        energy = this -> totalEnergy(H);
+    }
+    long bin = this -> wangLandau_.getBin(energy);
+    if (bin < 0)
+        EXIT("The Wang-Landau walk can't start because no state was found in the range of energies !!!");
+
+    this -> ComputeMagnetization();
+    Array magnetization = this -> magnetizationByTypeIndex_.at(this -> num_types_);
+
+    const Index CHECKSWEEPS = 100;
+    Index stage = 0;
+    unsigned long long sweeps = 0;
+    while (true)
+    {
+        Index num = Index(this -> realRandomGenerator_(this -> engine_) * 5);
+        for (Index _ = 0; _ < N; ++_)
+        {
+            Index randIndex = this -> intRandomGenerator_(this -> engine_);
+            Atom& atom = this -> lattice_.getAtoms().at(randIndex);
+            Real oldEnergy = this -> localEnergy(atom, H);
+            atom.randomizeSpin(this -> engine_,
+                this -> realRandomGenerator_,
+                this -> gaussianRandomGenerator_,
+                this -> sigma_.at(atom.getTypeIndex()), num);
+            Real deltaEnergy = this -> localEnergy(atom, H) - oldEnergy;
+
+            Real deltaDipolar = 0.0;
+            if (this -> dipolar_.isEnabled())
+            {
+                Array field = this -> dipolar_.getLocalField(randIndex);
+                deltaDipolar = - ((atom.getSpin() - atom.getOldSpin()) * field).sum();
+                deltaEnergy += deltaDipolar;
+            }
+
+            long newBin = this -> wangLandau_.getBin(energy + deltaEnergy);
+            if (newBin < 0 || std::log(this -> realRandomGenerator_(this -> engine_)) > this -> wangLandau_.logAcceptance(bin, newBin))
+            {
+                atom.revertSpin();
+                this -> counterRejections_.at(atom.getTypeIndex()) += 1;
+            }
+            else
+            {
+                if (this -> dipolar_.isEnabled())
+                    this -> dipolar_.update(this -> lattice_.getAtoms(), randIndex, deltaDipolar);
+                energy += deltaEnergy;
+                magnetization += atom.getSpin() - atom.getOldSpin();
+                bin = newBin;
+            }
+            this -> wangLandau_.visit(bin, energy, std::sqrt((magnetization * magnetization).sum()));
+        }
+        this -> adaptSigma();
+        ++sweeps;
+
+        if (sweeps % CHECKSWEEPS != 0 || !this -> wangLandau_.isFlat())
+            continue;
+
+        std::cout << "stage " << stage << "\tln f = " << this -> wangLandau_.getLogF()
+                  << "\tsweeps = " << sweeps << std::endl;
+        ++stage;
+        if (!this -> wangLandau_.nextStage())
+            break;
+    }
+
+    this -> wangLandau_.write(this -> outName_, this -> temps_, H, this -> kb_, this -> seed_, N);
+}
+
 void System::cycle()
 {
+    if (this -> engineType_ == "wanglandau")
+    {
+        this -> wangLandauCycle();
+        return;
+    }
 
-    std::vector< std::vector<Real> > histMag_x(this -> num_types_ + 1);
-    std::vector< std::vector<Real> > histMag_y(this -> num_types_ + 1);
-    std::vector< std::vector<Real> > histMag_z(this -> num_types_ + 1);
+    // The reporter is created here because the layout of the output
+    // depends on the engine selected after the construction. The series
+    // have one value by record.
+    const Index records = this -> mcs_ / this -> recordSteps_;
+    this -> reporter_ = Reporter(this -> outName_,
+                                 this -> magnetizationByTypeIndex_,
+                                 this -> lattice_,
+                                 this -> temps_,
+                                 this -> fields_,
+                                 records,
+                                 this -> seed_,
+                                 this -> kb_,
+                                 this -> storage_);
 
-    for (Index i = 0; i <= this -> num_types_; ++i)
+    if (this -> engineType_ == "msc")
     {
-        histMag_x.at(i) = std::vector<Real>(0);
-        histMag_y.at(i) = std::vector<Real>(0);
-        histMag_z.at(i) = std::vector<Real>(0);
+        this -> reporter_.createReplicaDatasets(this -> temps_.size(), this -> multiSpin_.getReplicas(), records);
+        this -> multiSpin_.load(this -> lattice_);
+    }
+
+    if (this -> recordSteps_ > 1)
+        this -> reporter_.createRecordDatasets(this -> temps_.size(), this -> mcs_, this -> recordSteps_, this -> recordBlocks_, this -> lattice_);
+
+    if (this -> adaptiveError_ > 0.0)
+        this -> reporter_.createAdaptiveDatasets(this -> temps_.size());
+
+    if (this -> structure_.isEnabled())
+        this -> reporter_.createStructureDatasets(this -> temps_.size(), this -> structure_.getVectors(), this -> lattice_);
+
+    if (this -> correlation_.isEnabled())
+        this -> reporter_.createCorrelationDatasets(this -> temps_.size(), this -> correlation_.getDistances(), this -> correlation_.getPairs());
+
+    this -> reporter_.createTimingDatasets(this -> temps_.size(), this -> num_types_);
+
+    if (this -> snapshotSteps_ > 0)
+    {
+        this -> reporter_.createSnapshotDatasets(this -> lattice_.getAtoms().size());
+        this -> snapshots_ = std::make_shared<SnapshotWriter>(this -> reporter_, this -> lattice_.getAtoms().size(), this -> snapshotBuffers_);
+    }
+
+    if (this -> independent_)
+    {
+        this -> independentCycle();
+        if (this -> snapshots_)
+            this -> snapshots_ -> finish();
+        this -> reporter_.close();
+        return;
     }
 
-    Index initial_time = 0;
-    Index final_time = 0;
     Real av_time_per_step = 0.0;
 
     for (Index index = 0; index < this -> temps_.size(); ++index)
     {
-        initial_time = time(NULL);
+        this -> simulatePoint(index);
 
-        Real T = this -> temps_.at(index);
-        Real H = this -> fields_.at(index);
-        std::vector<Real> enes;
+        av_time_per_step = (av_time_per_step * index + this -> timing_.getTotal()) / (index + 1);
+        this -> printProgress(index, index + 1, av_time_per_step * (this -> temps_.size() - index));
+    }
 
-        for (Index i = 0; i <= this -> num_types_; ++i)
+    if (this -> snapshots_)
+        this -> snapshots_ -> finish();
+    this -> reporter_.close();
+
+}
+
+// Every point starts from the state of the system before the sweep, with
+// its own stream of random numbers derived from the seed, so the points
+// are distributed among the threads and the results don't depend on the
+// amount of threads.
+void System::independentCycle()
+{
+    const auto initial_time = std::chrono::steady_clock::now();
+    Index done = 0;
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (long index = 0; index < long(this -> temps_.size()); ++index)
+    {
+        System worker(*this);
+        std::seed_seq sequence{this -> seed_, Index(index)};
+        worker.engine_.seed(sequence);
+        worker.simulatePoint(index);
+
+        #pragma omp critical(vegas_output)
         {
-            histMag_x.at(i).clear();
-            histMag_y.at(i).clear();
-            histMag_z.at(i).clear();
+            done++;
+            Real elapsed = std::chrono::duration<Real>(std::chrono::steady_clock::now() - initial_time).count();
+            worker.printProgress(index, done, elapsed / done * (this -> temps_.size() - done));
         }
+    }
+}
 
-        Real rejection;
-        Real sigma_temp;
-        for (Index _ = 0; _ < this -> mcs_; ++_)
+void System::printProgress(Index index, Index done, Real seconds)
+{
+    Real T = this -> temps_.at(index);
+    Real H = this -> fields_.at(index);
+
+    rlutil::saveDefaultColor();
+    rlutil::setColor(rlutil::YELLOW);
+
+    std::cout << ETA_seconds(seconds);
+    rlutil::setColor(rlutil::LIGHTBLUE);
+    std::cout << std::setprecision(5) << std::fixed;
+    std::cout << "\t("
+              << 100.0 * done / (this -> temps_.size())
+              << "%)";
+    rlutil::resetColor();
+    // std::cout << "\t==>\tT = " << T << "; H = " << H << std::endl;
+    std::cout << "\t==>\tT = " << T << "; H = " << H << " ";
+    Index i = 0;
+    for (auto& element : this -> lattice_.getMapTypeIndexes())
+    {
+        std::cout << element.first << " " << this -> sigma_.at(i) << " ";
+        i++;
+    }
+    std::cout << std::endl;
+}
+
+void System::simulatePoint(Index index)
+{
+    this -> timing_.start(this -> num_types_);
+    const bool adaptive = this -> adaptiveError_ > 0.0;
+
+    std::vector<Real> replicaEnes;
+    std::vector< std::vector<Real> > replicaMags;
+    std::vector< std::vector<Real> > histReplicaEnes;
+    std::vector< std::vector<Real> > histReplicaMags;
+    if (this -> engineType_ == "msc")
+    {
+        histReplicaEnes = std::vector< std::vector<Real> >(this -> multiSpin_.getReplicas());
+        histReplicaMags = std::vector< std::vector<Real> >(this -> multiSpin_.getReplicas());
+    }
+
+    std::vector< std::vector<Real> > histMag_x(this -> num_types_ + 1);
+    std::vector< std::vector<Real> > histMag_y(this -> num_types_ + 1);
+    std::vector< std::vector<Real> > histMag_z(this -> num_types_ + 1);
+    // |M| of each type and of the whole sample, and the variances of the
+    // blocks of steps of each record.
+    std::vector< std::vector<Real> > histMagNorm(this -> num_types_ + 1);
+    std::vector<Real> eneVariances;
+    std::vector< std::vector<Real> > magVariances(this -> num_types_ + 1);
+    const Index steps = this -> recordSteps_;
+    const bool blocks = this -> recordBlocks_;
+
+    Real T = this -> temps_.at(index);
+    Real H = this -> fields_.at(index);
+    std::vector<Real> enes;
+
+    if (this -> engineType_ == "msc")
+        this -> multiSpin_.prepare(T, H, this -> kb_);
+    if (this -> engineType_ == "llg")
+        this -> llg_.load(this -> lattice_);
+
+    if (this -> dipolar_.isEnabled())
+        this -> dipolar_.refresh(this -> lattice_.getAtoms());
+
+    // Each step of the msc engine tries a move on every replica of each
+    // site, and the one of the others on each site.
+    const Index N = this -> lattice_.getAtoms().size();
+    const bool metropolis = this -> engineType_ != "msc" && this -> engineType_ != "llg";
+    const double trials = double(N) * ((this -> engineType_ == "msc") ? this -> multiSpin_.getReplicas() : 1);
+
+    Index thermalization = (this -> mcs_ / steps) / THERMALIZATION_FRACTION;
+    // The structure factor and the correlation function are measured after
+    // the thermalization, which in the adaptive mode is taken from the
+    // minimum of steps.
+    const Index measurement = (adaptive ? this -> minimumMcs_ : this -> mcs_) / THERMALIZATION_FRACTION;
+    this -> structure_.reset();
+    this -> correlation_.reset();
+    Index nextCheck = this -> minimumMcs_;
+    bool stopped = false;
+    for (Index _ = 0; _ < this -> mcs_; ++_)
+    {
+        if (this -> engineType_ == "msc")
+        {
+            // The replica 0 feeds the usual datasets.
+            this -> multiSpin_.monteCarloStep(this -> engine_);
+            this -> timing_.lap(SWEEP);
+            this -> multiSpin_.measure(H, replicaEnes, replicaMags);
+            enes.push_back(replicaEnes.at(0));
+            for (Index t = 0; t <= this -> num_types_; ++t)
+                this -> magnetizationByTypeIndex_.at(t) = {0.0, 0.0, replicaMags.at(t).at(0)};
+
+            for (Index r = 0; r < replicaEnes.size(); ++r)
+            {
+                histReplicaEnes.at(r).push_back(replicaEnes.at(r));
+                histReplicaMags.at(r).push_back(replicaMags.at(this -> num_types_).at(r));
+            }
+        }
+        else if (this -> engineType_ == "llg")
+        {
+            this -> llg_.run(H);
+            this -> timing_.lap(SWEEP);
+            this -> llg_.store(this -> lattice_);
+            enes.push_back(this -> totalEnergy(H));
+            this -> ComputeMagnetization();
+        }
+        else
         {
             this -> monteCarloStep(T, H);
+            this -> timing_.lap(SWEEP);
             enes.push_back(this -> totalEnergy(H));
             this -> ComputeMagnetization();
-            // auto mag = this -> magnetizationType_.at("magnetization");
+        }
+        // auto mag = this -> magnetizationType_.at("magnetization");
+        this -> timing_.lap(MEASUREMENT);
+
+        // The rejections are counted before the adaptation clears them.
+        this -> timing_.addTrials(trials);
+        if (metropolis)
+            for (Index i = 0; i < this -> num_types_; ++i)
+                this -> timing_.addMoves(i, this -> lattice_.getSizesByIndex().at(i), this -> counterRejections_.at(i));
+        this -> adaptSigma();
+        this -> timing_.lap(SIGMA);
+
+        for (Index i = 0; i <= this -> num_types_; ++i)
+        {
+            histMag_x.at(i).push_back(this -> magnetizationByTypeIndex_.at(i)[0]);
+            histMag_y.at(i).push_back(this -> magnetizationByTypeIndex_.at(i)[1]);
+            histMag_z.at(i).push_back(this -> magnetizationByTypeIndex_.at(i)[2]);
+            histMagNorm.at(i).push_back(std::sqrt(histMag_x.at(i).back() * histMag_x.at(i).back() +
+                                                  histMag_y.at(i).back() * histMag_y.at(i).back() +
+                                                  histMag_z.at(i).back() * histMag_z.at(i).back()));
+        }
 
+        // The multi-spin coding engine keeps its spins apart from the
+        // lattice, so they are stored before each snapshot or measurement
+        // of the structure factor or of the correlation function.
+        const bool snapshot = this -> snapshotSteps_ > 0 && (_ + 1) % this -> snapshotSteps_ == 0;
+        const bool structure = this -> structure_.isEnabled() && _ >= measurement && (_ + 1) % this -> structureSteps_ == 0;
+        const bool correlation = this -> correlation_.isEnabled() && _ >= measurement && (_ + 1) % this -> correlationSteps_ == 0;
+        if ((snapshot || structure || correlation) && this -> engineType_ == "msc")
+            this -> multiSpin_.store(this -> lattice_);
+        if (snapshot)
+            this -> snapshots_ -> push(this -> lattice_, index, _ + 1);
+        if (structure)
+            this -> structure_.measure(this -> lattice_);
+        if (correlation)
+            this -> correlation_.measure(this -> lattice_);
+        this -> timing_.lap(OBSERVABLES);
 
-            Index i = 0;
-            for (auto& val : this -> counterRejections_)
+        // The steps of each record are reduced as soon as it's complete,
+        // so the series never hold more than one block of raw steps.
+        if (steps > 1)
+        {
+            if ((_ + 1) % steps != 0)
+                continue;
+            recordTail(enes, steps, blocks, blocks ? &eneVariances : nullptr);
+            for (Index i = 0; i <= this -> num_types_; ++i)
             {
-                rejection = val / Real(this -> lattice_.getSizesByIndex().at(i));
-                sigma_temp = this -> sigma_.at(i) * (0.5 / rejection);
-                if (sigma_temp > 60.0 || sigma_temp < 1e-10)
-                {
-                    sigma_temp = 60.0;
-                }
-                this -> sigma_.at(i) = sigma_temp;
-                this -> counterRejections_.at(i) = 0;
-
-
-                histMag_x.at(i).push_back(this -> magnetizationByTypeIndex_.at(i)[0]);
-                histMag_y.at(i).push_back(this -> magnetizationByTypeIndex_.at(i)[1]);
-                histMag_z.at(i).push_back(this -> magnetizationByTypeIndex_.at(i)[2]);
-                i++;
+                recordTail(histMag_x.at(i), steps, blocks, nullptr);
+                recordTail(histMag_y.at(i), steps, blocks, nullptr);
+                recordTail(histMag_z.at(i), steps, blocks, nullptr);
+                recordTail(histMagNorm.at(i), steps, blocks, blocks ? &magVariances.at(i) : nullptr);
             }
+            for (auto& hist : histReplicaEnes)
+                recordTail(hist, steps, blocks, nullptr);
+            for (auto& hist : histReplicaMags)
+                recordTail(hist, steps, blocks, nullptr);
+            this -> timing_.lap(MEASUREMENT);
+        }
 
-            histMag_x.at(this -> num_types_).push_back(this -> magnetizationByTypeIndex_.at(this -> num_types_)[0]);
-            histMag_y.at(this -> num_types_).push_back(this -> magnetizationByTypeIndex_.at(this -> num_types_)[1]);
-            histMag_z.at(this -> num_types_).push_back(this -> magnetizationByTypeIndex_.at(this -> num_types_)[2]);
+        // The checks are spaced geometrically, so they cost a fixed
+        // fraction of the analysis of the whole series.
+        if (adaptive && _ + 1 >= nextCheck)
+        {
+            nextCheck += std::max(Index(1), nextCheck / 8);
+            Index equilibration = equilibrationMSER(enes, std::max(Index(1), Index(enes.size() / 100)));
+            if (equilibration < enes.size() &&
+                analyzeSeries(enes, equilibration).error / this -> lattice_.getAtoms().size() <= this -> adaptiveError_)
+            {
+                thermalization = equilibration;
+                stopped = true;
+                this -> timing_.lap(ANALYSIS);
+                break;
+            }
+            this -> timing_.lap(ANALYSIS);
+        }
+    }
 
+    // The steps after the last complete record are dropped.
+    if (steps > 1)
+    {
+        const Index records = (stopped ? enes.size() : this -> mcs_ / steps);
+        enes.resize(records);
+        for (Index i = 0; i <= this -> num_types_; ++i)
+        {
+            histMag_x.at(i).resize(records);
+            histMag_y.at(i).resize(records);
+            histMag_z.at(i).resize(records);
+            histMagNorm.at(i).resize(records);
+        }
+        for (auto& hist : histReplicaEnes)
+            hist.resize(records);
+        for (auto& hist : histReplicaMags)
+            hist.resize(records);
+    }
+
+    // A point which didn't reach the target error discards the usual
+    // fraction of the series, unless it was detected equilibrated.
+    const Index used = enes.size();
+    if (adaptive && !stopped)
+    {
+        Index equilibration = equilibrationMSER(enes, std::max(Index(1), Index(used / 100)));
+        if (equilibration < used)
+            thermalization = equilibration;
+    }
 
+    SeriesStatistics energyStatistics = analyzeSeries(enes, thermalization);
+    SeriesStatistics magnetizationStatistics = analyzeSeries(histMagNorm.at(this -> num_types_), thermalization);
 
+    // The series of the points stopped early are padded with NaN, so
+    // all the datasets keep their shape (points, records).
+    if (adaptive)
+    {
+        const Real NaN = std::numeric_limits<Real>::quiet_NaN();
+        const Index records = this -> mcs_ / steps;
+        enes.resize(records, NaN);
+        eneVariances.resize(blocks ? records : 0, NaN);
+        for (Index i = 0; i <= this -> num_types_; ++i)
+        {
+            histMagNorm.at(i).resize(records, NaN);
+            histMag_x.at(i).resize(records, NaN);
+            histMag_y.at(i).resize(records, NaN);
+            histMag_z.at(i).resize(records, NaN);
+            magVariances.at(i).resize(blocks ? records : 0, NaN);
         }
-        this -> reporter_.partial_report(enes, histMag_x, histMag_y, histMag_z, this -> lattice_, index);
+        for (auto& hist : histReplicaEnes)
+            hist.resize(records, NaN);
+        for (auto& hist : histReplicaMags)
+            hist.resize(records, NaN);
+    }
 
+    if (this -> engineType_ == "msc")
+        this -> multiSpin_.store(this -> lattice_);
 
-        final_time = time(NULL);
-        av_time_per_step = (av_time_per_step*index + final_time - initial_time) / (index + 1);
+    std::ostringstream rngState;
+    rngState << this -> engine_;
+    this -> timing_.lap(ANALYSIS);
 
-        rlutil::saveDefaultColor();
-        rlutil::setColor(rlutil::YELLOW);
+    // The HDF5 library is not thread safe, so the points simulated in
+    // parallel write their rows one at a time, and not while a snapshot
+    // is written.
+    #pragma omp critical(vegas_output)
+    {
+        std::lock_guard<std::mutex> lock(hdf5Lock());
+        this -> reporter_.statistics_report(energyStatistics, magnetizationStatistics, index);
+        this -> reporter_.restart_report(rngState.str(), this -> sigma_, index);
+        if (adaptive)
+            this -> reporter_.adaptive_report(used * steps, thermalization * steps, index);
+        if (this -> engineType_ == "msc")
+            this -> reporter_.replica_report(histReplicaEnes, histReplicaMags, index);
+        if (blocks && steps > 1)
+            this -> reporter_.block_report(eneVariances, histMagNorm, magVariances, index);
+        if (this -> structure_.isEnabled())
+            this -> reporter_.structure_report(this -> structure_.getMean(), index);
+        if (this -> correlation_.isEnabled())
+            this -> reporter_.correlation_report(this -> correlation_.getMean(), this -> correlation_.getLength(), index);
+        this -> reporter_.partial_report(enes, histMag_x, histMag_y, histMag_z, this -> lattice_, index);
 
-        std::cout << ETA_seconds(av_time_per_step * (this -> temps_.size() - index));
-        rlutil::setColor(rlutil::LIGHTBLUE);
-        std::cout << std::setprecision(5) << std::fixed;
-        std::cout << "\t("
-                  << 100.0 * (index + 1) / (this -> temps_.size())
-                  << "%)";
-        rlutil::resetColor();
-        // std::cout << "\t==>\tT = " << T << "; H = " << H << std::endl;
-        std::cout << "\t==>\tT = " << T << "; H = " << H << " ";
-        Index i = 0;
-        for (auto& element : this -> lattice_.getMapTypeIndexes())
+        // The wait for the lock is part of the writes, so a point slowed
+        // down by the output of the others shows it.
+        this -> timing_.lap(WRITE);
+        this -> reporter_.timing_report(this -> timing_, index);
+        if (this -> timingStderr_)
         {
-            std::cout << element.first << " " << this -> sigma_.at(i) << " ";
-            i++;
+            std::vector<std::string> types;
+            for (auto& type : this -> lattice_.getMapIndexTypes())
+                types.push_back(type.second);
+            std::cerr << this -> timing_.json(index, T, H, types) << std::endl;
         }
-        std::cout << std::endl;
-
     }
-
-    this -> reporter_.close();
-
 }
 
 Lattice& System::getLattice()
@@ -269,18 +815,124 @@ Index System::getSeed() const
     return this -> seed_;
 }
 
-void System::setState(std::string fileState)
+// The HDF5 files are recognized by their signature.
+bool isHDF5(const std::string& fileName)
 {
-    std::ifstream file(fileState);
+    char signature[8] = {0};
+    std::ifstream file(fileName, std::ios::binary);
+    file.read(signature, 8);
+    return std::memcmp(signature, "\211HDF\r\n\032\n", 8) == 0;
+}
 
-    Array spin;
-    std::string sx;
-    std::string sy;
-    std::string sz;
-    for (auto& atom : this -> lattice_.getAtoms())
+// Reads a dataset of shape (sites, width) of an HDF5 file, or the row
+// 'row' (the last one if it's negative) of one of shape (rows, sites,
+// width), returning the reason on errors.
+std::string readSiteDataset(const std::string& fileName, const std::string& name, int row,
+                            Index sites, std::vector<Real>& values, Index& width)
+{
+    H5Eset_auto(H5E_DEFAULT, NULL, NULL);
+    hid_t file = H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    if (file < 0)
+        return "it can't be opened";
+    if (H5Lexists(file, name.c_str(), H5P_DEFAULT) <= 0)
+    {
+        H5Fclose(file);
+        return "it doesn't have the dataset '" + name + "'";
+    }
+
+    hid_t dset = H5Dopen2(file, name.c_str(), H5P_DEFAULT);
+    hid_t filespace = H5Dget_space(dset);
+    int rank = H5Sget_simple_extent_ndims(filespace);
+    hsize_t dims[3] = {0, 0, 0};
+    std::string reason = "";
+    if (rank == 2 || rank == 3)
+    {
+        H5Sget_simple_extent_dims(filespace, dims, NULL);
+        hsize_t start[3] = {0, 0, 0};
+        hsize_t count[3] = {dims[0], dims[1], dims[2]};
+        if (rank == 3)
+        {
+            start[0] = (row < 0) ? dims[0] - 1 : row;
+            count[0] = 1;
+        }
+        const hsize_t* shape = (rank == 3) ? &count[1] : count;
+        if (rank == 3 && (dims[0] == 0 || start[0] >= dims[0]))
+        {
+            reason = "the dataset '" + name + "' has " + std::to_string(dims[0]) + " rows";
+        }
+        else if (shape[0] != sites)
+        {
+            reason = "the dataset '" + name + "' doesn't have a row of " + std::to_string(sites) + " sites";
+        }
+        else
+        {
+            width = shape[1];
+            values = std::vector<Real>(std::size_t(sites) * width);
+            H5Sselect_hyperslab(filespace, H5S_SELECT_SET, start, NULL, count, NULL);
+            hid_t memspace = H5Screate_simple(rank, count, NULL);
+            if (H5Dread(dset, H5T_NATIVE_DOUBLE, memspace, filespace, H5P_DEFAULT, values.data()) < 0)
+                reason = "the dataset '" + name + "' can't be read";
+            H5Sclose(memspace);
+        }
+    }
+    else
+    {
+        reason = "the dataset '" + name + "' doesn't have two or three dimensions";
+    }
+
+    H5Sclose(filespace);
+    H5Dclose(dset);
+    H5Fclose(file);
+    return reason;
+}
+
+// The initial state is a text file with the three components of the spin
+// of each site, or an HDF5 file with them in the dataset 'state', or the
+// output of a previous run, whose final state of the point 'row' (by
+// default the last one) is used. The random generator and the widths of
+// the moves are also restored from the outputs which have them.
+void System::setState(std::string fileState, int row)
+{
+    const Index N = this -> lattice_.getAtoms().size();
+    std::vector<Real> spins;
+    std::string reason = "";
+    if (isHDF5(fileState))
+    {
+        H5Eset_auto(H5E_DEFAULT, NULL, NULL);
+        hid_t file = H5Fopen(fileState.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+        bool state = row < 0 && file >= 0 && H5Lexists(file, "state", H5P_DEFAULT) > 0;
+        bool restart = !state && file >= 0 &&
+                       H5Lexists(file, "rng_state", H5P_DEFAULT) > 0 &&
+                       H5Lexists(file, "sigma", H5P_DEFAULT) > 0;
+        if (file >= 0)
+            H5Fclose(file);
+
+        Index width = 0;
+        reason = readSiteDataset(fileState, state ? "state" : "finalstates", row, N, spins, width);
+        if (reason == "" && width != 3)
+            reason = "the spins don't have three components";
+        if (reason == "" && restart)
+            reason = this -> restoreGenerator(fileState, row);
+    }
+    else if (row >= 0)
+    {
+        reason = "only the outputs of vegas have rows";
+    }
+    else
     {
-        file >> sx >> sy >> sz;
-        Array spin({atof(sx.c_str()), atof(sy.c_str()), atof(sz.c_str())});
+        TextFile file;
+        std::vector<Index> widths;
+        reason = file.open(fileState);
+        if (reason == "")
+            reason = readNumberRows(file, N, {3}, spins, widths);
+    }
+    if (reason != "")
+        EXIT("The initial state file " + fileState + " can't be read because " + reason + " !!!");
+
+    for (Index index = 0; index < N; ++index)
+    {
+        Atom& atom = this -> lattice_.getAtoms().at(this -> lattice_.getSiteByIndex(index));
+        Array spin({spins[3 * index], spins[3 * index + 1], spins[3 * index + 2]});
         Real norm = std::round(std::sqrt((spin*spin).sum()) * 10000) / 10000;
         if (norm != atom.getSpinNorm())
         {
@@ -294,61 +946,373 @@ void System::setState(std::string fileState)
     }
 }
 
+// The state of the random generator and the widths of the moves at the end
+// of the point 'row' (the last one if it's negative) of a previous output.
+std::string System::restoreGenerator(const std::string& fileName, int row)
+{
+    hid_t file = H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    hid_t rng = H5Dopen2(file, "rng_state", H5P_DEFAULT);
+    hid_t sigma = H5Dopen2(file, "sigma", H5P_DEFAULT);
+    hid_t rngSpace = H5Dget_space(rng);
+    hid_t sigmaSpace = H5Dget_space(sigma);
+    hsize_t dims[2] = {0, 0};
+    H5Sget_simple_extent_dims(sigmaSpace, dims, NULL);
+
+    std::string reason = "";
+    if (dims[1] != this -> num_types_)
+    {
+        reason = "the widths of the moves don't have " + std::to_string(this -> num_types_) + " types";
+    }
+    else
+    {
+        hsize_t start[2] = {(row < 0) ? dims[0] - 1 : hsize_t(row), 0};
+        hsize_t count[2] = {1, dims[1]};
+        hid_t memtype = H5Tcopy(H5T_C_S1);
+        H5Tset_size(memtype, H5T_VARIABLE);
+        hid_t memspace = H5Screate_simple(1, count, NULL);
+        char* state = NULL;
+        H5Sselect_hyperslab(rngSpace, H5S_SELECT_SET, start, NULL, count, NULL);
+        H5Dread(rng, memtype, memspace, rngSpace, H5P_DEFAULT, &state);
+        H5Sclose(memspace);
+
+        memspace = H5Screate_simple(2, count, NULL);
+        std::vector<Real> widths(dims[1]);
+        H5Sselect_hyperslab(sigmaSpace, H5S_SELECT_SET, start, NULL, count, NULL);
+        H5Dread(sigma, H5T_NATIVE_DOUBLE, memspace, sigmaSpace, H5P_DEFAULT, widths.data());
+        H5Sclose(memspace);
+
+        // The points which weren't simulated have neither state nor widths.
+        std::istringstream in((state != NULL) ? state : "");
+        std::mt19937_64 engine;
+        if (in >> engine)
+        {
+            this -> engine_ = engine;
+            this -> gaussianRandomGenerator_.reset();
+            this -> sigma_ = widths;
+        }
+        else
+        {
+            reason = "the point " + std::to_string(start[0]) + " doesn't have the state of the random generator";
+        }
+        if (state != NULL)
+            H5free_memory(state);
+        H5Tclose(memtype);
+    }
+
+    H5Sclose(rngSpace);
+    H5Sclose(sigmaSpace);
+    H5Dclose(rng);
+    H5Dclose(sigma);
+    H5Fclose(file);
+    return reason;
+}
+
+// Each anisotropy file has a row by site with an uniaxial term (the axis
+// and the constant) or a cubic one (the axes A and B and the constant),
+// as text or in the dataset 'anisotropy' of an HDF5 file.
 void System::setAnisotropies(std::vector<std::string> anisotropyfiles)
 {
+    const Index N = this -> lattice_.getAtoms().size();
     for (auto& fileName : anisotropyfiles)
     {
-        std::ifstream file(fileName);
-        for (Index i = 0; i < this -> lattice_.getAtoms().size(); ++i)
+        std::vector<Real> values;
+        std::vector<Index> widths;
+        Index stride = 7;
+        std::string reason = "";
+        if (isHDF5(fileName))
         {
-            std::string line;
-            std::getline(file, line);
-            std::vector<std::string> sep = split(line, ' ');
+            reason = readSiteDataset(fileName, "anisotropy", -1, N, values, stride);
+            if (reason == "" && stride != 4 && stride != 7)
+                reason = "the rows don't have 4 or 7 values";
+            widths = std::vector<Index>(N, stride);
+        }
+        else
+        {
+            TextFile file;
+            reason = file.open(fileName);
+            if (reason == "")
+                reason = readNumberRows(file, N, {4, 7}, values, widths);
+        }
+        if (reason != "")
+            EXIT("The anisotropy file with name " + fileName + " does not have the correct format because " + reason + " !!!");
 
-            if (sep.size() == 4) // add an uniaxial term
+        for (Index i = 0; i < N; ++i)
+        {
+            const Real* row = &values[std::size_t(i) * stride];
+            AnisotropyTerm term;
+            if (widths[i] == 4) // add an uniaxial term
             {
-                Real ax = atof(sep[0].c_str());
-                Real ay = atof(sep[1].c_str());
-                Real az = atof(sep[2].c_str());
-                Real kan = atof(sep[3].c_str());
-
-                std::function<Real(const Atom&)> func = [kan, ax, ay, az](const Atom& atom){
-                   return - kan * (ax * atom.getSpin()[0] + ay * atom.getSpin()[1] + az * atom.getSpin()[2]) * (ax * atom.getSpin()[0] + ay * atom.getSpin()[1] + az * atom.getSpin()[2]);
-                };
-                this -> lattice_.getAtoms().at(i).addAnisotropyTerm(func);
+                term.cubic = false;
+                term.axes[0] = {row[0], row[1], row[2]};
+                term.constant = row[3];
             }
-            else if (sep.size() == 7)
+            else
             {
-                Real Ax = atof(sep[0].c_str());
-                Real Ay = atof(sep[1].c_str());
-                Real Az = atof(sep[2].c_str());
-                Real Bx = atof(sep[3].c_str());
-                Real By = atof(sep[4].c_str());
-                Real Bz = atof(sep[5].c_str());
+                Array A = {row[0], row[1], row[2]};
+                Array B = {row[3], row[4], row[5]};
+                Array C = {A[1]*B[2] - A[2]*B[1], A[2]*B[0] - A[0]*B[2], A[0]*B[1] - A[1]*B[0]};
 
-                Real Cx = Ay*Bz - Az*By;
-                Real Cy = Az*Bx - Ax*Bz;
-                Real Cz = Ax*By - Ay*Bx;
+                term.cubic = true;
+                term.axes[0] = A;
+                term.axes[1] = B;
+                term.axes[2] = C;
+                term.constant = row[6];
+            }
+            this -> lattice_.getAtoms().at(this -> lattice_.getSiteByIndex(i)).addAnisotropyTerm(term);
+        }
+    }
 
-                Array A = {Ax, Ay, Az};
-                Array B = {Bx, By, Bz};
-                Array C = {Cx, Cy, Cz};
+    for (Index i = 0; i < N; ++i)
+    {
+        const Atom& atom = this -> lattice_.getAtoms().at(i);
+        this -> anisotropyRanges_.at(i) = 0.0;
+        for (auto&& term : atom.getAnisotropyTerms())
+            this -> anisotropyRanges_.at(i) += term.range(atom.getSpinNorm());
+    }
+}
 
-                Real kan = atof(sep[6].c_str());
+void System::setEngine(std::string engine, Index replicas)
+{
+    if (engine == "metropolis")
+    {
+        this -> engineType_ = engine;
+    }
+    else if (engine == "msc")
+    {
+        std::string reason = MultiSpin::checkLattice(this -> lattice_);
+        if (this -> dipolar_.isEnabled())
+            reason = "it does not support the dipolar interaction";
+        if (reason != "")
+            EXIT("The multi-spin coding engine can't be used because " + reason + " !!!");
+        if (replicas < 1 || replicas > 64)
+            EXIT("The number of replicas must be between 1 and 64 !!!");
 
-                std::function<Real(const Atom&)> func = [kan, A, B, C](const Atom& atom){
-                    return - kan * ((atom.getSpin() * A).sum()*(atom.getSpin() * A).sum()*(atom.getSpin() * B).sum()*(atom.getSpin() * B).sum()
-                    + (atom.getSpin() * A).sum()*(atom.getSpin() * A).sum()*(atom.getSpin() * C).sum()*(atom.getSpin() * C).sum()
-                    + (atom.getSpin() * B).sum()*(atom.getSpin() * B).sum()*(atom.getSpin() * C).sum()*(atom.getSpin() * C).sum());
-                };
+        this -> engineType_ = engine;
+        this -> multiSpin_ = MultiSpin(this -> lattice_, replicas);
+    }
+    else if (engine == "llg")
+    {
+        std::string reason = LLG::checkLattice(this -> lattice_);
+        if (this -> dipolar_.isEnabled())
+            reason = "it does not support the dipolar interaction";
+        if (reason != "")
+            EXIT("The LLG engine can't be used because " + reason + " !!!");
+        this -> engineType_ = engine;
+        this -> setLLG(0.1, 0.01, 10);
+    }
+    else if (engine == "wanglandau")
+    {
+        for (auto&& H : this -> fields_)
+            if (H != this -> fields_.at(0))
+                EXIT("The Wang-Landau engine needs the same field for all the points !!!");
+        this -> engineType_ = engine;
+        if (!this -> wangLandau_.isEnabled())
+            this -> setWangLandau(200, 0.8, 1e-6, 0.0, 0.0);
+    }
+    else
+    {
+        EXIT("The engine " + engine + " does not exist !!!");
+    }
+}
 
-                this -> lattice_.getAtoms().at(i).addAnisotropyTerm(func);
+void System::setWangLandau(Index bins, Real flatness, Real finalLogF, Real minimum, Real maximum)
+{
+    if (bins < 1)
+        EXIT("The Wang-Landau engine needs at least one bin !!!");
+    if (flatness <= 0.0 || flatness >= 1.0)
+        EXIT("The flatness of the Wang-Landau engine must be between 0 and 1 !!!");
+    if (finalLogF <= 0.0 || finalLogF >= 1.0)
+        EXIT("The final ln f of the Wang-Landau engine must be between 0 and 1 !!!");
+    this -> wangLandau_ = WangLandau(bins, flatness, finalLogF);
+    this -> wangLandauRange_[0] = minimum;
+    this -> wangLandauRange_[1] = maximum;
+}
 
-            }
-            else
-            {
-                EXIT("The anisotropy file with name " + fileName + " does not have the correct format !!!");
-            }
-        }
-    }
+void System::setLLG(Real damping, Real timestep, Index steps)
+{
+    if (damping < 0.0)
+        EXIT("The damping of the LLG engine must be positive !!!");
+    if (timestep <= 0.0)
+        EXIT("The time step of the LLG engine must be greater than 0 !!!");
+    if (steps < 1)
+        EXIT("The LLG engine needs at least one step by sample !!!");
+    this -> llg_ = LLG(this -> lattice_, damping, timestep, steps);
+}
+
+const LLG& System::getLLG() const
+{
+    return this -> llg_;
+}
+
+void System::setIndependent(bool independent)
+{
+    this -> independent_ = independent;
+}
+
+bool System::getIndependent() const
+{
+    return this -> independent_;
+}
+
+const WangLandau& System::getWangLandau() const
+{
+    return this -> wangLandau_;
+}
+
+const std::string& System::getEngine() const
+{
+    return this -> engineType_;
+}
+
+void System::setSweep(std::string sweep, Index stride)
+{
+    if (sweep != "random" && sweep != "sequential" && sweep != "strided")
+        EXIT("The sweep order " + sweep + " does not exist !!!");
+    if (stride < 1)
+        EXIT("The stride of the sweep must be greater than 0 !!!");
+
+    this -> sweep_ = sweep;
+    this -> sweepOrder_ = (sweep == "sequential") ? SweepOrder::SEQUENTIAL :
+                          (sweep == "strided") ? SweepOrder::STRIDED : SweepOrder::RANDOM;
+    this -> stride_ = stride;
+}
+
+void System::setDipolar(Real strength, Array spacing, Index refresh)
+{
+    this -> dipolar_ = Dipolar(strength, refresh);
+    std::string reason = this -> dipolar_.mapLattice(this -> lattice_, spacing);
+    if (reason != "")
+        EXIT("The dipolar interaction can't be used because " + reason + " !!!");
+}
+
+const Dipolar& System::getDipolar() const
+{
+    return this -> dipolar_;
+}
+
+void System::setAdaptive(Real error, Index minimum)
+{
+    if (error < 0.0)
+        EXIT("The target error of the adaptive mode must be positive !!!");
+    if (minimum < 10 || minimum > this -> mcs_)
+        EXIT("The minimum number of MCS must be between 10 and the number of MCS !!!");
+    this -> adaptiveError_ = error;
+    this -> minimumMcs_ = minimum;
+}
+
+Real System::getAdaptiveError() const
+{
+    return this -> adaptiveError_;
+}
+
+Index System::getMinimumMcs() const
+{
+    return this -> minimumMcs_;
+}
+
+void System::setRecord(Index steps, bool blocks)
+{
+    if (steps < 1 || this -> mcs_ / steps < 10)
+        EXIT("The steps by record must be between 1 and a tenth of the number of MCS !!!");
+    this -> recordSteps_ = steps;
+    this -> recordBlocks_ = blocks;
+}
+
+Index System::getRecordSteps() const
+{
+    return this -> recordSteps_;
+}
+
+bool System::getRecordBlocks() const
+{
+    return this -> recordBlocks_;
+}
+
+void System::setSnapshots(Index every, Index buffers)
+{
+    if (every > this -> mcs_)
+        EXIT("The steps between snapshots must be at most the number of MCS !!!");
+    if (every > 0 && buffers < 1)
+        EXIT("The amount of snapshots in flight must be greater than 0 !!!");
+    this -> snapshotSteps_ = every;
+    this -> snapshotBuffers_ = buffers;
+}
+
+Index System::getSnapshotSteps() const
+{
+    return this -> snapshotSteps_;
+}
+
+Index System::getSnapshotBuffers() const
+{
+    return this -> snapshotBuffers_;
+}
+
+void System::setStructure(const std::vector<Array>& vectors, Array spacing, Index every)
+{
+    if (every < 1 || every > this -> mcs_)
+        EXIT("The steps between measurements of the structure factor must be between 1 and the number of MCS !!!");
+    std::string reason = vectors.empty() ? this -> structure_.mapLattice(this -> lattice_, spacing)
+                                         : this -> structure_.setVectors(this -> lattice_, vectors);
+    if (reason != "")
+        EXIT("The structure factor can't be computed because " + reason + " !!!");
+    this -> structureSteps_ = every;
+}
+
+const StructureFactor& System::getStructure() const
+{
+    return this -> structure_;
+}
+
+Index System::getStructureSteps() const
+{
+    return this -> structureSteps_;
+}
+
+void System::setCorrelation(Real cutoff, Real width, Index every)
+{
+    if (every < 1 || every > this -> mcs_)
+        EXIT("The steps between measurements of the correlation function must be between 1 and the number of MCS !!!");
+    std::string reason = this -> correlation_.setup(this -> lattice_, cutoff, width);
+    if (reason != "")
+        EXIT("The correlation function can't be computed because " + reason + " !!!");
+    this -> correlationSteps_ = every;
+}
+
+const Correlation& System::getCorrelation() const
+{
+    return this -> correlation_;
+}
+
+Index System::getCorrelationSteps() const
+{
+    return this -> correlationSteps_;
+}
+
+void System::setTimingStderr(bool enabled)
+{
+    this -> timingStderr_ = enabled;
+}
+
+bool System::getTimingStderr() const
+{
+    return this -> timingStderr_;
+}
+
+void System::setStorage(const StorageLayout& layout)
+{
+    std::string reason = checkStorage(layout);
+    if (reason != "")
+        EXIT("The output layout is not valid because " + reason + " !!!");
+    this -> storage_ = layout;
+}
+
+const StorageLayout& System::getStorage() const
+{
+    return this -> storage_;
+}
+
+const std::string& System::getSweep() const
+{
+    return this -> sweep_;
 }
@@ -0,0 +1,166 @@
+#include "../include/textfile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+TextFile::TextFile()
+{
+    this -> data_ = nullptr;
+    this -> size_ = 0;
+}
+
+TextFile::~TextFile()
+{
+#ifndef _WIN32
+    if (this -> data_ != nullptr && this -> buffer_.empty())
+        munmap(const_cast<char*>(this -> data_), this -> size_);
+#endif
+}
+
+std::string TextFile::open(const std::string& fileName)
+{
+#ifndef _WIN32
+    int descriptor = ::open(fileName.c_str(), O_RDONLY);
+    if (descriptor < 0)
+        return "it can't be opened";
+
+    struct stat status;
+    if (fstat(descriptor, &status) != 0)
+    {
+        close(descriptor);
+        return "it can't be opened";
+    }
+
+    this -> size_ = status.st_size;
+    if (this -> size_ > 0)
+    {
+        void* data = mmap(nullptr, this -> size_, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (data != MAP_FAILED)
+        {
+            madvise(data, this -> size_, MADV_SEQUENTIAL);
+            this -> data_ = static_cast<const char*>(data);
+            close(descriptor);
+            return "";
+        }
+    }
+    close(descriptor);
+#endif
+
+    // Without a mapping, the file is read at once.
+    std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+    if (!file)
+        return "it can't be opened";
+    this -> size_ = file.tellg();
+    this -> buffer_ = std::vector<char>(this -> size_ + 1, '\0');
+    file.seekg(0);
+    file.read(this -> buffer_.data(), this -> size_);
+    this -> data_ = this -> buffer_.data();
+    return "";
+}
+
+const char* TextFile::begin() const
+{
+    return this -> data_;
+}
+
+const char* TextFile::end() const
+{
+    return this -> data_ + this -> size_;
+}
+
+std::vector<const char*> TextFile::splitLines(const char* from, std::size_t bytes) const
+{
+    std::vector<const char*> starts = {from};
+    const char* p = from;
+    while (std::size_t(this -> end() - p) > bytes)
+    {
+        p = lineEnd(p + bytes, this -> end());
+        if (p == this -> end() || p + 1 == this -> end())
+            break;
+        starts.push_back(++p);
+    }
+    return starts;
+}
+
+const char* lineEnd(const char* begin, const char* end)
+{
+    const void* newline = std::memchr(begin, '\n', end - begin);
+    return (newline == nullptr) ? end : static_cast<const char*>(newline);
+}
+
+Index splitTokens(const char* begin, const char* end, std::string_view* tokens, Index maximum)
+{
+    Index count = 0;
+    const char* p = begin;
+    while (true)
+    {
+        while (p != end && (*p == ' ' || *p == '\t' || *p == '\r'))
+            ++p;
+        if (p == end)
+            return count;
+        if (count == maximum)
+            return maximum + 1;
+
+        const char* start = p;
+        while (p != end && *p != ' ' && *p != '\t' && *p != '\r')
+            ++p;
+        tokens[count++] = std::string_view(start, p - start);
+    }
+}
+
+bool nextToken(const char*& p, const char* end, Index& line, std::string_view& token)
+{
+    while (p != end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+    {
+        if (*p == '\n')
+            line++;
+        ++p;
+    }
+    if (p == end)
+        return false;
+
+    const char* start = p;
+    while (p != end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+        ++p;
+    token = std::string_view(start, p - start);
+    return true;
+}
+
+std::string readNumberRows(const TextFile& file, Index rows, const std::vector<Index>& widths,
+                           std::vector<Real>& values, std::vector<Index>& rowWidths)
+{
+    const Index stride = *std::max_element(widths.begin(), widths.end());
+    values = std::vector<Real>(std::size_t(rows) * stride, 0.0);
+    rowWidths = std::vector<Index>(rows, 0);
+
+    std::vector<std::string_view> tokens(stride + 1);
+    Index line = 1;
+    Index row = 0;
+    for (const char* p = file.begin(); p < file.end() && row < rows; ++line)
+    {
+        const char* end = lineEnd(p, file.end());
+        Index count = splitTokens(p, end, tokens.data(), stride);
+        p = end + 1;
+        if (count == 0)
+            continue;
+
+        bool numbers = std::find(widths.begin(), widths.end(), count) != widths.end();
+        for (Index i = 0; i < count && numbers; ++i)
+            numbers = parseNumber(tokens[i], values[std::size_t(row) * stride + i]);
+        if (!numbers)
+            return "the line " + std::to_string(line) + " isn't a row of numbers with the expected amount of values";
+        rowWidths[row++] = count;
+    }
+
+    if (row < rows)
+        return "the file ends before the " + std::to_string(rows) + " rows of the sites";
+    return "";
+}
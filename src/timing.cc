@@ -0,0 +1,122 @@
+#include "../include/timing.h"
+
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+Timing::Timing()
+{
+    this -> start(0);
+}
+
+void Timing::start(Index numTypes)
+{
+    this -> last_ = std::chrono::steady_clock::now();
+    for (Index p = 0; p < NUM_PHASES; ++p)
+        this -> seconds_[p] = 0.0;
+    this -> trials_ = 0.0;
+    this -> trialsByType_ = std::vector<double>(numTypes, 0.0);
+    this -> rejectionsByType_ = std::vector<double>(numTypes, 0.0);
+}
+
+void Timing::lap(TimingPhase phase)
+{
+    auto now = std::chrono::steady_clock::now();
+    this -> seconds_[phase] += std::chrono::duration<Real>(now - this -> last_).count();
+    this -> last_ = now;
+}
+
+void Timing::addTrials(double trials)
+{
+    this -> trials_ += trials;
+}
+
+void Timing::addMoves(Index type, double trials, double rejections)
+{
+    this -> trialsByType_.at(type) += trials;
+    this -> rejectionsByType_.at(type) += rejections;
+}
+
+Real Timing::getSeconds(TimingPhase phase) const
+{
+    return this -> seconds_[phase];
+}
+
+Real Timing::getTotal() const
+{
+    Real total = 0.0;
+    for (Index p = 0; p < NUM_PHASES; ++p)
+        total += this -> seconds_[p];
+    return total;
+}
+
+Real Timing::getTrialsPerSecond() const
+{
+    const Real seconds = this -> seconds_[SWEEP];
+    return (seconds > 0.0) ? this -> trials_ / seconds : std::numeric_limits<Real>::quiet_NaN();
+}
+
+std::vector<Real> Timing::getAcceptances() const
+{
+    std::vector<Real> acceptances(this -> trialsByType_.size(), std::numeric_limits<Real>::quiet_NaN());
+    for (Index t = 0; t < acceptances.size(); ++t)
+        if (this -> trialsByType_.at(t) > 0.0)
+            acceptances.at(t) = 1.0 - this -> rejectionsByType_.at(t) / this -> trialsByType_.at(t);
+    return acceptances;
+}
+
+// JSON has no NaN, so the missing values are null.
+static void writeNumber(std::ostringstream& line, Real value)
+{
+    if (std::isfinite(value))
+        line << value;
+    else
+        line << "null";
+}
+
+// Strings with quotes, backslashes or control characters are escaped.
+static void writeString(std::ostringstream& line, const std::string& text)
+{
+    line << "\"";
+    for (unsigned char c : text)
+    {
+        if (c == '"' || c == '\\')
+            line << '\\' << c;
+        else if (c < 0x20)
+            line << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c)
+                 << std::dec << std::setfill(' ');
+        else
+            line << c;
+    }
+    line << "\"";
+}
+
+std::string Timing::json(Index index, Real T, Real H, const std::vector<std::string>& types) const
+{
+    std::ostringstream line;
+    line << std::setprecision(6);
+    line << "{\"point\":" << index << ",\"T\":" << T << ",\"H\":" << H;
+    for (Index p = 0; p < NUM_PHASES; ++p)
+    {
+        line << ",";
+        writeString(line, TIMING_NAMES[p]);
+        line << ":";
+        writeNumber(line, this -> seconds_[p]);
+    }
+    line << ",\"total\":";
+    writeNumber(line, this -> getTotal());
+    line << ",\"trials_per_second\":";
+    writeNumber(line, this -> getTrialsPerSecond());
+    line << ",\"acceptance\":{";
+    std::vector<Real> acceptances = this -> getAcceptances();
+    for (Index t = 0; t < acceptances.size(); ++t)
+    {
+        line << ((t > 0) ? "," : "");
+        writeString(line, types.at(t));
+        line << ":";
+        writeNumber(line, acceptances.at(t));
+    }
+    line << "}}";
+    return line.str();
+}
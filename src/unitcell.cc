@@ -0,0 +1,247 @@
+#include "../include/unitcell.h"
+
+#include <algorithm>
+#include <cmath>
+
+static Array cross(const Array& a, const Array& b)
+{
+    return {a[1] * b[2] - a[2] * b[1],
+            a[2] * b[0] - a[0] * b[2],
+            a[0] * b[1] - a[1] * b[0]};
+}
+
+UnitCell::UnitCell()
+{
+    this -> tolerance_ = 0.0;
+}
+
+UnitCell::UnitCell(const std::vector<Array>& vectors,
+                   const std::vector<BasisSite>& basis,
+                   const std::vector<Index>& size,
+                   const std::vector<bool>& periodic,
+                   const std::vector<ExchangeShell>& shells,
+                   Real tolerance)
+{
+    this -> vectors_ = vectors;
+    this -> basis_ = basis;
+    this -> size_ = size;
+    this -> periodic_ = periodic;
+    this -> shells_ = shells;
+    this -> tolerance_ = tolerance;
+}
+
+Real UnitCell::determinant() const
+{
+    return (this -> vectors_.at(0) * cross(this -> vectors_.at(1), this -> vectors_.at(2))).sum();
+}
+
+std::string UnitCell::check() const
+{
+    if (this -> vectors_.size() != 3 || this -> size_.size() != 3 || this -> periodic_.size() != 3)
+        return "three lattice vectors, sizes and periodic flags are needed";
+
+    for (auto&& vector : this -> vectors_)
+        if (vector.size() != 3)
+            return "the lattice vectors must have three components";
+
+    if (std::fabs(this -> determinant()) < 1e-12)
+        return "the lattice vectors are not linearly independent";
+
+    if (this -> basis_.size() == 0)
+        return "the basis is empty";
+
+    for (auto&& site : this -> basis_)
+        if (site.position.size() != 3 || site.field.size() != 3)
+            return "the positions and fields of the basis must have three components";
+
+    for (auto&& L : this -> size_)
+        if (L == 0)
+            return "the sizes must be greater than zero";
+
+    if (double(this -> size_[0]) * this -> size_[1] * this -> size_[2] * this -> basis_.size() > 4294967295.0)
+        return "the sample has more sites than the supported by the indexes";
+
+    for (auto&& shell : this -> shells_)
+    {
+        for (auto&& type : shell.types)
+        {
+            bool found = false;
+            for (auto&& site : this -> basis_)
+                found = found || (site.type == type);
+            if (!found)
+                return "the type " + type + " of an exchange is not in the basis";
+        }
+        if (shell.distance <= 0.0)
+            return "the distances of the exchanges must be positive";
+    }
+
+    if (this -> tolerance_ < 0.0)
+        return "the tolerance must be positive";
+
+    return "";
+}
+
+void UnitCell::computeStencil()
+{
+    Real cutoff = 0.0;
+    for (auto&& shell : this -> shells_)
+        cutoff = std::max(cutoff, shell.distance + this -> tolerance_);
+
+    // The reciprocal vectors give the fractional coordinates of the basis
+    // and the separation between the planes of cells along each axis.
+    const Real det = this -> determinant();
+    Array reciprocal[3];
+    for (Index a = 0; a < 3; ++a)
+        reciprocal[a] = cross(this -> vectors_.at((a + 1) % 3), this -> vectors_.at((a + 2) % 3)) / det;
+
+    // Amount of cells to search along each axis: the planes of cells inside
+    // the cutoff plus the spread of the basis in fractional coordinates.
+    int range[3];
+    for (Index a = 0; a < 3; ++a)
+    {
+        Real low = (reciprocal[a] * this -> basis_.at(0).position).sum();
+        Real high = low;
+        for (auto&& site : this -> basis_)
+        {
+            Real f = (reciprocal[a] * site.position).sum();
+            low = std::min(low, f);
+            high = std::max(high, f);
+        }
+        Real spacing = 1.0 / std::sqrt((reciprocal[a] * reciprocal[a]).sum());
+        range[a] = int(std::ceil(cutoff / spacing + (high - low)));
+    }
+
+    this -> stencil_ = std::vector< std::vector<StencilBond> >(this -> basis_.size());
+    for (Index site = 0; site < this -> basis_.size(); ++site)
+    {
+        const BasisSite& from = this -> basis_.at(site);
+        for (int i = - range[0]; i <= range[0]; ++i)
+        for (int j = - range[1]; j <= range[1]; ++j)
+        for (int k = - range[2]; k <= range[2]; ++k)
+        {
+            Array shift = Real(i) * this -> vectors_.at(0) + Real(j) * this -> vectors_.at(1) + Real(k) * this -> vectors_.at(2);
+            for (Index target = 0; target < this -> basis_.size(); ++target)
+            {
+                if (target == site && i == 0 && j == 0 && k == 0)
+                    continue;
+
+                const BasisSite& to = this -> basis_.at(target);
+                Array delta = to.position + shift - from.position;
+                Real distance = std::sqrt((delta * delta).sum());
+
+                for (auto&& shell : this -> shells_)
+                {
+                    bool pair = (shell.types[0] == from.type && shell.types[1] == to.type) ||
+                                (shell.types[1] == from.type && shell.types[0] == to.type);
+                    if (pair && std::fabs(distance - shell.distance) <= this -> tolerance_)
+                    {
+                        this -> stencil_.at(site).push_back({target, {i, j, k}, shell.exchange});
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+const std::vector<Array>& UnitCell::getVectors() const
+{
+    return this -> vectors_;
+}
+
+const std::vector<BasisSite>& UnitCell::getBasis() const
+{
+    return this -> basis_;
+}
+
+const std::vector< std::vector<StencilBond> >& UnitCell::getStencil() const
+{
+    return this -> stencil_;
+}
+
+std::uint64_t UnitCell::getNumCells() const
+{
+    return std::uint64_t(this -> size_.at(0)) * this -> size_.at(1) * this -> size_.at(2);
+}
+
+std::uint64_t UnitCell::getNumSites() const
+{
+    return this -> getNumCells() * this -> basis_.size();
+}
+
+std::uint64_t UnitCell::getNumInteractions() const
+{
+    std::uint64_t num_interactions = 0;
+    for (Index site = 0; site < this -> stencil_.size(); ++site)
+    {
+        for (auto&& bond : this -> stencil_.at(site))
+        {
+            // Cells whose displaced cell is inside the sample.
+            std::uint64_t cells = 1;
+            bool image = (bond.target == site);
+            for (Index a = 0; a < 3; ++a)
+            {
+                int L = this -> size_.at(a);
+                int d = bond.offset[a];
+                if (this -> periodic_.at(a))
+                {
+                    image = image && (d % L == 0);
+                    cells *= std::uint64_t(L);
+                }
+                else
+                {
+                    image = image && (d == 0);
+                    cells *= std::uint64_t(std::max(0, L - std::abs(d)));
+                }
+            }
+            if (!image)
+                num_interactions += cells;
+        }
+    }
+    return num_interactions;
+}
+
+std::vector<std::string> UnitCell::getTypes() const
+{
+    std::vector<std::string> types;
+    for (auto&& site : this -> basis_)
+        if (std::find(types.begin(), types.end(), site.type) == types.end())
+            types.push_back(site.type);
+    return types;
+}
+
+void UnitCell::getCellPosition(Index cell, int position[3]) const
+{
+    position[2] = cell % this -> size_.at(2);
+    cell /= this -> size_.at(2);
+    position[1] = cell % this -> size_.at(1);
+    position[0] = cell / this -> size_.at(1);
+}
+
+Array UnitCell::getPosition(const int cell[3], Index site) const
+{
+    return this -> basis_.at(site).position +
+           Real(cell[0]) * this -> vectors_.at(0) +
+           Real(cell[1]) * this -> vectors_.at(1) +
+           Real(cell[2]) * this -> vectors_.at(2);
+}
+
+bool UnitCell::getNeighbor(const int cell[3], Index site, const StencilBond& bond, Index& index) const
+{
+    int other[3];
+    for (Index a = 0; a < 3; ++a)
+    {
+        int L = this -> size_.at(a);
+        other[a] = cell[a] + bond.offset[a];
+        if (this -> periodic_.at(a))
+            other[a] = ((other[a] % L) + L) % L;
+        else if (other[a] < 0 || other[a] >= L)
+            return false;
+    }
+
+    if (bond.target == site && other[0] == cell[0] && other[1] == cell[1] && other[2] == cell[2])
+        return false;
+
+    index = ((Index(other[0]) * this -> size_.at(1) + Index(other[1])) * this -> size_.at(2) + Index(other[2])) * this -> basis_.size() + bond.target;
+    return true;
+}
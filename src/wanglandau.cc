@@ -0,0 +1,246 @@
+#include "../include/wanglandau.h"
+#include "H5Include.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+WangLandau::WangLandau()
+{
+    this -> bins_ = 0;
+    this -> flatness_ = 0.8;
+    this -> finalLogF_ = 1e-6;
+    this -> logF_ = 1.0;
+    this -> minimum_ = 0.0;
+    this -> width_ = 0.0;
+}
+
+WangLandau::WangLandau(Index bins, Real flatness, Real finalLogF)
+{
+    this -> bins_ = bins;
+    this -> flatness_ = flatness;
+    this -> finalLogF_ = finalLogF;
+    this -> logF_ = 1.0;
+    this -> minimum_ = 0.0;
+    this -> width_ = 0.0;
+
+    this -> logDensity_ = std::vector<Real>(bins, 0.0);
+    this -> histogram_ = std::vector<unsigned long long>(bins, 0);
+    this -> visited_ = std::vector<bool>(bins, false);
+    this -> energy_ = std::vector<Real>(bins, 0.0);
+    this -> magnetization_ = std::vector<Real>(bins, 0.0);
+    this -> magnetization2_ = std::vector<Real>(bins, 0.0);
+}
+
+void WangLandau::setRange(Real minimum, Real maximum)
+{
+    this -> minimum_ = minimum;
+    this -> width_ = (maximum - minimum) / this -> bins_;
+}
+
+bool WangLandau::isEnabled() const
+{
+    return this -> bins_ > 0;
+}
+
+Index WangLandau::getBins() const
+{
+    return this -> bins_;
+}
+
+Real WangLandau::getFlatness() const
+{
+    return this -> flatness_;
+}
+
+Real WangLandau::getFinalLogF() const
+{
+    return this -> finalLogF_;
+}
+
+Real WangLandau::getLogF() const
+{
+    return this -> logF_;
+}
+
+Real WangLandau::getMinimum() const
+{
+    return this -> minimum_;
+}
+
+Real WangLandau::getMaximum() const
+{
+    return this -> minimum_ + this -> bins_ * this -> width_;
+}
+
+long WangLandau::getBin(Real energy) const
+{
+    Real position = (energy - this -> minimum_) / this -> width_;
+    if (!(position >= 0.0) || position >= this -> bins_)
+        return -1;
+    return long(position);
+}
+
+Real WangLandau::logAcceptance(long from, long to) const
+{
+    return this -> logDensity_[from] - this -> logDensity_[to];
+}
+
+void WangLandau::visit(long bin, Real energy, Real magnetization)
+{
+    this -> logDensity_[bin] += this -> logF_;
+    this -> histogram_[bin] += 1;
+    this -> visited_[bin] = true;
+    this -> energy_[bin] += energy;
+    this -> magnetization_[bin] += magnetization;
+    this -> magnetization2_[bin] += magnetization * magnetization;
+}
+
+bool WangLandau::isFlat() const
+{
+    unsigned long long minimum = std::numeric_limits<unsigned long long>::max();
+    Real total = 0.0;
+    Index count = 0;
+    for (Index b = 0; b < this -> bins_; ++b)
+    {
+        if (!this -> visited_[b])
+            continue;
+        minimum = std::min(minimum, this -> histogram_[b]);
+        total += this -> histogram_[b];
+        count += 1;
+    }
+    return count > 0 && minimum >= this -> flatness_ * total / count;
+}
+
+bool WangLandau::nextStage()
+{
+    if (0.5 * this -> logF_ < this -> finalLogF_)
+        return false;
+
+    this -> logF_ *= 0.5;
+    std::fill(this -> histogram_.begin(), this -> histogram_.end(), 0);
+    std::fill(this -> energy_.begin(), this -> energy_.end(), 0.0);
+    std::fill(this -> magnetization_.begin(), this -> magnetization_.end(), 0.0);
+    std::fill(this -> magnetization2_.begin(), this -> magnetization2_.end(), 0.0);
+    return true;
+}
+
+void WangLandau::thermodynamics(Real T, Real kb,
+                                Real& energy, Real& energyVariance,
+                                Real& magnetization, Real& magnetizationVariance) const
+{
+    // The energy of a bin is the mean of its visits in the last stage.
+    std::vector<Real> energies = this -> getEnergies();
+    for (Index b = 0; b < this -> bins_; ++b)
+        if (this -> histogram_[b] > 0)
+            energies[b] = this -> energy_[b] / this -> histogram_[b];
+
+    // The weights are scaled by the largest one, so they never overflow.
+    Real maxWeight = - std::numeric_limits<Real>::infinity();
+    for (Index b = 0; b < this -> bins_; ++b)
+        if (this -> visited_[b])
+            maxWeight = std::max(maxWeight, this -> logDensity_[b] - energies[b] / (kb * T));
+
+    Real Z = 0.0;
+    Real E = 0.0;
+    Real E2 = 0.0;
+    Real M = 0.0;
+    Real M2 = 0.0;
+    for (Index b = 0; b < this -> bins_; ++b)
+    {
+        if (!this -> visited_[b])
+            continue;
+        Real weight = std::exp(this -> logDensity_[b] - energies[b] / (kb * T) - maxWeight);
+        Z += weight;
+        E += weight * energies[b];
+        E2 += weight * energies[b] * energies[b];
+        // The microcanonical averages of the magnetization come from the
+        // visits of the last stage.
+        if (this -> histogram_[b] > 0)
+        {
+            M += weight * this -> magnetization_[b] / this -> histogram_[b];
+            M2 += weight * this -> magnetization2_[b] / this -> histogram_[b];
+        }
+    }
+
+    energy = E / Z;
+    energyVariance = E2 / Z - energy * energy;
+    magnetization = M / Z;
+    magnetizationVariance = M2 / Z - magnetization * magnetization;
+}
+
+std::vector<Real> WangLandau::getLogDensity() const
+{
+    Real minimum = std::numeric_limits<Real>::infinity();
+    for (Index b = 0; b < this -> bins_; ++b)
+        if (this -> visited_[b])
+            minimum = std::min(minimum, this -> logDensity_[b]);
+
+    std::vector<Real> logDensity(this -> bins_, std::numeric_limits<Real>::quiet_NaN());
+    for (Index b = 0; b < this -> bins_; ++b)
+        if (this -> visited_[b])
+            logDensity[b] = this -> logDensity_[b] - minimum;
+    return logDensity;
+}
+
+std::vector<Real> WangLandau::getEnergies() const
+{
+    std::vector<Real> energies(this -> bins_);
+    for (Index b = 0; b < this -> bins_; ++b)
+        energies[b] = this -> minimum_ + (b + 0.5) * this -> width_;
+    return energies;
+}
+
+void WangLandau::write(const std::string& fileName,
+                       const std::vector<Real>& temps,
+                       Real H, Real kb, Index seed, Index num_sites) const
+{
+    hid_t file = H5Fcreate(fileName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+
+    auto writeDataset = [file](const char* name, const std::vector<Real>& values){
+        hsize_t dims[1] = {values.size()};
+        hid_t space = H5Screate_simple(1, dims, NULL);
+        hid_t dset = H5Dcreate(file, name, H5T_IEEE_F64LE, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+        H5Dwrite(dset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, values.data());
+        H5Dclose(dset);
+        H5Sclose(space);
+    };
+
+    writeDataset("wl_energy", this -> getEnergies());
+    writeDataset("wl_lng", this -> getLogDensity());
+    std::vector<Real> histogram(this -> histogram_.begin(), this -> histogram_.end());
+    writeDataset("wl_histogram", histogram);
+
+    // The same columns of the analyzers, by site.
+    const Real N = num_sites;
+    std::vector<Real> energies, heats, magnetizations, susceptibilities;
+    for (auto&& T : temps)
+    {
+        Real E, varE, M, varM;
+        this -> thermodynamics(T, kb, E, varE, M, varM);
+        energies.push_back(E / N);
+        heats.push_back(varE / (T * T) / N);
+        magnetizations.push_back(M / N);
+        susceptibilities.push_back(varM / T / N);
+    }
+    writeDataset("temperature", temps);
+    writeDataset("field", std::vector<Real>(temps.size(), H));
+    writeDataset("mean_energy", energies);
+    writeDataset("specific_heat", heats);
+    writeDataset("mean_magnetization", magnetizations);
+    writeDataset("susceptibility", susceptibilities);
+
+    hid_t space = H5Screate(H5S_SCALAR);
+    auto writeAttribute = [file, space](const char* name, hid_t type, const void* value){
+        hid_t attr = H5Acreate(file, name, type, space, H5P_DEFAULT, H5P_DEFAULT);
+        H5Awrite(attr, type, value);
+        H5Aclose(attr);
+    };
+    writeAttribute("seed", H5T_NATIVE_INT, &seed);
+    writeAttribute("kb", H5T_NATIVE_DOUBLE, &kb);
+    writeAttribute("flatness", H5T_NATIVE_DOUBLE, &this -> flatness_);
+    writeAttribute("lnf", H5T_NATIVE_DOUBLE, &this -> logF_);
+    H5Sclose(space);
+
+    H5Fclose(file);
+}